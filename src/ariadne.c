@@ -407,6 +407,35 @@ long init_navigation(void)
     return 1;
 }
 
+/**
+ * Stores navigation triangulation state, so that it can be restored exactly.
+ * Rebuilding the triangulation from navigation map gives a different layout than the
+ * incrementally updated one, and routes depend on that layout.
+ */
+void navigation_export_state(struct NavigationState *navst)
+{
+    triangles_export_state(navst);
+    points_export_state(navst);
+    regions_export_state(navst);
+    find_cache_export_state(navst);
+    tags_export_state(navst);
+    navst->triangulation_initialised = tri_initialised;
+}
+
+/**
+ * Restores navigation triangulation state stored by navigation_export_state().
+ * Navigation map has to be initialized before the call.
+ */
+void navigation_import_state(const struct NavigationState *navst)
+{
+    triangles_import_state(navst);
+    points_import_state(navst);
+    regions_import_state(navst);
+    find_cache_import_state(navst);
+    tags_import_state(navst);
+    tri_initialised = navst->triangulation_initialised;
+}
+
 long update_navigation_triangulation(long start_x, long start_y, long end_x, long end_y)
 {
     long sx;
@@ -21,6 +21,10 @@
 
 #include "bflib_basics.h"
 #include "globals.h"
+#include "ariadne_tringls.h"
+#include "ariadne_points.h"
+#include "ariadne_regions.h"
+#include "ariadne_navitree.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -169,6 +173,32 @@ struct FOV { // sizeof=0x18
     struct PathWayPoint tipC;
 };
 
+/**
+ * Navigation triangulation state, which is kept outside of Game structure.
+ * Triangulation is built incrementally, so the one made from scratch differs from one
+ * updated while the game goes on; it has to be copied to restore the routing exactly.
+ */
+struct NavigationState {
+    struct Triangle triangles[TRIANLGLES_COUNT];
+    long count_triangles;
+    long ix_triangles;
+    long free_triangles;
+    struct Point points[POINTS_COUNT];
+    long count_points;
+    long ix_points;
+    long free_points;
+    struct RegionT regions[REGIONS_COUNT];
+    long max_region_store;
+    long ix_region_qput;
+    long ix_region_qget;
+    long count_region_q;
+    long region_queue[REGION_QUEUE_LEN];
+    long triangle_find_cache[4][4];
+    unsigned char tags[TREEITEMS_COUNT];
+    unsigned char current_tag;
+    long triangulation_initialised;
+};
+
 /******************************************************************************/
 DLLIMPORT unsigned long *_DK_EdgeFit;
 #define EdgeFit _DK_EdgeFit
@@ -230,6 +260,8 @@ extern struct Path fwd_path;
 extern struct Path bak_path;
 /******************************************************************************/
 long init_navigation(void);
+void navigation_export_state(struct NavigationState *navst);
+void navigation_import_state(const struct NavigationState *navst);
 long update_navigation_triangulation(long start_x, long start_y, long end_x, long end_y);
 TbBool triangulate_area(unsigned char *imap, long sx, long sy, long ex, long ey);
 
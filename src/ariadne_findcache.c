@@ -141,6 +141,16 @@ void triangulation_init_cache(long tri_idx)
     }
 }
 
+void find_cache_export_state(struct NavigationState *navst)
+{
+    memcpy(navst->triangle_find_cache, find_cache, sizeof(navst->triangle_find_cache));
+}
+
+void find_cache_import_state(const struct NavigationState *navst)
+{
+    memcpy(find_cache, navst->triangle_find_cache, sizeof(navst->triangle_find_cache));
+}
+
 long triangle_find8(long pt_x, long pt_y)
 {
     NAVIDBG(19,"Starting");
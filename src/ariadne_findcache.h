@@ -29,6 +29,7 @@ extern "C" {
 /******************************************************************************/
 #pragma pack(1)
 
+struct NavigationState;
 
 #pragma pack()
 /******************************************************************************/
@@ -36,6 +37,8 @@ long triangle_find_cache_get(long pos_x, long pos_y);
 void triangle_find_cache_put(long pos_x, long pos_y, long ntri);
 
 void triangulation_init_cache(long tri_idx);
+void find_cache_export_state(struct NavigationState *navst);
+void find_cache_import_state(const struct NavigationState *navst);
 
 long triangle_find8(long pt_x, long pt_y);
 TbBool point_find(long pt_x, long pt_y, long *out_tri_idx, long *out_cor_idx);
@@ -27,6 +27,7 @@
 #include "ariadne_points.h"
 #include "ariadne_findcache.h"
 #include "ariadne_naviheap.h"
+#include "ariadne.h"
 #include "gui_topmsg.h"
 
 #ifdef __cplusplus
@@ -145,6 +146,18 @@ void tags_init(void)
     tag_current++;
 }
 
+void tags_export_state(struct NavigationState *navst)
+{
+    LbMemoryCopy(navst->tags, Tags, sizeof(navst->tags));
+    navst->current_tag = tag_current;
+}
+
+void tags_import_state(const struct NavigationState *navst)
+{
+    LbMemoryCopy(Tags, navst->tags, sizeof(navst->tags));
+    tag_current = navst->current_tag;
+}
+
 /** Sets tags if indices from given border to given tag_id.
  *
  * @param tag_id
@@ -35,6 +35,8 @@ extern "C" {
 /******************************************************************************/
 #pragma pack(1)
 
+struct NavigationState;
+
 #if USE_ORIGINAL_TRIANGLES_DATA
 DLLIMPORT long _DK_tree_val[TREEVALS_COUNT];
 #define tree_val _DK_tree_val
@@ -45,6 +47,8 @@ extern long tree_val[TREEVALS_COUNT];
 #pragma pack()
 /******************************************************************************/
 void tags_init(void);
+void tags_export_state(struct NavigationState *navst);
+void tags_import_state(const struct NavigationState *navst);
 long update_border_tags(long tag_id, long *border_pt, long border_len);
 long border_tags_to_current(long *border_pt, long border_len);
 TbBool is_current_tag(long tag_id);
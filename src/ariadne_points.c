@@ -20,6 +20,7 @@
 
 #include "globals.h"
 #include "bflib_basics.h"
+#include "ariadne.h"
 #include "gui_topmsg.h"
 
 #ifdef __cplusplus
@@ -170,6 +171,22 @@ void triangulation_initxy_points(long startx, long starty, long endx, long endy)
     count_Points = 4;
     free_Points = -1;
 }
+
+void points_export_state(struct NavigationState *navst)
+{
+    memcpy(navst->points, Points, sizeof(navst->points));
+    navst->count_points = count_Points;
+    navst->ix_points = ix_Points;
+    navst->free_points = free_Points;
+}
+
+void points_import_state(const struct NavigationState *navst)
+{
+    memcpy(Points, navst->points, sizeof(navst->points));
+    count_Points = navst->count_points;
+    ix_Points = navst->ix_points;
+    free_Points = navst->free_points;
+}
 /******************************************************************************/
 #ifdef __cplusplus
 }
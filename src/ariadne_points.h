@@ -34,6 +34,8 @@ extern "C" {
 
 typedef long AridPointId;
 
+struct NavigationState;
+
 struct Point { // sizeof = 4
   short x;
   short y;
@@ -56,6 +58,8 @@ TbBool point_is_invalid(const struct Point *pt);
 TbBool point_equals(AridPointId pt_idx, long pt_x, long pt_y);
 AridPointId point_set_new_or_reuse(long pt_x, long pt_y);
 void triangulation_initxy_points(long startx, long starty, long endx, long endy);
+void points_export_state(struct NavigationState *navst);
+void points_import_state(const struct NavigationState *navst);
 
 /******************************************************************************/
 #ifdef __cplusplus
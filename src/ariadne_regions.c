@@ -21,6 +21,7 @@
 #include "globals.h"
 #include "bflib_basics.h"
 #include "ariadne_tringls.h"
+#include "ariadne.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -202,6 +203,26 @@ void triangulation_init_regions(void)
     memset(Regions, 0, REGIONS_COUNT*sizeof(struct RegionT));
 }
 
+void regions_export_state(struct NavigationState *navst)
+{
+    memcpy(navst->regions, Regions, sizeof(navst->regions));
+    navst->max_region_store = max_RegionStore;
+    navst->ix_region_qput = ix_RegionQput;
+    navst->ix_region_qget = ix_RegionQget;
+    navst->count_region_q = count_RegionQ;
+    memcpy(navst->region_queue, RegionQueue, sizeof(navst->region_queue));
+}
+
+void regions_import_state(const struct NavigationState *navst)
+{
+    memcpy(Regions, navst->regions, sizeof(navst->regions));
+    max_RegionStore = navst->max_region_store;
+    ix_RegionQput = navst->ix_region_qput;
+    ix_RegionQget = navst->ix_region_qget;
+    count_RegionQ = navst->count_region_q;
+    memcpy(RegionQueue, navst->region_queue, sizeof(navst->region_queue));
+}
+
 struct RegionT *get_region(long reg_id)
 {
     if ((reg_id < 0) || (reg_id >= REGIONS_COUNT))
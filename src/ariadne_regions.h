@@ -32,6 +32,8 @@ extern "C" {
 /******************************************************************************/
 #pragma pack(1)
 
+struct NavigationState;
+
 struct RegionT { // sizeof = 3
   unsigned short num_triangles;
   unsigned char field_2;
@@ -52,6 +54,8 @@ void region_set_f(long ntri, unsigned long nreg, const char *func_name);
 void region_unset_f(long ntri, unsigned long nreg, const char *func_name);
 void region_unlock(long ntri);
 void triangulation_init_regions(void);
+void regions_export_state(struct NavigationState *navst);
+void regions_import_state(const struct NavigationState *navst);
 
 /******************************************************************************/
 #ifdef __cplusplus
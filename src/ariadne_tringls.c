@@ -401,6 +401,22 @@ void triangulation_init_triangles(long pt_id1, long pt_id2, long pt_id3, long pt
     Triangles[1].field_D = 7;
 }
 
+void triangles_export_state(struct NavigationState *navst)
+{
+    memcpy(navst->triangles, Triangles, sizeof(navst->triangles));
+    navst->count_triangles = count_Triangles;
+    navst->ix_triangles = ix_Triangles;
+    navst->free_triangles = free_Triangles;
+}
+
+void triangles_import_state(const struct NavigationState *navst)
+{
+    memcpy(Triangles, navst->triangles, sizeof(navst->triangles));
+    count_Triangles = navst->count_triangles;
+    ix_Triangles = navst->ix_triangles;
+    free_Triangles = navst->free_triangles;
+}
+
 char triangle_divide_areas_s8differ(long ntri, long ncorA, long ncorB, long pt_x, long pt_y)
 {
     struct Point* pt = get_triangle_point(ntri, ncorA);
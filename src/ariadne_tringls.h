@@ -32,6 +32,7 @@ extern "C" {
 #pragma pack(1)
 
 struct Point;
+struct NavigationState;
 
 struct Triangle { // sizeof = 16
   short points[3];
@@ -85,6 +86,8 @@ void edgelen_set(long tri_id);
 long edge_rotateAC(long tri1_id, long cor1_id);
 
 void triangulation_init_triangles(long pt_id1, long pt_id2, long pt_id3, long pt_id4);
+void triangles_export_state(struct NavigationState *navst);
+void triangles_import_state(const struct NavigationState *navst);
 char triangle_divide_areas_s8differ(long ntri, long ncorA, long ncorB, long pt_x, long pt_y);
 /******************************************************************************/
 #ifdef __cplusplus
@@ -23,6 +23,7 @@
 #include <string.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <SDL2/SDL.h>
 #define NOMINMAX
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
@@ -218,22 +219,77 @@ short error_dialog_fatal(const char *codefile,const int ecode,const char *messag
   MessageBox(whandle, msg_text, PROGRAM_FULL_NAME, MB_OK | MB_ICONERROR);
   return 0;
 }
+/******************************************************************************/
+/** Amount of lines the log ring can hold; must be a power of 2. */
+#define LOG_RING_SLOTS        1024
+/** Max length of a single line in the log ring; longer lines are truncated. */
+#define LOG_RING_LINE_LEN     1024
+/** Max time, in milliseconds, for which the writer thread keeps lines before writing them. */
+#define LOG_WRITER_INTERVAL     20
+/** Max time, in milliseconds, for which stopping the log waits for the writer thread. */
+#define LOG_WRITER_STOP_TIMEOUT 500
+/** Amount of attempts to take over writing the lines, when flushing the log. */
+#define LOG_FLUSH_ATTEMPTS      50
+/** Time, in milliseconds, after which a line claimed but not filled by a producer is skipped. */
+#define LOG_RING_STALL_TIMEOUT 250
+/** Max time, in milliseconds, for which a producer waits for free slot before dropping its line. */
+#define LOG_RING_PUSH_TIMEOUT  500
+
+struct TbLogRingSlot {
+    /** Equal to the slot position when the slot is free, and to position+1 when it's filled. */
+    SDL_atomic_t seq;
+    int len;
+    char text[LOG_RING_LINE_LEN];
+};
+
+/**
+ * Queue of formatted log lines, with many producers and a single consumer.
+ * Producers claim slots by incrementing head. The consumer is whichever
+ * thread holds drain_lock - the writer thread, or a thread flushing the log.
+ */
+struct TbLogRing {
+    struct TbLogRingSlot slots[LOG_RING_SLOTS];
+    SDL_atomic_t head;
+    unsigned int tail;
+    /** Amount of lines skipped or dropped, not yet reported in the log. */
+    SDL_atomic_t lines_lost;
+    /** Position of the slot the consumer is waiting for, and the time it started waiting. */
+    unsigned int stall_pos;
+    Uint32 stall_ticks;
+    TbBool stalled;
+    SDL_SpinLock drain_lock;
+    SDL_atomic_t running;
+    SDL_atomic_t writer_done;
+    SDL_sem *wakeup;
+    SDL_Thread *writer;
+};
 
 /******************************************************************************/
 short error_log_initialised=false;
 struct TbLog error_log;
+/** Runtime levels of the log channels; debug lines are logged if their level is lower. */
+unsigned char log_channel_level[LbLogCh_COUNT] = {
+    LOG_CHANNEL_DEFAULT_LEVEL, LOG_CHANNEL_DEFAULT_LEVEL, LOG_CHANNEL_DEFAULT_LEVEL,
+    LOG_CHANNEL_DEFAULT_LEVEL, LOG_CHANNEL_DEFAULT_LEVEL, LOG_CHANNEL_DEFAULT_LEVEL,
+    LOG_CHANNEL_DEFAULT_LEVEL, LOG_CHANNEL_DEFAULT_LEVEL, LOG_CHANNEL_DEFAULT_LEVEL,
+};
+static const char *log_channel_names[LbLogCh_COUNT] = {
+    "error", "warn", "sync", "net", "navi", "ai", "script", "config", "just",
+};
+static struct TbLogRing log_ring;
+static FILE *file;
 /******************************************************************************/
-int LbLog(struct TbLog *log, const char *fmt_str, va_list arg);
+int LbLog(struct TbLog *log, enum TbLogChannels chan, const char *prefix, const char *fmt_str, va_list arg);
 /******************************************************************************/
 
 int LbErrorLog(const char *format, ...)
 {
+    // Errors are logged regardless of the channel level
     if (!error_log_initialised)
         return -1;
-    LbLogSetPrefix(&error_log, "Error: ");
     va_list val;
     va_start(val, format);
-    int result=LbLog(&error_log, format, val);
+    int result=LbLog(&error_log, LbLogCh_Error, "Error: ", format, val);
     va_end(val);
     return result;
 }
@@ -242,10 +298,11 @@ int LbWarnLog(const char *format, ...)
 {
     if (!error_log_initialised)
         return -1;
-    LbLogSetPrefix(&error_log, "Warning: ");
+    if (log_channel_level[LbLogCh_Warning] == 0)
+        return 0;
     va_list val;
     va_start(val, format);
-    int result=LbLog(&error_log, format, val);
+    int result=LbLog(&error_log, LbLogCh_Warning, "Warning: ", format, val);
     va_end(val);
     return result;
 }
@@ -254,10 +311,11 @@ int LbAiLog(const char *format, ...)
 {
     if (!error_log_initialised)
         return -1;
-    LbLogSetPrefix(&error_log, "Skirmish AI: ");
+    if (log_channel_level[LbLogCh_AI] == 0)
+        return 0;
     va_list val;
     va_start(val, format);
-    int result=LbLog(&error_log, format, val);
+    int result=LbLog(&error_log, LbLogCh_AI, "Skirmish AI: ", format, val);
     va_end(val);
     return result;
 }
@@ -266,10 +324,11 @@ int LbNetLog(const char *format, ...)
 {
     if (!error_log_initialised)
         return -1;
-    LbLogSetPrefix(&error_log, "Net: ");
+    if (log_channel_level[LbLogCh_Net] == 0)
+        return 0;
     va_list val;
     va_start(val, format);
-    int result=LbLog(&error_log, format, val);
+    int result=LbLog(&error_log, LbLogCh_Net, "Net: ", format, val);
     va_end(val);
     return result;
 }
@@ -278,10 +337,11 @@ int LbSyncLog(const char *format, ...)
 {
     if (!error_log_initialised)
         return -1;
-    LbLogSetPrefix(&error_log, "Sync: ");
+    if (log_channel_level[LbLogCh_Sync] == 0)
+        return 0;
     va_list val;
     va_start(val, format);
-    int result=LbLog(&error_log, format, val);
+    int result=LbLog(&error_log, LbLogCh_Sync, "Sync: ", format, val);
     va_end(val);
     return result;
 }
@@ -290,10 +350,11 @@ int LbNaviLog(const char *format, ...)
 {
     if (!error_log_initialised)
         return -1;
-    LbLogSetPrefix(&error_log, "Navi: ");
+    if (log_channel_level[LbLogCh_Navi] == 0)
+        return 0;
     va_list val;
     va_start(val, format);
-    int result=LbLog(&error_log, format, val);
+    int result=LbLog(&error_log, LbLogCh_Navi, "Navi: ", format, val);
     va_end(val);
     return result;
 }
@@ -305,10 +366,13 @@ int LbScriptLog(unsigned long line,const char *format, ...)
 {
     if (!error_log_initialised)
         return -1;
-    LbLogSetPrefixFmt(&error_log, "Script(line %lu): ",line);
+    if (log_channel_level[LbLogCh_Script] == 0)
+        return 0;
+    char prefix[LOG_PREFIX_LEN];
+    snprintf(prefix, LOG_PREFIX_LEN, "Script(line %lu): ",line);
     va_list val;
     va_start(val, format);
-    int result=LbLog(&error_log, format, val);
+    int result=LbLog(&error_log, LbLogCh_Script, prefix, format, val);
     va_end(val);
     return result;
 }
@@ -320,10 +384,13 @@ int LbConfigLog(unsigned long line,const char *format, ...)
 {
     if (!error_log_initialised)
         return -1;
-    LbLogSetPrefixFmt(&error_log, "Config(line %lu): ",line);
+    if (log_channel_level[LbLogCh_Config] == 0)
+        return 0;
+    char prefix[LOG_PREFIX_LEN];
+    snprintf(prefix, LOG_PREFIX_LEN, "Config(line %lu): ",line);
     va_list val;
     va_start(val, format);
-    int result=LbLog(&error_log, format, val);
+    int result=LbLog(&error_log, LbLogCh_Config, prefix, format, val);
     va_end(val);
     return result;
 }
@@ -332,61 +399,48 @@ int LbJustLog(const char *format, ...)
 {
     if (!error_log_initialised)
         return -1;
-    LbLogSetPrefix(&error_log, "");
+    if (log_channel_level[LbLogCh_Just] == 0)
+        return 0;
     va_list val;
     va_start(val, format);
-    int result=LbLog(&error_log, format, val);
+    int result=LbLog(&error_log, LbLogCh_Just, "", format, val);
     va_end(val);
     return result;
 }
 
-int LbErrorLogSetup(const char *directory, const char *filename, TbBool flag)
-{
-  if ( error_log_initialised )
-    return -1;
-  const char *fixed_fname;
-  if ((filename != NULL) && (filename[0] != '\0'))
-    fixed_fname = filename;
-  else
-    fixed_fname = "error.log";
-  char log_filename[DISKPATH_SIZE];
-  int result;
-  if ( LbFileMakeFullPath(true,directory,fixed_fname,log_filename,DISKPATH_SIZE) != 1 )
-    return -1;
-  ulong flags = (flag == 0) + 1;
-  flags |= LbLog_TimeInHeader | LbLog_DateInHeader | 0x04;
-  if ( LbLogSetup(&error_log, log_filename, flags) == 1 )
-  {
-    error_log_initialised = 1;
-    result = 1;
-  } else
-  {
-    result = -1;
-  }
-  return result;
-}
-
-int LbErrorLogClose(void)
+/**
+ * Sets runtime level of a log channel.
+ * @param chan_name Channel name, or "all" to set level of every channel.
+ * @param level New level; 0 disables the channel, higher values enable more debug lines.
+ * @return Lb_SUCCESS, or Lb_FAIL if the channel name is unknown.
+ */
+TbResult LbLogSetChannelLevel(const char *chan_name, unsigned char level)
 {
-    if (!error_log_initialised)
-        return -1;
-    return LbLogClose(&error_log);
+    TbResult result = Lb_FAIL;
+    for (int chan = 0; chan < LbLogCh_COUNT; chan++)
+    {
+        if ((strcasecmp(chan_name, "all") == 0) || (strcasecmp(chan_name, log_channel_names[chan]) == 0))
+        {
+            log_channel_level[chan] = level;
+            result = Lb_SUCCESS;
+        }
+    }
+    return result;
 }
 
-FILE *file;
- 
-int LbLog(struct TbLog *log, const char *fmt_str, va_list arg)
+/**
+ * Opens the log file if it's not open yet, and writes the log header if it's needed.
+ * @return The log file, or NULL if it couldn't be opened.
+ */
+static FILE *LbLogPrepareFile(struct TbLog *log)
 {
   enum Header {
         NONE   = 0,
         CREATE = 1,
         APPEND = 2,
   };
-//  printf(fmt_str, arg);
   if (!log->Initialised)
-    return -1;
-  if ( log->Suspended )
-    return 1;
+    return NULL;
   char header = NONE;
   short need_initial_newline = false;
   if ( !log->Created )
@@ -418,7 +472,7 @@ int LbLog(struct TbLog *log, const char *fmt_str, va_list arg)
       file = fopen(log->filename, accmode);
       // Couldn't open. Abort
       if (file == NULL)
-        return -1;
+        return NULL;
     }
     log->Created = true;
     if (header != NONE)
@@ -457,27 +511,333 @@ int LbLog(struct TbLog *log, const char *fmt_str, va_list arg)
       }
       fprintf(file, "\n\n");
     }
+    return file;
+}
+
+/**
+ * Formats a log line into given buffer, truncating it if it doesn't fit.
+ * Date and time are added if the log flags require them.
+ * @return Length of the formatted line.
+ */
+static int LbLogFormatLine(const struct TbLog *log, char *buf, int buf_len, const char *prefix, const char *fmt_str, va_list arg)
+{
+    int len = 0;
     if ((log->flags & LbLog_DateInLines) != 0)
     {
         struct TbDate curr_date;
         LbDate(&curr_date);
-        fprintf(file,"%02d-%02d-%d ",curr_date.Day,curr_date.Month,curr_date.Year);
+        len += snprintf(buf+len, buf_len-len, "%02d-%02d-%d ",curr_date.Day,curr_date.Month,curr_date.Year);
     }
     if ((log->flags & LbLog_TimeInLines) != 0)
     {
         struct TbTime curr_time;
         LbTime(&curr_time);
-        fprintf(file, "%02d:%02d:%02d ",
+        len += snprintf(buf+len, buf_len-len, "%02d:%02d:%02d ",
             curr_time.Hour,curr_time.Minute,curr_time.Second);
     }
-    if (log->prefix[0] != '\0')
-      fprintf(file, log->prefix);
-  vfprintf(file, fmt_str, arg);
-  log->position = ftell(file);
+    if (prefix[0] != '\0')
+        len += snprintf(buf+len, buf_len-len, "%s", prefix);
+    int n = vsnprintf(buf+len, buf_len-len, fmt_str, arg);
+    if ((n < 0) || (n >= buf_len-len))
+    {
+        // Truncated; make sure the line is still terminated
+        len = buf_len-1;
+        buf[len-1] = '\n';
+        buf[len] = '\0';
+        return len;
+    }
+    return len + n;
+}
+
+/**
+ * Checks whether the slot at tail was claimed by a producer which didn't fill it for too long,
+ * ie. because it crashed or was interrupted while formatting the line. If so, the slot is skipped.
+ * Requires drain_lock to be held by the calling thread.
+ * @return True if the slot was skipped.
+ */
+static TbBool LbLogRingSkipStalled(struct TbLogRingSlot *slot)
+{
+    unsigned int tail = log_ring.tail;
+    // Slot which wasn't claimed yet is just empty
+    if (((unsigned int)SDL_AtomicGet(&slot->seq) != tail) || ((unsigned int)SDL_AtomicGet(&log_ring.head) == tail))
+        return false;
+    Uint32 now = SDL_GetTicks();
+    if ((!log_ring.stalled) || (log_ring.stall_pos != tail))
+    {
+        log_ring.stalled = true;
+        log_ring.stall_pos = tail;
+        log_ring.stall_ticks = now;
+        return false;
+    }
+    if (now - log_ring.stall_ticks < LOG_RING_STALL_TIMEOUT)
+        return false;
+    // Free the slot for position tail+LOG_RING_SLOTS; fails if the producer filled it meanwhile
+    if (!SDL_AtomicCAS(&slot->seq, tail, tail + LOG_RING_SLOTS))
+        return false;
+    SDL_AtomicIncRef(&log_ring.lines_lost);
+    log_ring.stalled = false;
+    log_ring.tail++;
+    return true;
+}
+
+/**
+ * Writes filled slots of the log ring into the log file, in order.
+ * Requires drain_lock to be held by the calling thread.
+ * @return The log file, if any lines were written; NULL otherwise.
+ */
+static FILE *LbLogRingWriteLocked(void)
+{
+    FILE *fh = NULL;
+    TbBool prepared = false;
+    while (1)
+    {
+        struct TbLogRingSlot *slot = &log_ring.slots[log_ring.tail & (LOG_RING_SLOTS-1)];
+        if ((unsigned int)SDL_AtomicGet(&slot->seq) != log_ring.tail + 1)
+        {
+            if (LbLogRingSkipStalled(slot))
+                continue;
+            break;
+        }
+        if (!prepared)
+        {
+            fh = LbLogPrepareFile(&error_log);
+            prepared = true;
+        }
+        if (fh != NULL)
+            fwrite(slot->text, 1, slot->len, fh);
+        // Full barrier; the slot is free for position tail+LOG_RING_SLOTS
+        SDL_AtomicAdd(&slot->seq, LOG_RING_SLOTS-1);
+        log_ring.tail++;
+    }
+    int lost = SDL_AtomicSet(&log_ring.lines_lost, 0);
+    if (lost > 0)
+    {
+        if (!prepared)
+            fh = LbLogPrepareFile(&error_log);
+        if (fh != NULL)
+            fprintf(fh, "Warning: %d log lines lost\n", lost);
+    }
+    return fh;
+}
+
+/**
+ * Writes lines from the log ring into the log file.
+ * @param wait If true, waits for other thread which is writing the lines;
+ *     otherwise returns immediately when there's such thread.
+ * @return True if the lines were written by this call.
+ */
+static TbBool LbLogRingDrain(TbBool wait)
+{
+    if (wait) {
+        SDL_AtomicLock(&log_ring.drain_lock);
+    } else
+    if (!SDL_AtomicTryLock(&log_ring.drain_lock)) {
+        return false;
+    }
+    FILE *fh = LbLogRingWriteLocked();
+    if (fh != NULL)
+    {
+        error_log.position = ftell(fh);
+        // One flush for the whole batch of lines
+        fflush(fh);
+    }
+    SDL_AtomicUnlock(&log_ring.drain_lock);
+    return true;
+}
+
+/**
+ * Formats a log line into the log ring. Doesn't take any locks, unless the ring is full.
+ * If the slot doesn't become free in LOG_RING_PUSH_TIMEOUT, the line is dropped.
+ * @param urgent If true, the writer thread is woken up to write the line at once.
+ */
+static void LbLogRingPush(struct TbLog *log, TbBool urgent, const char *prefix, const char *fmt_str, va_list arg)
+{
+    unsigned int pos = (unsigned int)SDL_AtomicAdd(&log_ring.head, 1);
+    struct TbLogRingSlot *slot = &log_ring.slots[pos & (LOG_RING_SLOTS-1)];
+    // The slot is still filled only if the ring is full; wait for the consumer to free it
+    Uint32 start_ticks = SDL_GetTicks();
+    while ((unsigned int)SDL_AtomicGet(&slot->seq) != pos)
+    {
+        if (SDL_GetTicks() - start_ticks >= LOG_RING_PUSH_TIMEOUT)
+        {
+            // The consumer will skip our position once it gets there, and count the line as lost
+            return;
+        }
+        if (SDL_AtomicGet(&log_ring.running)) {
+            SDL_SemPost(log_ring.wakeup);
+        } else {
+            LbLogRingDrain(false);
+        }
+        SDL_Delay(1);
+    }
+    slot->len = LbLogFormatLine(log, slot->text, LOG_RING_LINE_LEN, prefix, fmt_str, arg);
+    // Full barrier; publishes the line to the consumer, unless it skipped the slot as stalled
+    if (!SDL_AtomicCAS(&slot->seq, pos, pos + 1))
+        return;
+    if (urgent || ((pos & (LOG_RING_SLOTS/2-1)) == 0))
+        SDL_SemPost(log_ring.wakeup);
+}
+
+static int LbLogWriterThread(void *data)
+{
+    while (SDL_AtomicGet(&log_ring.running))
+    {
+        SDL_SemWaitTimeout(log_ring.wakeup, LOG_WRITER_INTERVAL);
+        LbLogRingDrain(true);
+    }
+    SDL_AtomicSet(&log_ring.writer_done, 1);
+    return 0;
+}
+
+/**
+ * Starts the thread which writes lines from the log ring into error log file.
+ * If it can't be started, lines are written by the logging threads.
+ */
+static TbBool LbLogWriterStart(void)
+{
+    if (SDL_AtomicGet(&log_ring.running))
+        return true;
+    // The semaphore is never destroyed, so that late producers can always post it
+    if (log_ring.wakeup == NULL)
+    {
+        for (int i = 0; i < LOG_RING_SLOTS; i++)
+            SDL_AtomicSet(&log_ring.slots[i].seq, i);
+        SDL_AtomicSet(&log_ring.head, 0);
+        log_ring.tail = 0;
+        log_ring.wakeup = SDL_CreateSemaphore(0);
+        if (log_ring.wakeup == NULL)
+            return false;
+    }
+    SDL_AtomicSet(&log_ring.writer_done, 0);
+    SDL_AtomicSet(&log_ring.running, 1);
+    log_ring.writer = SDL_CreateThread(LbLogWriterThread, "LogWriter", NULL);
+    if (log_ring.writer == NULL)
+    {
+        SDL_AtomicSet(&log_ring.running, 0);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Stops the log writer thread. Lines logged afterwards are written by the logging threads.
+ * Doesn't wait forever, as the writer may be the thread which crashed;
+ * crash handlers call it before logging, so that their lines don't go through the ring.
+ */
+void LbLogWriterStop(void)
+{
+    if (!SDL_AtomicGet(&log_ring.running))
+        return;
+    SDL_AtomicSet(&log_ring.running, 0);
+    SDL_SemPost(log_ring.wakeup);
+    for (int i = 0; i < LOG_WRITER_STOP_TIMEOUT; i++)
+    {
+        if (SDL_AtomicGet(&log_ring.writer_done))
+        {
+            SDL_WaitThread(log_ring.writer, NULL);
+            break;
+        }
+        SDL_Delay(1);
+    }
+    log_ring.writer = NULL;
+}
+
+int LbErrorLogSetup(const char *directory, const char *filename, TbBool flag)
+{
+  if ( error_log_initialised )
+    return -1;
+  const char *fixed_fname;
+  if ((filename != NULL) && (filename[0] != '\0'))
+    fixed_fname = filename;
+  else
+    fixed_fname = "error.log";
+  char log_filename[DISKPATH_SIZE];
+  int result;
+  if ( LbFileMakeFullPath(true,directory,fixed_fname,log_filename,DISKPATH_SIZE) != 1 )
+    return -1;
+  ulong flags = (flag == 0) + 1;
+  flags |= LbLog_TimeInHeader | LbLog_DateInHeader | 0x04;
+  if ( LbLogSetup(&error_log, log_filename, flags) == 1 )
+  {
+    error_log_initialised = 1;
+    LbLogWriterStart();
+    result = 1;
+  } else
+  {
+    result = -1;
+  }
+  return result;
+}
+
+/**
+ * Writes all buffered lines into the error log file.
+ * Safe to use in crash handlers - gives up if the lines are being written
+ * by other thread which doesn't finish soon.
+ */
+int LbErrorLogFlush(void)
+{
+    if (!error_log_initialised)
+        return -1;
+    for (int i = 0; i < LOG_FLUSH_ATTEMPTS; i++)
+    {
+        if (LbLogRingDrain(false))
+            return 1;
+        SDL_Delay(1);
+    }
+    return -1;
+}
+
+int LbErrorLogClose(void)
+{
+    if (!error_log_initialised)
+        return -1;
+    LbLogWriterStop();
+    LbErrorLogFlush();
+    return LbLogClose(&error_log);
+}
+
+int LbLog(struct TbLog *log, enum TbLogChannels chan, const char *prefix, const char *fmt_str, va_list arg)
+{
+  if (!log->Initialised)
+    return -1;
+  if ( log->Suspended )
+    return 1;
+  if (prefix == NULL)
+    prefix = log->prefix;
+  if ((log == &error_log) && SDL_AtomicGet(&log_ring.running))
+  {
+      LbLogRingPush(log, (chan == LbLogCh_Error) || (chan == LbLogCh_Warning), prefix, fmt_str, arg);
+      return 1;
+  }
+  // No writer thread; write directly, after any lines which are still in the ring.
+  // If the lock isn't released soon, its holder may have crashed - then write without it.
+  TbBool locked = false;
+  for (int i = 0; i < LOG_FLUSH_ATTEMPTS; i++)
+  {
+      locked = SDL_AtomicTryLock(&log_ring.drain_lock);
+      if (locked)
+          break;
+      SDL_Delay(1);
+  }
+  if (locked)
+      LbLogRingWriteLocked();
+  FILE *fh = LbLogPrepareFile(log);
+  if (fh == NULL)
+  {
+      if (locked)
+          SDL_AtomicUnlock(&log_ring.drain_lock);
+      return -1;
+  }
+  char line[LOG_RING_LINE_LEN];
+  int len = LbLogFormatLine(log, line, LOG_RING_LINE_LEN, prefix, fmt_str, arg);
+  fwrite(line, 1, len, fh);
+  log->position = ftell(fh);
   // fclose is slow and automatically happens on normal program exit.
   // Opening/closing every time we log something hits performance hard.
   // fclose(file);
-  fflush(file);
+  fflush(fh);
+  if (locked)
+      SDL_AtomicUnlock(&log_ring.drain_lock);
   return 1;
 }
 
@@ -52,6 +52,23 @@ enum TbLogFlags {
         LbLog_LoopedFile   = 0x0100,
 };
 
+/** Log channels; each has its own runtime level, see log_channel_level[]. */
+enum TbLogChannels {
+        LbLogCh_Error = 0,
+        LbLogCh_Warning,
+        LbLogCh_Sync,
+        LbLogCh_Net,
+        LbLogCh_Navi,
+        LbLogCh_AI,
+        LbLogCh_Script,
+        LbLogCh_Config,
+        LbLogCh_Just,
+        LbLogCh_COUNT,
+};
+
+/** Initial level of every log channel; debug lines up to the compiled in level are logged. */
+#define LOG_CHANNEL_DEFAULT_LEVEL ((BFDEBUG_LEVEL > 0) ? BFDEBUG_LEVEL : 1)
+
 enum TbErrorCode {
     Lb_FAIL                 = -1,
     Lb_OK                   =  0,
@@ -123,6 +140,7 @@ typedef size_t TbSize;
 #pragma pack()
 /******************************************************************************/
 extern const char *log_file_name;
+extern unsigned char log_channel_level[LbLogCh_COUNT];
 // High level functions - DK specific
 void error(const char *codefile,const int ecode,const char *message);
 short error_dialog(const char *codefile,const int ecode,const char *message);
@@ -141,6 +159,9 @@ int LbConfigLog(unsigned long line,const char *format, ...);
 
 int LbErrorLogSetup(const char *directory, const char *filename, TbBool flag);
 int LbErrorLogClose(void);
+int LbErrorLogFlush(void);
+void LbLogWriterStop(void);
+TbResult LbLogSetChannelLevel(const char *chan_name, unsigned char level);
 
 int LbLogClose(struct TbLog *log);
 int LbLogSetup(struct TbLog *log, const char *filename, ulong flags);
@@ -0,0 +1,228 @@
+/******************************************************************************/
+// Bullfrog Engine Emulation Library - for use to remake classic games like
+// Syndicate Wars, Magic Carpet or Dungeon Keeper.
+/******************************************************************************/
+/** @file bflib_compress.c
+ *     Fast LZ77 compression of memory buffers.
+ * @par Purpose:
+ *     Compress and decompress memory blocks, ie. saved game chunks.
+ * @par Comment:
+ *     Byte-aligned format, similar to LZ4 blocks. Each sequence starts with
+ *     a token: high nibble is literals count, low nibble is match length
+ *     minus LZC_MIN_MATCH; value of 15 is continued in following bytes.
+ *     Literals follow, then 16-bit little endian match offset. The last
+ *     sequence contains literals only.
+ * @author   KeeperFX Team
+ * @date     19 Oct 2026 - 19 Oct 2026
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+/******************************************************************************/
+#include "bflib_compress.h"
+
+#include <string.h>
+
+#include "globals.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/******************************************************************************/
+#define LZC_MIN_MATCH     4
+#define LZC_MAX_OFFSET    65535
+#define LZC_HASH_BITS     14
+#define LZC_HASH_SIZE     (1 << LZC_HASH_BITS)
+/******************************************************************************/
+
+static inline unsigned long lzc_read32(const unsigned char *p)
+{
+    uint32_t val;
+    memcpy(&val, p, 4);
+    return val;
+}
+
+static inline unsigned long lzc_hash(unsigned long val)
+{
+    return ((val * 2654435761UL) & 0xFFFFFFFFUL) >> (32 - LZC_HASH_BITS);
+}
+
+/**
+ * Writes continuation bytes for a length which didn't fit into token nibble.
+ * @return Amount of bytes written, or -1 if destination is too small.
+ */
+static long lzc_write_length(unsigned char *dst, unsigned long dst_len, unsigned long len)
+{
+    long n = 0;
+    while (len >= 255)
+    {
+        if (n >= dst_len)
+            return -1;
+        dst[n++] = 255;
+        len -= 255;
+    }
+    if (n >= dst_len)
+        return -1;
+    dst[n++] = len;
+    return n;
+}
+
+/**
+ * Returns size of a buffer which is always big enough to store compressed data.
+ */
+unsigned long LbLzCompressBound(unsigned long src_len)
+{
+    return src_len + src_len / 255 + 16;
+}
+
+/**
+ * Compresses a memory block.
+ * @param dst Destination buffer.
+ * @param dst_len Destination buffer size; LbLzCompressBound() is always enough.
+ * @param src Source data.
+ * @param src_len Source data length.
+ * @return Compressed size, or negative error code.
+ */
+long LbLzCompress(unsigned char *dst, unsigned long dst_len, const unsigned char *src, unsigned long src_len)
+{
+    unsigned long hash_tbl[LZC_HASH_SIZE];
+    unsigned long ip = 0;
+    unsigned long anchor = 0;
+    unsigned long op = 0;
+    long n;
+    memset(hash_tbl, 0, sizeof(hash_tbl));
+    while (ip + LZC_MIN_MATCH <= src_len)
+    {
+        unsigned long val = lzc_read32(src + ip);
+        unsigned long h = lzc_hash(val);
+        unsigned long ref = hash_tbl[h];
+        hash_tbl[h] = ip + 1;
+        if ((ref == 0) || (ip - (ref-1) > LZC_MAX_OFFSET) || (lzc_read32(src + ref - 1) != val))
+        {
+            ip++;
+            continue;
+        }
+        ref--;
+        unsigned long mlen = LZC_MIN_MATCH;
+        while ((ip + mlen < src_len) && (src[ref + mlen] == src[ip + mlen]))
+            mlen++;
+        unsigned long lit_len = ip - anchor;
+        // Token, length continuations, literals and offset
+        if (op + 1 + lit_len + 2 > dst_len)
+            return LZC_DEST_TOO_SMALL;
+        unsigned char *token = &dst[op++];
+        *token = ((lit_len < 15) ? lit_len : 15) << 4;
+        if (lit_len >= 15)
+        {
+            n = lzc_write_length(dst + op, dst_len - op, lit_len - 15);
+            if (n < 0)
+                return LZC_DEST_TOO_SMALL;
+            op += n;
+        }
+        if (op + lit_len + 2 > dst_len)
+            return LZC_DEST_TOO_SMALL;
+        memcpy(dst + op, src + anchor, lit_len);
+        op += lit_len;
+        dst[op++] = (ip - ref) & 0xFF;
+        dst[op++] = ((ip - ref) >> 8) & 0xFF;
+        unsigned long mcode = mlen - LZC_MIN_MATCH;
+        *token |= (mcode < 15) ? mcode : 15;
+        if (mcode >= 15)
+        {
+            n = lzc_write_length(dst + op, dst_len - op, mcode - 15);
+            if (n < 0)
+                return LZC_DEST_TOO_SMALL;
+            op += n;
+        }
+        ip += mlen;
+        anchor = ip;
+    }
+    // Last sequence, with literals only
+    unsigned long lit_len = src_len - anchor;
+    if (op + 1 > dst_len)
+        return LZC_DEST_TOO_SMALL;
+    dst[op++] = ((lit_len < 15) ? lit_len : 15) << 4;
+    if (lit_len >= 15)
+    {
+        n = lzc_write_length(dst + op, dst_len - op, lit_len - 15);
+        if (n < 0)
+            return LZC_DEST_TOO_SMALL;
+        op += n;
+    }
+    if (op + lit_len > dst_len)
+        return LZC_DEST_TOO_SMALL;
+    memcpy(dst + op, src + anchor, lit_len);
+    op += lit_len;
+    return op;
+}
+
+/**
+ * Decompresses a memory block created by LbLzCompress().
+ * All accesses are range checked, so corrupted input can't overrun the buffers.
+ * @return Decompressed size, or negative error code.
+ */
+long LbLzDecompress(unsigned char *dst, unsigned long dst_len, const unsigned char *src, unsigned long src_len)
+{
+    unsigned long ip = 0;
+    unsigned long op = 0;
+    while (ip < src_len)
+    {
+        unsigned char token = src[ip++];
+        unsigned long lit_len = token >> 4;
+        if (lit_len == 15)
+        {
+            unsigned char c;
+            do {
+                if (ip >= src_len)
+                    return LZC_DATA_CORRUPTED;
+                c = src[ip++];
+                lit_len += c;
+            } while (c == 255);
+        }
+        if ((ip + lit_len > src_len) || (op + lit_len > dst_len))
+            return LZC_DATA_CORRUPTED;
+        memcpy(dst + op, src + ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+        if (ip >= src_len)
+            break;
+        if (ip + 2 > src_len)
+            return LZC_DATA_CORRUPTED;
+        unsigned long offset = src[ip] | (src[ip+1] << 8);
+        ip += 2;
+        unsigned long mlen = token & 0x0F;
+        if (mlen == 15)
+        {
+            unsigned char c;
+            do {
+                if (ip >= src_len)
+                    return LZC_DATA_CORRUPTED;
+                c = src[ip++];
+                mlen += c;
+            } while (c == 255);
+        }
+        mlen += LZC_MIN_MATCH;
+        if ((offset == 0) || (offset > op) || (op + mlen > dst_len))
+            return LZC_DATA_CORRUPTED;
+        const unsigned char *ref = dst + op - offset;
+        if (offset >= mlen)
+        {
+            memcpy(dst + op, ref, mlen);
+            op += mlen;
+        } else
+        {
+            // Overlapping copy repeats the pattern
+            unsigned long i;
+            for (i = 0; i < mlen; i++)
+                dst[op + i] = ref[i];
+            op += mlen;
+        }
+    }
+    return op;
+}
+/******************************************************************************/
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,43 @@
+/******************************************************************************/
+// Bullfrog Engine Emulation Library - for use to remake classic games like
+// Syndicate Wars, Magic Carpet or Dungeon Keeper.
+/******************************************************************************/
+/** @file bflib_compress.h
+ *     Header file for bflib_compress.c.
+ * @par Purpose:
+ *     Fast LZ77 compression of memory buffers.
+ * @par Comment:
+ *     Just a header file - #defines, typedefs, function prototypes etc.
+ * @author   KeeperFX Team
+ * @date     19 Oct 2026 - 19 Oct 2026
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+/******************************************************************************/
+#ifndef BFLIB_COMPRESS_H
+#define BFLIB_COMPRESS_H
+
+#include "bflib_basics.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/******************************************************************************/
+/*
+ * Error returns
+ */
+#define LZC_DEST_TOO_SMALL  -1
+#define LZC_DATA_CORRUPTED  -2
+
+/******************************************************************************/
+unsigned long LbLzCompressBound(unsigned long src_len);
+long LbLzCompress(unsigned char *dst, unsigned long dst_len, const unsigned char *src, unsigned long src_len);
+long LbLzDecompress(unsigned char *dst, unsigned long dst_len, const unsigned char *src, unsigned long src_len);
+/******************************************************************************/
+#ifdef __cplusplus
+}
+#endif
+#endif
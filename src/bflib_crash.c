@@ -82,13 +82,18 @@ static const char* sigstr(int s)
 
 void exit_handler(void)
 {
+    LbLogWriterStop();
     LbErrorLog("Application exit called.\n");
+    LbErrorLogFlush();
 }
 
 void ctrl_handler(int sig_id)
 {
     signal(sig_id, SIG_DFL);
+    // Write the lines directly; the log ring may be stuck on a slot of the failed thread
+    LbLogWriterStop();
     LbErrorLog("Failure signal: %s.\n",sigstr(sig_id));
+    LbErrorLogFlush();
     LbScreenReset();
     LbErrorLogClose();
     raise(sig_id);
@@ -136,6 +141,8 @@ _backtrace(int depth , LPCONTEXT context)
 
 static LONG CALLBACK ctrl_handler_w32(LPEXCEPTION_POINTERS info)
 {
+    // Write the lines directly; the log ring may be stuck on a slot of the failed thread
+    LbLogWriterStop();
     switch (info->ExceptionRecord->ExceptionCode) {
     case EXCEPTION_ACCESS_VIOLATION:
         switch (info->ExceptionRecord->ExceptionInformation[0])
@@ -161,6 +168,8 @@ static LONG CALLBACK ctrl_handler_w32(LPEXCEPTION_POINTERS info)
         LbErrorLog("Failure code %x received.\n",info->ExceptionRecord->ExceptionCode);
         break;
     }
+    // Make sure the failure reason is written, even if getting the backtrace fails
+    LbErrorLogFlush();
     if (!SymInitialize(GetCurrentProcess(), 0, TRUE)) {
         LbErrorLog("Failed to init symbol context\n");
     }
@@ -26,6 +26,7 @@
 #define NOMINMAX
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
+#include <SDL2/SDL.h>
 
 #include "bflib_basics.h"
 #include "bflib_memory.h"
@@ -34,6 +35,8 @@
 #include "bflib_keybrd.h"
 #include "bflib_inputctrl.h"
 #include "bflib_fileio.h"
+#include "bflib_datetm.h"
+#include "bflib_smacker.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -54,6 +57,8 @@ extern "C" {
 // Global variables
 SmackDrawCallback smack_draw_callback = NULL;
 unsigned char smk_palette[768];
+static unsigned short *scale_column_map = NULL;
+static int scale_column_map_len = 0;
 /******************************************************************************/
 void copy_to_screen(unsigned char *srcbuf, unsigned long width, unsigned long height, unsigned int flags);
 /******************************************************************************/
@@ -240,10 +245,31 @@ void copy_to_screen_px_ar_scale(unsigned char *src_buf, unsigned char *dst_buf,
         dst_height = (int)(in_height * units_per_px / 16.0);
     }
 
+    // Source column for every destination pixel is computed once per frame
+    if (scale_column_map_len < scanline)
+    {
+        LbMemoryFree(scale_column_map);
+        scale_column_map = (unsigned short *)LbMemoryAlloc(scanline * sizeof(unsigned short));
+        if (scale_column_map == NULL) {
+            scale_column_map_len = 0;
+            return;
+        }
+        scale_column_map_len = scanline;
+    }
+    int sw;
+    int sh;
+    int dwstart = spw;
+    for (sw = 0; sw < src_width; sw++)
+    {
+        int dwend = spw + (dst_width * (sw + 1) / src_width);
+        int dw;
+        for (dw = max(dwstart, 0); dw < min(dwend, scanline); dw++)
+            scale_column_map[dw] = sw;
+        dwstart = dwend;
+    }
+    int dwmin = max(spw, 0);
+    int dwmax = min(spw + dst_width, scanline);
     unsigned char* dst;
-    // Source pixel coords
-    int sw = 0;
-    int sh = 0;
     // Clearing top of the canvas
     for (sh = 0; sh < sph; sh++)
     {
@@ -257,41 +283,35 @@ void copy_to_screen_px_ar_scale(unsigned char *src_buf, unsigned char *dst_buf,
         dst = dst_buf + (sh)*scanline;
         LbMemorySet(dst, 0, scanline);
     }
-    // Now drawing
+    // Now drawing; first line of each source line is scaled, and then repeated
     int dhstart = sph;
     for (sh=0; sh<src_height; sh++)
     {
         int dhend = sph + (dst_height * (sh + 1) / src_height);
         const unsigned char* src = src_buf + sh * src_width;
-        // make for(k=0;k<dhend-dhstart;k++) but restrict k to draw area
-        int mhmin = max(0, -dhstart);
-        int mhmax = min(dhend - dhstart, nlines - dhstart);
-        for (int k = mhmin; k < mhmax; k++)
+        int dhmin = max(dhstart, 0);
+        int dhmax = min(dhend, nlines);
+        dhstart = dhend;
+        if (dhmin >= dhmax)
+            continue;
+        unsigned char* first = dst_buf + dhmin*scanline;
+        if (dwmin > 0) {
+            LbMemorySet(first, 0, dwmin);
+        }
+        int dw;
+        for (dw = dwmin; dw < dwmax; dw++)
         {
-            dst = dst_buf + (dhstart+k)*scanline;
-            int dwstart = spw;
-            if (dwstart > 0) {
-               LbMemorySet(dst, 0, dwstart);
-            }
-            for (sw=0; sw<src_width; sw++)
-            {
-                int dwend = spw + (dst_width * (sw + 1) / src_width);
-                // make for(i=0;i<dwend-dwstart;i++) but restrict i to draw area
-                int mwmin = max(0, -dwstart);
-                int mwmax = min(dwend - dwstart, scanline - dwstart);
-                for (int i = mwmin; i < mwmax; i++)
-                {
-                    dst[dwstart+i] = src[sw];
-                }
-                dwstart = dwend;
-            }
-            if (dwstart < scanline) {
-              LbMemorySet(dst+dwstart, 0, scanline-dwstart);
-            }
+            first[dw] = src[scale_column_map[dw]];
+        }
+        if (dwmax < scanline) {
+            LbMemorySet(first+dwmax, 0, scanline-dwmax);
+        }
+        int dh;
+        for (dh = dhmin+1; dh < dhmax; dh++)
+        {
+            memcpy(dst_buf + dh*scanline, first, scanline);
         }
-        dhstart = dhend;
     }
-
 }
 
 void copy_to_screen_pxquad(unsigned char *srcbuf, unsigned char *dstbuf, long width, long dst_shift)
@@ -674,10 +694,124 @@ short play_smk_direct(char *fname, int smkflags, int plyflags)
     return 1;
 }
 
+/**
+ * Opens audio device for the movie sound; samples are queued as frames are shown.
+ * @return Audio device, or 0 if the movie has no sound or the device couldn't be opened.
+ */
+static SDL_AudioDeviceID smk_open_audio(const struct SmkMovie *smk)
+{
+    SDL_AudioSpec want;
+    if (smk->audio_channels == 0)
+        return 0;
+    memset(&want, 0, sizeof(want));
+    want.freq = smk->audio_rate[0];
+    want.format = (smk->audio_bits == 16) ? AUDIO_S16LSB : AUDIO_U8;
+    want.channels = smk->audio_channels;
+    want.samples = 2048;
+    want.callback = NULL;
+    SDL_AudioDeviceID audio_dev = SDL_OpenAudioDevice(NULL, 0, &want, NULL, 0);
+    if (audio_dev == 0) {
+        WARNLOG("Can't open audio device for movie: %s", SDL_GetError());
+        return 0;
+    }
+    SDL_PauseAudioDevice(audio_dev, 0);
+    return audio_dev;
+}
+
+/**
+ * Plays Smacker file with the native decoder; frames are decoded ahead by a worker thread.
+ * @return Returns 0 on error, 1 if file was played, 2 if the play was interrupted.
+ */
+short play_smk_native(char *fname, int smkflags, int plyflags)
+{
+    SYNCDBG(7,"Starting");
+    struct SmkMovie *smk = LbSmkOpen(fname);
+    if (smk == NULL)
+      return 0;
+    SDL_AudioDeviceID audio_dev = 0;
+    if ((GetSoundDriver() != NULL) && ((plyflags & 0x01) == 0))
+      audio_dev = smk_open_audio(smk);
+    LbSmkStartDecodeAhead(smk, (plyflags & 0x0400) != 0);
+    short result = 1;
+    unsigned long nframe = 0;
+    TbClockMSec start_time = LbTimerClock();
+    while (result == 1)
+    {
+        struct SmkFrame *frame = LbSmkGetFrame(smk);
+        if (frame == NULL)
+          break;
+        if ((audio_dev != 0) && (frame->audio_size > 0))
+          SDL_QueueAudio(audio_dev, frame->audio, frame->audio_size);
+        short reset_pal = 0;
+        int idx;
+        if ( frame->new_palette )
+        {
+          reset_pal = 1;
+          for (idx=0;idx<768;idx++)
+          {
+            smk_palette[idx] = frame->palette[idx] >> 2;
+          }
+        }
+        if (LbScreenLock() == Lb_SUCCESS)
+        {
+          if ( (plyflags & SMK_FullscreenFit) != 0 || (plyflags & SMK_FullscreenStretch) != 0 || (plyflags & SMK_FullscreenCrop) != 0 ) // new scaling mode
+          {
+              copy_to_screen_scaled(frame->pixels, smk->width, smk->height, plyflags);
+          }
+          else
+          {
+              copy_to_screen(frame->pixels, smk->width, smk->height, plyflags);
+          }
+          LbScreenUnlock();
+          if ( reset_pal )
+          {
+            LbScreenWaitVbi();
+            LbPaletteSet(smk_palette);
+          }
+          LbScreenSwap();
+        }
+        LbSmkReleaseFrame(smk);
+        nframe++;
+        // Wait for time of the next frame; decoder thread is working meanwhile
+        TbClockMSec next_time = start_time + (TbClockMSec)((unsigned long long)nframe * smk->frame_time / 1000);
+        do {
+          if (!LbWindowsControl())
+          {
+              result = 2;
+              break;
+          }
+          if (((plyflags & SMK_NoStopOnUserInput) == 0) && (lbKeyOn[KC_ESCAPE]
+              || lbKeyOn[KC_RETURN] || lbKeyOn[KC_SPACE] || lbDisplay.LeftButton) )
+          {
+              result = 2;
+              break;
+          }
+          if (LbTimerClock() >= next_time)
+              break;
+          LbSleepFor(1);
+        } while (true);
+    }
+    // Let the sound which was decoded ahead of video finish
+    while ((result == 1) && (audio_dev != 0) && (SDL_GetQueuedAudioSize(audio_dev) > 0))
+    {
+        if (!LbWindowsControl())
+            break;
+        LbSleepFor(1);
+    }
+    if (audio_dev != 0)
+      SDL_CloseAudioDevice(audio_dev);
+    LbSmkClose(smk);
+    return result;
+}
+
 short play_smk_(char *fname, int smkflags, int plyflags)
 {
     short result;
     lbDisplay.LeftButton = 0;
+    result = play_smk_native(fname, smkflags, plyflags);
+    if (result != 0)
+      return result;
+    WARNLOG("Native decoder can't play \"%s\", trying Smacker library",fname);
     if ( (smack_draw_callback != NULL) || ((plyflags & SMK_PixelDoubleWidth) != 0)
         || ((plyflags & SMK_InterlaceLine) != 0) || ((plyflags & SMK_PixelDoubleLine) != 0)
         || (LbScreenIsDoubleBufferred()) )
@@ -916,8 +1050,8 @@ long anim_make_FLI_SS2(unsigned char *curdat, unsigned char *prvdat)
         if (2*(long)k == animation.header.width)
         {
           wend--;
-          cbf += LbGraphicsScreenWidth();
-          pbf += LbGraphicsScreenWidth();
+          cbf += animation.header.width;
+          pbf += animation.header.width;
           continue;
         }
         if ( w > 0 )
@@ -1004,8 +1138,8 @@ long anim_make_FLI_SS2(unsigned char *curdat, unsigned char *prvdat)
           }
         }
       }
-        cbuf += LbGraphicsScreenWidth();
-        pbuf += LbGraphicsScreenWidth();
+        cbuf += animation.header.width;
+        pbuf += animation.header.width;
     }
 
     if (animation.header.height+wend == 0)
@@ -1063,8 +1197,8 @@ long anim_make_FLI_LC(unsigned char *curdat, unsigned char *prvdat)
       }
       if ( wend != animation.header.width )
         break;
-      cbuf += LbGraphicsScreenWidth();
-      pbuf += LbGraphicsScreenWidth();
+      cbuf += animation.header.width;
+      pbuf += animation.header.width;
     }
 
     if (hend != 0)
@@ -1083,8 +1217,8 @@ long anim_make_FLI_LC(unsigned char *curdat, unsigned char *prvdat)
         }
         if ( wend != animation.header.width )
           break;
-        cbuf -= LbGraphicsScreenWidth();
-        pbuf -= LbGraphicsScreenWidth();
+        cbuf -= animation.header.width;
+        pbuf -= animation.header.width;
       }
       hdim = h - hend;
       blksize = animation.header.width * (long)hend;
@@ -1182,8 +1316,8 @@ long anim_make_FLI_LC(unsigned char *curdat, unsigned char *prvdat)
               }
             }
           }
-          cbuf += LbGraphicsScreenWidth();
-          pbuf += LbGraphicsScreenWidth();
+          cbuf += animation.header.width;
+          pbuf += animation.header.width;
       }
     } else
     {
@@ -1471,11 +1605,16 @@ TbBool anim_make_next_frame(unsigned char *screenbuf, unsigned char *palette)
     return true;
 }
 
-TbBool anim_record_frame(unsigned char *screenbuf, unsigned char *palette)
+/**
+ * Appends a frame to the movie being recorded.
+ * Screen buffer is expected to be packed, with line length equal to width.
+ * Does not access the screen, so may be called from capture worker thread.
+ */
+TbBool anim_record_frame(unsigned char *screenbuf, unsigned char *palette, int width, int height, int bpp)
 {
     if ((animation.field_0 & 0x01)==0)
       return false;
-    if (!anim_format_matches(MyScreenWidth/pixel_size,MyScreenHeight/pixel_size,LbGraphicsScreenBPP()))
+    if (!anim_format_matches(width,height,bpp))
       return false;
     return anim_make_next_frame(screenbuf, palette);
 }
@@ -167,6 +167,7 @@ DLLIMPORT struct Animation _DK_animation;
 /******************************************************************************/
 // Exported functions - SMK related
 short play_smk_(char *fname, int smkflags, int plyflags);
+short play_smk_native(char *fname, int smkflags, int plyflags);
 short play_smk_direct(char *fname, int smkflags, int plyflags);
 short play_smk_via_buffer(char *fname, int smkflags, int plyflags);
 
@@ -174,7 +175,7 @@ short play_smk_via_buffer(char *fname, int smkflags, int plyflags);
 short anim_open(char *fname, int arg1, short arg2, int width, int height, int arg5, unsigned int flags);
 short anim_stop(void);
 short anim_record(void);
-TbBool anim_record_frame(unsigned char *screenbuf, unsigned char *palette);
+TbBool anim_record_frame(unsigned char *screenbuf, unsigned char *palette, int width, int height, int bpp);
 
 /******************************************************************************/
 #ifdef __cplusplus
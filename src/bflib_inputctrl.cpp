@@ -335,6 +335,8 @@ TbBool LbWindowsControl(void)
     while (SDL_PollEvent(&ev)) {
         process_event(&ev);
     }
+    // Frames converted by the present thread can only be shown from here
+    LbScreenPresentReady();
     return (lbUserQuit < 1);
 }
 
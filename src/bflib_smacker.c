@@ -0,0 +1,904 @@
+/******************************************************************************/
+// Bullfrog Engine Emulation Library - for use to remake classic games like
+// Syndicate Wars, Magic Carpet or Dungeon Keeper.
+/******************************************************************************/
+/** @file bflib_smacker.c
+ *     Native Smacker video decoder.
+ * @par Purpose:
+ *     Decode Smacker (SMK2 and SMK4) video frames, palettes and audio,
+ *     without the need of SMACKW32 library.
+ * @par Comment:
+ *     Video is stored as 4x4 pixel blocks, coded with four Huffman trees
+ *     for 16-bit values; each tree caches three recently used codes.
+ *     Audio is either raw PCM or DPCM with Huffman coded differences.
+ *     Bink audio tracks are not supported.
+ *     Frames can be decoded ahead by a worker thread into a small ring.
+ * @author   KeeperFX Team
+ * @date     19 Oct 2026 - 19 Oct 2026
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+/******************************************************************************/
+#include "bflib_smacker.h"
+
+#include <string.h>
+#include <SDL2/SDL.h>
+
+#include "globals.h"
+#include "bflib_memory.h"
+#include "bflib_fileio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/******************************************************************************/
+#define SMK_HEADER_SIZE        104
+#define SMK_NODE        0x40000000L
+#define SMK_MAX_TREE_DEPTH     256
+#define SMK_MAX_DIMENSION     4096
+#define SMK_MAX_AUDIO_SIZE   (4*1024*1024)
+#define SMK_MAX_TREES_SIZE   (1024*1024)
+
+enum SmackerBlockTypes {
+    SmkBlk_Mono = 0,
+    SmkBlk_Full,
+    SmkBlk_Skip,
+    SmkBlk_Fill,
+};
+
+struct SmkBitReader {
+    const unsigned char *data;
+    unsigned long size;
+    unsigned long pos;
+    TbBool overrun;
+};
+
+struct SmkBigTreeCtx {
+    struct SmkByteTree *lo;
+    struct SmkByteTree *hi;
+    long escapes[3];
+};
+
+static const unsigned short smk_block_runs[64] = {
+      1,    2,    3,    4,    5,    6,    7,    8,
+      9,   10,   11,   12,   13,   14,   15,   16,
+     17,   18,   19,   20,   21,   22,   23,   24,
+     25,   26,   27,   28,   29,   30,   31,   32,
+     33,   34,   35,   36,   37,   38,   39,   40,
+     41,   42,   43,   44,   45,   46,   47,   48,
+     49,   50,   51,   52,   53,   54,   55,   56,
+     57,   58,   59,  128,  256,  512, 1024, 2048,
+};
+/******************************************************************************/
+
+static inline unsigned long smk_read32(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+static void smk_bits_init(struct SmkBitReader *br, const unsigned char *data, unsigned long size)
+{
+    br->data = data;
+    br->size = size;
+    br->pos = 0;
+    br->overrun = false;
+}
+
+/**
+ * Reads one bit; bits are stored starting from the lowest one in each byte.
+ */
+static inline int smk_get_bit(struct SmkBitReader *br)
+{
+    if ((br->pos >> 3) >= br->size) {
+        br->overrun = true;
+        return 0;
+    }
+    int bit = (br->data[br->pos >> 3] >> (br->pos & 7)) & 1;
+    br->pos++;
+    return bit;
+}
+
+static unsigned long smk_get_bits(struct SmkBitReader *br, int n)
+{
+    unsigned long val = 0;
+    int i;
+    for (i = 0; i < n; i++)
+        val |= smk_get_bit(br) << i;
+    return val;
+}
+
+/**
+ * Reads a tree node. Branch nodes store size of their left subtree, so the
+ * left child is just after the node, and the right child follows the left subtree.
+ */
+static TbBool smk_read_byte_tree_node(struct SmkBitReader *br, struct SmkByteTree *tree, int depth)
+{
+    if ((tree->count >= SMK_BYTE_TREE_SIZE) || (depth > SMK_MAX_TREE_DEPTH))
+        return false;
+    if (!smk_get_bit(br))
+    {
+        tree->values[tree->count++] = smk_get_bits(br, 8);
+        return !br->overrun;
+    }
+    long t = tree->count++;
+    if (!smk_read_byte_tree_node(br, tree, depth+1))
+        return false;
+    tree->values[t] = SMK_NODE | (tree->count - t - 1);
+    return smk_read_byte_tree_node(br, tree, depth+1);
+}
+
+static TbBool smk_read_byte_tree(struct SmkBitReader *br, struct SmkByteTree *tree)
+{
+    tree->count = 0;
+    if (!smk_get_bit(br))
+    {
+        // No tree - every code is zero, and takes no bits
+        tree->values[tree->count++] = 0;
+        return !br->overrun;
+    }
+    if (!smk_read_byte_tree_node(br, tree, 0))
+        return false;
+    smk_get_bit(br);
+    return !br->overrun;
+}
+
+static inline long smk_get_byte_code(struct SmkBitReader *br, const struct SmkByteTree *tree)
+{
+    const long *values = tree->values;
+    long i = 0;
+    while ((values[i] & SMK_NODE) != 0)
+    {
+        if (smk_get_bit(br))
+            i += values[i] & ~SMK_NODE;
+        i++;
+    }
+    return values[i];
+}
+
+static TbBool smk_read_big_tree_node(struct SmkBitReader *br, struct SmkBigTree *tree, struct SmkBigTreeCtx *ctx, int depth)
+{
+    if ((tree->count + 1 >= tree->size) || (depth > SMK_MAX_TREE_DEPTH))
+        return false;
+    if (!smk_get_bit(br))
+    {
+        long lo = smk_get_byte_code(br, ctx->lo);
+        long hi = smk_get_byte_code(br, ctx->hi);
+        long val = lo | (hi << 8);
+        int i;
+        for (i = 0; i < 3; i++)
+        {
+            if (val == ctx->escapes[i]) {
+                tree->last[i] = tree->count;
+                val = 0;
+                break;
+            }
+        }
+        tree->values[tree->count++] = val;
+        return !br->overrun;
+    }
+    long t = tree->count++;
+    if (!smk_read_big_tree_node(br, tree, ctx, depth+1))
+        return false;
+    tree->values[t] = SMK_NODE | (tree->count - t - 1);
+    return smk_read_big_tree_node(br, tree, ctx, depth+1);
+}
+
+/**
+ * Reads one of the video decoding trees from file header.
+ * @param alloc_size Tree size in bytes, as given in the header.
+ */
+static TbBool smk_read_big_tree(struct SmkBitReader *br, struct SmkBigTree *tree, unsigned long alloc_size)
+{
+    int i;
+    // Every tree entry takes at least one bit, so size above the remaining bits can only come from a corrupted file
+    if ((alloc_size >> 2) > (br->size << 3) - br->pos)
+        return false;
+    tree->size = (alloc_size >> 2) + ((alloc_size & 3) ? 1 : 0) + 4;
+    // Additional entries are for escape codes which are not in the tree
+    tree->values = (long *)LbMemoryAlloc((tree->size + 4) * sizeof(long));
+    if (tree->values == NULL)
+        return false;
+    tree->count = 0;
+    for (i = 0; i < 3; i++)
+        tree->last[i] = -1;
+    if (!smk_get_bit(br))
+    {
+        tree->values[tree->count++] = 0;
+    } else
+    {
+        struct SmkByteTree lo_tree;
+        struct SmkByteTree hi_tree;
+        struct SmkBigTreeCtx ctx;
+        if (!smk_read_byte_tree(br, &lo_tree) || !smk_read_byte_tree(br, &hi_tree))
+            return false;
+        ctx.lo = &lo_tree;
+        ctx.hi = &hi_tree;
+        for (i = 0; i < 3; i++)
+            ctx.escapes[i] = smk_get_bits(br, 16);
+        if (!smk_read_big_tree_node(br, tree, &ctx, 0))
+            return false;
+        smk_get_bit(br);
+    }
+    for (i = 0; i < 3; i++)
+    {
+        if (tree->last[i] == -1)
+            tree->last[i] = tree->count++;
+    }
+    return !br->overrun;
+}
+
+static void smk_big_tree_reset(struct SmkBigTree *tree)
+{
+    tree->values[tree->last[0]] = 0;
+    tree->values[tree->last[1]] = 0;
+    tree->values[tree->last[2]] = 0;
+}
+
+static inline long smk_get_code(struct SmkBitReader *br, struct SmkBigTree *tree)
+{
+    long *values = tree->values;
+    long i = 0;
+    while ((values[i] & SMK_NODE) != 0)
+    {
+        if (smk_get_bit(br))
+            i += values[i] & ~SMK_NODE;
+        i++;
+    }
+    long val = values[i];
+    if (val != values[tree->last[0]])
+    {
+        values[tree->last[2]] = values[tree->last[1]];
+        values[tree->last[1]] = values[tree->last[0]];
+        values[tree->last[0]] = val;
+    }
+    return val;
+}
+
+/**
+ * Expands 6-bit palette level to 8 bits.
+ */
+static inline unsigned char smk_palette_level(unsigned char val)
+{
+    val &= 0x3F;
+    return (val << 2) | (val >> 4);
+}
+
+static TbBool smk_decode_palette(struct SmkMovie *smk, const unsigned char *data, unsigned long size)
+{
+    unsigned char oldpal[768];
+    unsigned char *pal = smk->current.palette;
+    unsigned long pos = 0;
+    int n = 0;
+    memcpy(oldpal, pal, sizeof(oldpal));
+    while (n < 256)
+    {
+        if (pos >= size)
+            return false;
+        unsigned char t = data[pos++];
+        if ((t & 0x80) != 0)
+        {
+            // Skip entries, leaving them unchanged
+            n += (t & 0x7F) + 1;
+        } else
+        if ((t & 0x40) != 0)
+        {
+            // Copy entries from another place of previous palette
+            if (pos >= size)
+                return false;
+            int off = data[pos++];
+            int cnt = (t & 0x3F) + 1;
+            if (off + cnt > 256)
+                return false;
+            while ((cnt > 0) && (n < 256))
+            {
+                memcpy(&pal[3*n], &oldpal[3*off], 3);
+                n++;
+                off++;
+                cnt--;
+            }
+        } else
+        {
+            // New entry
+            if (pos + 2 > size)
+                return false;
+            pal[3*n+0] = smk_palette_level(t);
+            pal[3*n+1] = smk_palette_level(data[pos++]);
+            pal[3*n+2] = smk_palette_level(data[pos++]);
+            n++;
+        }
+    }
+    return true;
+}
+
+static TbBool smk_audio_reserve(struct SmkFrame *frame, unsigned long size)
+{
+    if (frame->audio_alloc >= size)
+        return true;
+    LbMemoryFree(frame->audio);
+    frame->audio = (unsigned char *)LbMemoryAlloc(size);
+    if (frame->audio == NULL) {
+        frame->audio_alloc = 0;
+        return false;
+    }
+    frame->audio_alloc = size;
+    return true;
+}
+
+/**
+ * Decodes DPCM audio packet. Differences are added with wraparound, not clipped.
+ */
+static TbBool smk_decode_packed_audio(struct SmkMovie *smk, const unsigned char *data, unsigned long size)
+{
+    struct SmkFrame *frame = &smk->current;
+    struct SmkBitReader br;
+    if (size < 4)
+        return false;
+    unsigned long unpacked_size = smk_read32(data);
+    if (unpacked_size > SMK_MAX_AUDIO_SIZE)
+        return false;
+    smk_bits_init(&br, data + 4, size - 4);
+    if (!smk_get_bit(&br))
+        return true;
+    int stereo = smk_get_bit(&br);
+    int bits16 = smk_get_bit(&br);
+    if ((stereo + 1 != smk->audio_channels) || ((bits16 ? 16 : 8) != smk->audio_bits))
+        return false;
+    int i;
+    for (i = 0; i < (1 << (bits16 + stereo)); i++)
+    {
+        if (!smk_read_byte_tree(&br, &smk->audio_trees[i]))
+            return false;
+    }
+    if (!smk_audio_reserve(frame, unpacked_size))
+        return false;
+    unsigned short pred[2];
+    unsigned long n;
+    if (bits16)
+    {
+        unsigned long count = unpacked_size / 2;
+        short *samples = (short *)frame->audio;
+        for (i = stereo; i >= 0; i--)
+        {
+            unsigned short hi = smk_get_bits(&br, 8);
+            pred[i] = (hi << 8) | smk_get_bits(&br, 8);
+        }
+        for (n = 0; (n <= stereo) && (n < count); n++)
+            samples[n] = (short)pred[n];
+        for (; n < count; n++)
+        {
+            int chan = n & stereo;
+            unsigned short lo = smk_get_byte_code(&br, &smk->audio_trees[2*chan]);
+            unsigned short hi = smk_get_byte_code(&br, &smk->audio_trees[2*chan+1]);
+            pred[chan] += (unsigned short)(lo | (hi << 8));
+            samples[n] = (short)pred[chan];
+        }
+        frame->audio_size = count * 2;
+    } else
+    {
+        unsigned char *samples = frame->audio;
+        for (i = stereo; i >= 0; i--)
+            pred[i] = smk_get_bits(&br, 8);
+        for (n = 0; (n <= stereo) && (n < unpacked_size); n++)
+            samples[n] = pred[n];
+        for (; n < unpacked_size; n++)
+        {
+            int chan = n & stereo;
+            pred[chan] = (pred[chan] + (signed char)smk_get_byte_code(&br, &smk->audio_trees[chan])) & 0xFF;
+            samples[n] = pred[chan];
+        }
+        frame->audio_size = unpacked_size;
+    }
+    return !br.overrun;
+}
+
+static TbBool smk_decode_audio(struct SmkMovie *smk, const unsigned char *data, unsigned long size)
+{
+    if (smk->audio_channels == 0)
+        return true;
+    if ((smk->audio_flags[0] & SmkAF_Packed) != 0)
+        return smk_decode_packed_audio(smk, data, size);
+    if ((size > SMK_MAX_AUDIO_SIZE) || !smk_audio_reserve(&smk->current, size))
+        return false;
+    memcpy(smk->current.audio, data, size);
+    smk->current.audio_size = size;
+    return true;
+}
+
+static TbBool smk_decode_video(struct SmkMovie *smk, const unsigned char *data, unsigned long size)
+{
+    struct SmkBitReader br;
+    unsigned long stride = smk->width;
+    unsigned long bw = smk->width >> 2;
+    unsigned long blocks = bw * (smk->height >> 2);
+    unsigned long blk = 0;
+    unsigned char *out;
+    int i;
+    smk_bits_init(&br, data, size);
+    smk_big_tree_reset(&smk->mmap_tree);
+    smk_big_tree_reset(&smk->mclr_tree);
+    smk_big_tree_reset(&smk->full_tree);
+    smk_big_tree_reset(&smk->type_tree);
+    while ((blk < blocks) && !br.overrun)
+    {
+        long type = smk_get_code(&br, &smk->type_tree);
+        long run = smk_block_runs[(type >> 2) & 0x3F];
+        int mode;
+        switch (type & 3)
+        {
+        case SmkBlk_Mono:
+            for (; (run > 0) && (blk < blocks); run--, blk++)
+            {
+                long clr = smk_get_code(&br, &smk->mclr_tree);
+                long map = smk_get_code(&br, &smk->mmap_tree);
+                unsigned char hi = clr >> 8;
+                unsigned char lo = clr & 0xFF;
+                out = smk->current.pixels + (blk / bw) * 4 * stride + (blk % bw) * 4;
+                for (i = 0; i < 4; i++)
+                {
+                    out[0] = (map & 1) ? hi : lo;
+                    out[1] = (map & 2) ? hi : lo;
+                    out[2] = (map & 4) ? hi : lo;
+                    out[3] = (map & 8) ? hi : lo;
+                    map >>= 4;
+                    out += stride;
+                }
+            }
+            break;
+        case SmkBlk_Full:
+            // Version 4 adds modes with doubled pixels
+            mode = 0;
+            if (smk->version == '4')
+            {
+                if (smk_get_bit(&br))
+                    mode = 1;
+                else if (smk_get_bit(&br))
+                    mode = 2;
+            }
+            for (; (run > 0) && (blk < blocks); run--, blk++)
+            {
+                long pix1;
+                long pix2;
+                out = smk->current.pixels + (blk / bw) * 4 * stride + (blk % bw) * 4;
+                switch (mode)
+                {
+                case 0:
+                    for (i = 0; i < 4; i++)
+                    {
+                        pix2 = smk_get_code(&br, &smk->full_tree);
+                        pix1 = smk_get_code(&br, &smk->full_tree);
+                        out[0] = pix1 & 0xFF;
+                        out[1] = pix1 >> 8;
+                        out[2] = pix2 & 0xFF;
+                        out[3] = pix2 >> 8;
+                        out += stride;
+                    }
+                    break;
+                case 1:
+                    for (i = 0; i < 2; i++)
+                    {
+                        pix1 = smk_get_code(&br, &smk->full_tree);
+                        out[0] = out[1] = pix1 & 0xFF;
+                        out[2] = out[3] = pix1 >> 8;
+                        out += stride;
+                        out[0] = out[1] = pix1 & 0xFF;
+                        out[2] = out[3] = pix1 >> 8;
+                        out += stride;
+                    }
+                    break;
+                case 2:
+                    for (i = 0; i < 2; i++)
+                    {
+                        pix2 = smk_get_code(&br, &smk->full_tree);
+                        pix1 = smk_get_code(&br, &smk->full_tree);
+                        out[0] = pix1 & 0xFF;
+                        out[1] = pix1 >> 8;
+                        out[2] = pix2 & 0xFF;
+                        out[3] = pix2 >> 8;
+                        memcpy(out + stride, out, 4);
+                        out += 2 * stride;
+                    }
+                    break;
+                }
+            }
+            break;
+        case SmkBlk_Skip:
+            blk += run;
+            break;
+        case SmkBlk_Fill:
+            for (; (run > 0) && (blk < blocks); run--, blk++)
+            {
+                out = smk->current.pixels + (blk / bw) * 4 * stride + (blk % bw) * 4;
+                for (i = 0; i < 4; i++)
+                {
+                    memset(out, type >> 8, 4);
+                    out += stride;
+                }
+            }
+            break;
+        }
+    }
+    return !br.overrun;
+}
+
+static void smk_free_big_tree(struct SmkBigTree *tree)
+{
+    LbMemoryFree(tree->values);
+    tree->values = NULL;
+}
+
+static void smk_free_frame(struct SmkFrame *frame)
+{
+    LbMemoryFree(frame->pixels);
+    frame->pixels = NULL;
+    LbMemoryFree(frame->audio);
+    frame->audio = NULL;
+    frame->audio_alloc = 0;
+    frame->audio_size = 0;
+}
+
+/**
+ * Opens Smacker file and reads its header and decoding trees.
+ * @return The movie, or NULL if the file couldn't be opened or isn't supported.
+ */
+struct SmkMovie *LbSmkOpen(const char *fname)
+{
+    unsigned char head[SMK_HEADER_SIZE];
+    TbFileHandle fhandle = LbFileOpen(fname, Lb_FILE_MODE_READ_ONLY);
+    if (fhandle == -1) {
+        WARNLOG("Can't open \"%s\"", fname);
+        return NULL;
+    }
+    if ((LbFileRead(fhandle, head, SMK_HEADER_SIZE) != SMK_HEADER_SIZE)
+      || (memcmp(head, "SMK", 3) != 0) || ((head[3] != '2') && (head[3] != '4')))
+    {
+        WARNLOG("File \"%s\" is not a Smacker video", fname);
+        LbFileClose(fhandle);
+        return NULL;
+    }
+    struct SmkMovie *smk = (struct SmkMovie *)LbMemoryAlloc(sizeof(struct SmkMovie));
+    if (smk == NULL) {
+        LbFileClose(fhandle);
+        return NULL;
+    }
+    smk->fhandle = fhandle;
+    smk->version = head[3];
+    smk->width = smk_read32(&head[4]);
+    smk->height = smk_read32(&head[8]);
+    smk->frames = smk_read32(&head[12]);
+    long rate = (long)smk_read32(&head[16]);
+    smk->flags = smk_read32(&head[20]);
+    unsigned long trees_size = smk_read32(&head[52]);
+    int i;
+    for (i = 0; i < SMK_AUDIO_TRACKS; i++)
+    {
+        unsigned long val = smk_read32(&head[72 + 4*i]);
+        smk->audio_flags[i] = val >> 24;
+        smk->audio_rate[i] = val & 0xFFFFFF;
+    }
+    if (rate > 0)
+        smk->frame_time = rate * 1000;
+    else if (rate < 0)
+        smk->frame_time = -rate * 10;
+    else
+        smk->frame_time = 100000;
+    if ((smk->width < 4) || (smk->width > SMK_MAX_DIMENSION) || (smk->height < 4)
+      || (smk->height > SMK_MAX_DIMENSION) || (smk->frames < 1) || (smk->frames > 0xFFFFFF))
+    {
+        WARNLOG("Unsupported Smacker video \"%s\", size %lux%lu, %lu frames",
+            fname, smk->width, smk->height, smk->frames);
+        LbSmkClose(smk);
+        return NULL;
+    }
+    if ((smk->flags & (SmkFF_YInterlaced|SmkFF_YDoubled)) != 0)
+    {
+        // Such frames have to be stretched vertically, which is left to the Smacker library
+        WARNLOG("Unsupported Smacker video \"%s\", interlaced or doubled lines", fname);
+        LbSmkClose(smk);
+        return NULL;
+    }
+    if (trees_size > SMK_MAX_TREES_SIZE)
+    {
+        WARNLOG("Smacker video \"%s\" has corrupted decoding trees", fname);
+        LbSmkClose(smk);
+        return NULL;
+    }
+    // The ring frame, if present, isn't played; it's only used for looping
+    unsigned long entries = smk->frames + (((smk->flags & SmkFF_RingFrame) != 0) ? 1 : 0);
+    smk->frame_sizes = (unsigned long *)LbMemoryAlloc(entries * sizeof(unsigned long));
+    smk->frame_types = (unsigned char *)LbMemoryAlloc(entries);
+    smk->chunk = (unsigned char *)LbMemoryAlloc(max(entries * 4, trees_size) + 1);
+    smk->chunk_alloc = max(entries * 4, trees_size) + 1;
+    smk->current.pixels = (unsigned char *)LbMemoryAlloc(smk->width * smk->height);
+    if ((smk->frame_sizes == NULL) || (smk->frame_types == NULL) || (smk->chunk == NULL)
+      || (smk->current.pixels == NULL))
+    {
+        ERRORLOG("Can't allocate memory for Smacker video \"%s\"", fname);
+        LbSmkClose(smk);
+        return NULL;
+    }
+    if ((LbFileRead(fhandle, smk->chunk, entries * 4) != entries * 4)
+      || (LbFileRead(fhandle, smk->frame_types, entries) != entries))
+    {
+        WARNLOG("Smacker video \"%s\" is truncated", fname);
+        LbSmkClose(smk);
+        return NULL;
+    }
+    for (i = 0; i < entries; i++)
+        smk->frame_sizes[i] = smk_read32(&smk->chunk[4*i]);
+    struct SmkBitReader br;
+    smk_bits_init(&br, smk->chunk, trees_size);
+    if ((LbFileRead(fhandle, smk->chunk, trees_size) != trees_size)
+      || !smk_read_big_tree(&br, &smk->mmap_tree, smk_read32(&head[56]))
+      || !smk_read_big_tree(&br, &smk->mclr_tree, smk_read32(&head[60]))
+      || !smk_read_big_tree(&br, &smk->full_tree, smk_read32(&head[64]))
+      || !smk_read_big_tree(&br, &smk->type_tree, smk_read32(&head[68])))
+    {
+        WARNLOG("Smacker video \"%s\" has corrupted decoding trees", fname);
+        LbSmkClose(smk);
+        return NULL;
+    }
+    smk->first_frame_pos = LbFilePosition(fhandle);
+    // Only the first audio track is decoded
+    if (smk->audio_rate[0] != 0)
+    {
+        if ((smk->audio_flags[0] & SmkAF_BinkAudio) != 0) {
+            WARNLOG("Smacker video \"%s\" has Bink audio, which is not supported", fname);
+        } else {
+            smk->audio_channels = ((smk->audio_flags[0] & SmkAF_Stereo) != 0) ? 2 : 1;
+            smk->audio_bits = ((smk->audio_flags[0] & SmkAF_16Bit) != 0) ? 16 : 8;
+        }
+    }
+    SYNCDBG(7,"Opened \"%s\", size %lux%lu, %lu frames, %lu us per frame",
+        fname, smk->width, smk->height, smk->frames, smk->frame_time);
+    return smk;
+}
+
+/**
+ * Decodes next frame of the movie into its current frame.
+ * @return True on success, false at end of the movie or on error.
+ */
+TbBool LbSmkDecodeFrame(struct SmkMovie *smk)
+{
+    unsigned long num = smk->next_frame;
+    if (num >= smk->frames)
+        return false;
+    unsigned long size = smk->frame_sizes[num] & ~3UL;
+    unsigned char ftype = smk->frame_types[num];
+    if (size > smk->chunk_alloc)
+    {
+        LbMemoryFree(smk->chunk);
+        smk->chunk = (unsigned char *)LbMemoryAlloc(size);
+        smk->chunk_alloc = (smk->chunk != NULL) ? size : 0;
+        if (smk->chunk == NULL) {
+            ERRORLOG("Can't allocate Smacker frame buffer");
+            return false;
+        }
+    }
+    if (LbFileRead(smk->fhandle, smk->chunk, size) != size) {
+        WARNLOG("Smacker frame %lu is truncated", num);
+        return false;
+    }
+    struct SmkFrame *frame = &smk->current;
+    unsigned long pos = 0;
+    frame->number = num;
+    frame->new_palette = false;
+    frame->audio_size = 0;
+    if ((ftype & 0x01) != 0)
+    {
+        unsigned long pal_size = 0;
+        if (size > 0)
+            pal_size = smk->chunk[0] * 4;
+        if ((pal_size == 0) || (pal_size > size) || !smk_decode_palette(smk, smk->chunk + 1, pal_size - 1)) {
+            WARNLOG("Smacker frame %lu has corrupted palette", num);
+            return false;
+        }
+        frame->new_palette = true;
+        pos = pal_size;
+    }
+    int i;
+    for (i = 0; i < SMK_AUDIO_TRACKS; i++)
+    {
+        if ((ftype & (0x02 << i)) == 0)
+            continue;
+        unsigned long track_size = 0;
+        if (pos + 4 <= size)
+            track_size = smk_read32(smk->chunk + pos);
+        if ((track_size < 4) || (pos + track_size > size)) {
+            WARNLOG("Smacker frame %lu has corrupted audio track %d", num, i);
+            return false;
+        }
+        if ((i == 0) && !smk_decode_audio(smk, smk->chunk + pos + 4, track_size - 4)) {
+            WARNLOG("Smacker frame %lu audio can't be decoded", num);
+            frame->audio_size = 0;
+        }
+        pos += track_size;
+    }
+    if (!smk_decode_video(smk, smk->chunk + pos, size - pos)) {
+        WARNLOG("Smacker frame %lu video data is truncated", num);
+    }
+    smk->next_frame++;
+    return true;
+}
+
+/**
+ * Restarts decoding from the first frame.
+ */
+TbBool LbSmkRewind(struct SmkMovie *smk)
+{
+    if (LbFileSeek(smk->fhandle, smk->first_frame_pos, Lb_FILE_SEEK_BEGINNING) == -1)
+        return false;
+    smk->next_frame = 0;
+    LbMemorySet(smk->current.pixels, 0, smk->width * smk->height);
+    LbMemorySet(smk->current.palette, 0, sizeof(smk->current.palette));
+    return true;
+}
+
+/**
+ * Decodes next frame and copies it to given ring slot.
+ */
+static TbBool smk_decode_to_frame(struct SmkMovie *smk, struct SmkFrame *frame)
+{
+    if (!LbSmkDecodeFrame(smk))
+    {
+        if (!smk->loop || (smk->next_frame < smk->frames))
+            return false;
+        if (!LbSmkRewind(smk) || !LbSmkDecodeFrame(smk))
+            return false;
+    }
+    if (frame == &smk->current)
+        return true;
+    frame->number = smk->current.number;
+    memcpy(frame->pixels, smk->current.pixels, smk->width * smk->height);
+    memcpy(frame->palette, smk->current.palette, sizeof(frame->palette));
+    frame->new_palette = smk->current.new_palette;
+    frame->audio_size = 0;
+    if ((smk->current.audio_size > 0) && smk_audio_reserve(frame, smk->current.audio_size))
+    {
+        memcpy(frame->audio, smk->current.audio, smk->current.audio_size);
+        frame->audio_size = smk->current.audio_size;
+    }
+    return true;
+}
+
+static int smk_decoder_thread(void *data)
+{
+    struct SmkMovie *smk = (struct SmkMovie *)data;
+    SDL_LockMutex(smk->mutex);
+    while (true)
+    {
+        while ((smk->ring_count >= SMK_DECODE_AHEAD) && !smk->exit)
+            SDL_CondWait(smk->cond, smk->mutex);
+        if (smk->exit)
+            break;
+        // Slots past the ring count belong to this thread, so decoding needs no lock
+        struct SmkFrame *frame = &smk->ring[(smk->ring_head + smk->ring_count) % SMK_DECODE_AHEAD];
+        SDL_UnlockMutex(smk->mutex);
+        TbBool decoded = smk_decode_to_frame(smk, frame);
+        SDL_LockMutex(smk->mutex);
+        if (!decoded)
+        {
+            smk->ring_eof = true;
+            SDL_CondBroadcast(smk->cond);
+            break;
+        }
+        smk->ring_count++;
+        SDL_CondBroadcast(smk->cond);
+    }
+    SDL_UnlockMutex(smk->mutex);
+    return 0;
+}
+
+/**
+ * Starts decoder thread, which fills the ring with frames ahead of playback.
+ * If the thread can't be started, frames are decoded when requested.
+ * @param loop If true, the movie restarts after its last frame.
+ */
+TbBool LbSmkStartDecodeAhead(struct SmkMovie *smk, TbBool loop)
+{
+    int i;
+    smk->loop = loop;
+    if (smk->thread != NULL)
+        return true;
+    for (i = 0; i < SMK_DECODE_AHEAD; i++)
+    {
+        smk->ring[i].pixels = (unsigned char *)LbMemoryAlloc(smk->width * smk->height);
+        if (smk->ring[i].pixels == NULL) {
+            WARNLOG("Can't allocate decode-ahead buffers, frames will be decoded synchronously");
+            return false;
+        }
+    }
+    smk->ring_head = 0;
+    smk->ring_count = 0;
+    smk->ring_eof = false;
+    smk->exit = false;
+    smk->mutex = SDL_CreateMutex();
+    smk->cond = SDL_CreateCond();
+    smk->thread = SDL_CreateThread(smk_decoder_thread, "SmackerDecode", smk);
+    if (smk->thread == NULL) {
+        WARNLOG("Cannot create Smacker decoder thread, frames will be decoded synchronously: %s", SDL_GetError());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Gives next frame of the movie, waiting for decoder thread if needed.
+ * The frame stays valid until LbSmkReleaseFrame() is called.
+ * @return The frame, or NULL at end of the movie.
+ */
+struct SmkFrame *LbSmkGetFrame(struct SmkMovie *smk)
+{
+    if (smk->thread == NULL)
+    {
+        if (!smk_decode_to_frame(smk, &smk->current))
+            return NULL;
+        return &smk->current;
+    }
+    struct SmkFrame *frame = NULL;
+    SDL_LockMutex(smk->mutex);
+    while ((smk->ring_count == 0) && !smk->ring_eof)
+        SDL_CondWait(smk->cond, smk->mutex);
+    if (smk->ring_count > 0)
+        frame = &smk->ring[smk->ring_head];
+    SDL_UnlockMutex(smk->mutex);
+    return frame;
+}
+
+/**
+ * Returns the frame given by LbSmkGetFrame() to the decoder.
+ */
+void LbSmkReleaseFrame(struct SmkMovie *smk)
+{
+    if (smk->thread == NULL)
+        return;
+    SDL_LockMutex(smk->mutex);
+    if (smk->ring_count > 0)
+    {
+        smk->ring_head = (smk->ring_head + 1) % SMK_DECODE_AHEAD;
+        smk->ring_count--;
+    }
+    SDL_CondBroadcast(smk->cond);
+    SDL_UnlockMutex(smk->mutex);
+}
+
+/**
+ * Stops the decoder thread, closes the file and frees the movie.
+ */
+void LbSmkClose(struct SmkMovie *smk)
+{
+    int i;
+    if (smk == NULL)
+        return;
+    if (smk->thread != NULL)
+    {
+        SDL_LockMutex(smk->mutex);
+        smk->exit = true;
+        SDL_CondBroadcast(smk->cond);
+        SDL_UnlockMutex(smk->mutex);
+        SDL_WaitThread(smk->thread, NULL);
+        smk->thread = NULL;
+    }
+    if (smk->cond != NULL)
+        SDL_DestroyCond(smk->cond);
+    if (smk->mutex != NULL)
+        SDL_DestroyMutex(smk->mutex);
+    for (i = 0; i < SMK_DECODE_AHEAD; i++)
+        smk_free_frame(&smk->ring[i]);
+    smk_free_frame(&smk->current);
+    smk_free_big_tree(&smk->mmap_tree);
+    smk_free_big_tree(&smk->mclr_tree);
+    smk_free_big_tree(&smk->full_tree);
+    smk_free_big_tree(&smk->type_tree);
+    LbMemoryFree(smk->frame_sizes);
+    LbMemoryFree(smk->frame_types);
+    LbMemoryFree(smk->chunk);
+    LbFileClose(smk->fhandle);
+    LbMemoryFree(smk);
+}
+/******************************************************************************/
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,124 @@
+/******************************************************************************/
+// Bullfrog Engine Emulation Library - for use to remake classic games like
+// Syndicate Wars, Magic Carpet or Dungeon Keeper.
+/******************************************************************************/
+/** @file bflib_smacker.h
+ *     Header file for bflib_smacker.c.
+ * @par Purpose:
+ *     Native Smacker video decoder.
+ * @par Comment:
+ *     Just a header file - #defines, typedefs, function prototypes etc.
+ * @author   KeeperFX Team
+ * @date     19 Oct 2026 - 19 Oct 2026
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+/******************************************************************************/
+#ifndef BFLIB_SMACKER_H
+#define BFLIB_SMACKER_H
+
+#include "bflib_basics.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/******************************************************************************/
+#define SMK_AUDIO_TRACKS     7
+/** Amount of frames which the decoder thread may prepare in advance. */
+#define SMK_DECODE_AHEAD     4
+/** Size of a decoding tree for 8-bit values; 256 leaves and 255 nodes. */
+#define SMK_BYTE_TREE_SIZE 512
+
+enum SmackerFileFlags {
+    SmkFF_RingFrame       = 0x01,
+    SmkFF_YInterlaced     = 0x02,
+    SmkFF_YDoubled        = 0x04,
+};
+
+enum SmackerAudioFlags {
+    SmkAF_Packed          = 0x80,
+    SmkAF_Present         = 0x40,
+    SmkAF_16Bit           = 0x20,
+    SmkAF_Stereo          = 0x10,
+    SmkAF_BinkAudio       = 0x08,
+};
+
+struct SmkByteTree {
+    long values[SMK_BYTE_TREE_SIZE];
+    long count;
+};
+
+/** Decoding tree for 16-bit values, with the three recently used codes cache. */
+struct SmkBigTree {
+    long *values;
+    long size;
+    long count;
+    long last[3];
+};
+
+/** Decoded frame, as stored in the decode-ahead ring. */
+struct SmkFrame {
+    unsigned long number;
+    unsigned char *pixels;
+    unsigned char palette[768];
+    TbBool new_palette;
+    /** PCM samples of the first audio track, in format given by SmkMovie. */
+    unsigned char *audio;
+    unsigned long audio_size;
+    unsigned long audio_alloc;
+};
+
+struct SmkMovie {
+    TbFileHandle fhandle;
+    unsigned char version;
+    unsigned long width;
+    unsigned long height;
+    unsigned long frames;
+    /** Frame duration, in microseconds. */
+    unsigned long frame_time;
+    unsigned long flags;
+    unsigned char audio_flags[SMK_AUDIO_TRACKS];
+    unsigned long audio_rate[SMK_AUDIO_TRACKS];
+    unsigned char audio_channels;
+    unsigned char audio_bits;
+    unsigned long *frame_sizes;
+    unsigned char *frame_types;
+    unsigned long first_frame_pos;
+    unsigned long next_frame;
+    struct SmkBigTree mmap_tree;
+    struct SmkBigTree mclr_tree;
+    struct SmkBigTree full_tree;
+    struct SmkBigTree type_tree;
+    struct SmkByteTree audio_trees[4];
+    unsigned char *chunk;
+    unsigned long chunk_alloc;
+    /** Current state of the decoder; the frame is a delta to it. */
+    struct SmkFrame current;
+    // Decode-ahead ring, filled by the decoder thread
+    struct SmkFrame ring[SMK_DECODE_AHEAD];
+    int ring_head;
+    int ring_count;
+    TbBool ring_eof;
+    TbBool loop;
+    TbBool exit;
+    struct SDL_Thread *thread;
+    struct SDL_mutex *mutex;
+    struct SDL_cond *cond;
+};
+
+/******************************************************************************/
+struct SmkMovie *LbSmkOpen(const char *fname);
+void LbSmkClose(struct SmkMovie *smk);
+TbBool LbSmkDecodeFrame(struct SmkMovie *smk);
+TbBool LbSmkRewind(struct SmkMovie *smk);
+TbBool LbSmkStartDecodeAhead(struct SmkMovie *smk, TbBool loop);
+struct SmkFrame *LbSmkGetFrame(struct SmkMovie *smk);
+void LbSmkReleaseFrame(struct SmkMovie *smk);
+/******************************************************************************/
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -37,6 +37,66 @@ extern "C" {
 #endif
 /******************************************************************************/
 #define DOUBLE_UNDERLINE_BOUND 16
+#define TEXT_LAYOUT_CACHE_SIZE  64
+#define TEXT_LAYOUT_MAX_RUNS   128
+#define TEXT_MEASURE_CACHE_SIZE 256
+#define TEXT_ALIGN_FLAGS (Lb_TEXT_HALIGN_LEFT|Lb_TEXT_HALIGN_RIGHT|Lb_TEXT_HALIGN_CENTER|Lb_TEXT_HALIGN_JUSTIFY)
+
+enum TextMeasureKinds {
+    TxtMsr_PartWidth = 0,
+    TxtMsr_PartWidthM,
+    TxtMsr_Height,
+};
+
+/** Single call to put_down_sprites(), as computed by text layout. */
+struct TextGlyphRun {
+    long start;
+    long end;
+    long x;
+    /** Position relative to the first line. */
+    long y;
+    long len;
+};
+
+/** Everything, besides the text itself, on which a text layout depends. */
+struct TextLayoutKey {
+    unsigned long hash;
+    long text_len;
+    const struct TbSprite *font;
+    const struct AsianFont *dbcfont;
+    TbBool dbc;
+    unsigned char spaces_per_tab;
+    unsigned short align_flags;
+    int units_per_px;
+    long posx;
+    long justify_x;
+    long justify_width;
+};
+
+struct TextLayoutCacheEntry {
+    struct TextLayoutKey key;
+    char *text;
+    /** Alignment flags toggled by control characters within the text. */
+    unsigned short align_toggle;
+    long runs_count;
+    struct TextGlyphRun *runs;
+};
+
+struct TextLayoutRecorder {
+    const char *text;
+    long base_y;
+    long count;
+    TbBool overflow;
+    struct TextGlyphRun runs[TEXT_LAYOUT_MAX_RUNS];
+};
+
+struct TextMeasureCacheEntry {
+    struct TextLayoutKey key;
+    unsigned char kind;
+    long part;
+    char *text;
+    long result;
+};
 
 struct AsianFont dbcJapFonts[] = {
   {"font12j.fon", 0, 215136, 0x2284, 0, 12, 0x0C00, 24, 1, 6, 12, 12, 12, 0, 1, 1, 1, 1},
@@ -68,6 +128,8 @@ long dbc_colour1 = 0;
 short dbc_language = 0;
 TbBool dbc_initialized = false;
 TbBool dbc_enabled = true;
+static struct TextLayoutCacheEntry text_layout_cache[TEXT_LAYOUT_CACHE_SIZE];
+static struct TextMeasureCacheEntry text_measure_cache[TEXT_MEASURE_CACHE_SIZE];
 /******************************************************************************/
 
 /** Returns if the given char starts a wide charcode.
@@ -915,13 +977,171 @@ void put_down_sprites(const char *sbuf, const char *ebuf, long x, long y, long l
 }
 
 /**
- * Given text and its scale, returns unscaled height which the text would occupy
- * if drawn with current fornt on current text window.
- *
- * @param units_per_px
- * @param text
+ * Fills text layout key with the text hash and current font and text window settings.
+ * @return False if the text is too long to be cached.
  */
-long text_string_height(int units_per_px, const char *text)
+static TbBool text_layout_make_key(struct TextLayoutKey *key, const char *text, int units_per_px, long posx)
+{
+    unsigned long hash = 2166136261UL;
+    long len;
+    for (len = 0; text[len] != '\0'; len++)
+    {
+        if (len >= TEXT_DRAW_MAX_LEN)
+            return false;
+        hash = ((hash ^ (unsigned char)text[len]) * 16777619UL) & 0xFFFFFFFFUL;
+    }
+    key->hash = hash;
+    key->text_len = len;
+    key->font = lbFontPtr;
+    key->dbc = ((dbc_initialized) && (dbc_enabled));
+    key->dbcfont = key->dbc ? active_dbcfont : NULL;
+    key->spaces_per_tab = lbSpacesPerTab;
+    key->align_flags = lbDisplay.DrawFlags & TEXT_ALIGN_FLAGS;
+    key->units_per_px = units_per_px;
+    key->posx = posx;
+    key->justify_x = lbTextJustifyWindow.x - lbTextClipWindow.x;
+    key->justify_width = lbTextJustifyWindow.width;
+    return true;
+}
+
+/**
+ * Fills key for text measurement; the window is only used by measurements which wrap lines.
+ */
+static TbBool text_measure_make_key(struct TextLayoutKey *key, const char *text, int units_per_px, TbBool uses_window)
+{
+    if (!text_layout_make_key(key, text, units_per_px, 0))
+        return false;
+    key->align_flags = 0;
+    if (!uses_window)
+    {
+        key->justify_x = 0;
+        key->justify_width = 0;
+    }
+    return true;
+}
+
+static unsigned long text_layout_key_slot(const struct TextLayoutKey *key, unsigned long slots_count)
+{
+    unsigned long val = key->hash ^ ((unsigned long)key->posx * 2654435761UL) ^ (key->units_per_px << 8);
+    return (val ^ (val >> 16)) % slots_count;
+}
+
+static TbBool text_layout_key_matches(const struct TextLayoutKey *ckey, const char *ctext,
+    const struct TextLayoutKey *key, const char *text)
+{
+    if (ctext == NULL)
+        return false;
+    if ((ckey->hash != key->hash) || (ckey->text_len != key->text_len) || (ckey->font != key->font)
+      || (ckey->dbc != key->dbc) || (ckey->dbcfont != key->dbcfont) || (ckey->spaces_per_tab != key->spaces_per_tab)
+      || (ckey->align_flags != key->align_flags) || (ckey->units_per_px != key->units_per_px) || (ckey->posx != key->posx)
+      || (ckey->justify_x != key->justify_x) || (ckey->justify_width != key->justify_width))
+        return false;
+    return (memcmp(ctext, text, key->text_len) == 0);
+}
+
+static char *text_layout_copy_text(const char *text, long len)
+{
+    char *ctext = (char *)LbMemoryAlloc(len + 1);
+    if (ctext != NULL)
+        memcpy(ctext, text, len + 1);
+    return ctext;
+}
+
+static struct TextLayoutCacheEntry *text_layout_cache_find(const struct TextLayoutKey *key, const char *text)
+{
+    struct TextLayoutCacheEntry *entry = &text_layout_cache[text_layout_key_slot(key, TEXT_LAYOUT_CACHE_SIZE)];
+    if (text_layout_key_matches(&entry->key, entry->text, key, text))
+        return entry;
+    return NULL;
+}
+
+static void text_layout_cache_store(const struct TextLayoutKey *key, const char *text,
+    const struct TextLayoutRecorder *rec, unsigned short align_toggle)
+{
+    struct TextLayoutCacheEntry *entry = &text_layout_cache[text_layout_key_slot(key, TEXT_LAYOUT_CACHE_SIZE)];
+    LbMemoryFree(entry->text);
+    LbMemoryFree(entry->runs);
+    entry->text = text_layout_copy_text(text, key->text_len);
+    entry->runs = (struct TextGlyphRun *)LbMemoryAlloc((rec->count + 1) * sizeof(struct TextGlyphRun));
+    if ((entry->text == NULL) || (entry->runs == NULL))
+    {
+        LbMemoryFree(entry->text);
+        LbMemoryFree(entry->runs);
+        entry->text = NULL;
+        entry->runs = NULL;
+        return;
+    }
+    memcpy(entry->runs, rec->runs, rec->count * sizeof(struct TextGlyphRun));
+    entry->runs_count = rec->count;
+    entry->align_toggle = align_toggle;
+    entry->key = *key;
+}
+
+static TbBool text_measure_cache_get(const struct TextLayoutKey *key, unsigned char kind, long part, const char *text, long *result)
+{
+    struct TextMeasureCacheEntry *entry = &text_measure_cache[(text_layout_key_slot(key, TEXT_MEASURE_CACHE_SIZE) + kind) % TEXT_MEASURE_CACHE_SIZE];
+    if ((entry->kind != kind) || (entry->part != part) || !text_layout_key_matches(&entry->key, entry->text, key, text))
+        return false;
+    *result = entry->result;
+    return true;
+}
+
+static void text_measure_cache_put(const struct TextLayoutKey *key, unsigned char kind, long part, const char *text, long result)
+{
+    struct TextMeasureCacheEntry *entry = &text_measure_cache[(text_layout_key_slot(key, TEXT_MEASURE_CACHE_SIZE) + kind) % TEXT_MEASURE_CACHE_SIZE];
+    LbMemoryFree(entry->text);
+    entry->text = text_layout_copy_text(text, key->text_len);
+    if (entry->text == NULL)
+        return;
+    entry->key = *key;
+    entry->kind = kind;
+    entry->part = part;
+    entry->result = result;
+}
+
+/**
+ * Forgets all cached text layouts and measurements.
+ * Needs to be called when fonts are loaded, or when screen mode changes.
+ */
+void LbTextLayoutCacheClear(void)
+{
+    long i;
+    for (i = 0; i < TEXT_LAYOUT_CACHE_SIZE; i++)
+    {
+        struct TextLayoutCacheEntry *entry = &text_layout_cache[i];
+        LbMemoryFree(entry->text);
+        LbMemoryFree(entry->runs);
+        LbMemorySet(entry, 0, sizeof(struct TextLayoutCacheEntry));
+    }
+    for (i = 0; i < TEXT_MEASURE_CACHE_SIZE; i++)
+    {
+        struct TextMeasureCacheEntry *entry = &text_measure_cache[i];
+        LbMemoryFree(entry->text);
+        LbMemorySet(entry, 0, sizeof(struct TextMeasureCacheEntry));
+    }
+}
+
+/**
+ * Draws text sprites, and stores the call parameters so that the text can be redrawn without layout.
+ */
+static void put_down_sprites_recorded(struct TextLayoutRecorder *rec, const char *sbuf, const char *ebuf, long x, long y, long len, int units_per_px)
+{
+    put_down_sprites(sbuf, ebuf, x, y, len, units_per_px);
+    if (rec->count >= TEXT_LAYOUT_MAX_RUNS)
+    {
+        rec->overflow = true;
+        return;
+    }
+    struct TextGlyphRun *run = &rec->runs[rec->count];
+    run->start = sbuf - rec->text;
+    run->end = ebuf - rec->text;
+    run->x = x;
+    run->y = y - rec->base_y;
+    run->len = len;
+    rec->count++;
+}
+
+static long text_string_height_uncached(int units_per_px, const char *text)
 {
     long nlines = 0;
     if (lbFontPtr == NULL)
@@ -998,31 +1218,44 @@ long text_string_height(int units_per_px, const char *text)
 }
 
 /**
- * Draws a string in the current text window in given scale.
- * @param posx Position of the text, X coord.
- * @param posy Position of the text, Y coord.
- * @param units_per_px Scale in pixels; 16 is 100%.
- * @param text The text to be drawn.
- * @return
+ * Given text and its scale, returns unscaled height which the text would occupy
+ * if drawn with current fornt on current text window.
+ *
+ * @param units_per_px
+ * @param text
  */
-TbBool LbTextDrawResized(int posx, int posy, int units_per_px, const char *text)
+long text_string_height(int units_per_px, const char *text)
+{
+    struct TextLayoutKey key;
+    long result;
+    if (lbFontPtr == NULL)
+      return 0;
+    if (!text_measure_make_key(&key, text, units_per_px, true))
+      return text_string_height_uncached(units_per_px, text);
+    if (text_measure_cache_get(&key, TxtMsr_Height, 0, text, &result))
+      return result;
+    result = text_string_height_uncached(units_per_px, text);
+    text_measure_cache_put(&key, TxtMsr_Height, 0, text, result);
+    return result;
+}
+
+/**
+ * Computes layout of a string in the current text window, and draws it.
+ */
+static void text_draw_layout(int posx, int posy, int units_per_px, const char *text, struct TextLayoutRecorder *rec)
 {
     // Counter for amount of blank characters in a line
     const char *ebuf;
     long x;
     long y;
     long len;
-    if ((lbFontPtr == NULL) || (text == NULL))
-        return true;
-    TbGraphicsWindow grwnd;
-    LbScreenStoreGraphicsWindow(&grwnd);
-    LbScreenLoadGraphicsWindow(&lbTextClipWindow);
     long count = 0;
     long justifyx = lbTextJustifyWindow.x - lbTextClipWindow.x;
     long justifyy = lbTextJustifyWindow.y - lbTextClipWindow.y;
     posx += justifyx;
     long startx = posx;
     long starty = posy + justifyy;
+    rec->base_y = starty;
 
     long h = LbTextLineHeight() * units_per_px / 16;
     const char* sbuf = text;
@@ -1055,7 +1288,7 @@ TbBool LbTextDrawResized(int posx, int posy, int units_per_px, const char *text)
             y = LbGetJustifiedCharPosY(starty, h, h, lbDisplay.DrawFlags);
             len = LbGetJustifiedCharWidth(posx, w, count, units_per_px, lbDisplay.DrawFlags);
             ebuf = prev_ebuf;
-            put_down_sprites(sbuf, ebuf, x, y, len, units_per_px);
+            put_down_sprites_recorded(rec, sbuf, ebuf, x, y, len, units_per_px);
             // We already know that alignment is set - don't re-check
             {
                 posx = startx;
@@ -1078,7 +1311,7 @@ TbBool LbTextDrawResized(int posx, int posy, int units_per_px, const char *text)
             x = LbGetJustifiedCharPosX(startx, posx, w, 1, lbDisplay.DrawFlags);
             y = LbGetJustifiedCharPosY(starty, h, h, lbDisplay.DrawFlags);
             len = LbGetJustifiedCharWidth(posx, w, count, units_per_px, lbDisplay.DrawFlags);
-            put_down_sprites(sbuf, ebuf, x, y, len, units_per_px);
+            put_down_sprites_recorded(rec, sbuf, ebuf, x, y, len, units_per_px);
             // End the line only if align method is set
             if (LbAlignMethodSet(lbDisplay.DrawFlags))
             {
@@ -1095,7 +1328,7 @@ TbBool LbTextDrawResized(int posx, int posy, int units_per_px, const char *text)
             y = LbGetJustifiedCharPosY(starty, h, h, lbDisplay.DrawFlags);
             len = LbTextCharWidth(' ') * units_per_px / 16;
             y = starty;
-            put_down_sprites(sbuf, ebuf, x, y, len, units_per_px);
+            put_down_sprites_recorded(rec, sbuf, ebuf, x, y, len, units_per_px);
             // We've got EOL sign - end the line
             sbuf = ebuf;
             posx = startx;
@@ -1115,7 +1348,7 @@ TbBool LbTextDrawResized(int posx, int posy, int units_per_px, const char *text)
             x = LbGetJustifiedCharPosX(startx, posx, w, lbSpacesPerTab, lbDisplay.DrawFlags);
             y = LbGetJustifiedCharPosY(starty, h, h, lbDisplay.DrawFlags);
             len = LbGetJustifiedCharWidth(posx, w, count, units_per_px, lbDisplay.DrawFlags);
-            put_down_sprites(sbuf, ebuf, x, y, len, units_per_px);
+            put_down_sprites_recorded(rec, sbuf, ebuf, x, y, len, units_per_px);
             if (LbAlignMethodSet(lbDisplay.DrawFlags))
             {
               posx = startx;
@@ -1132,7 +1365,7 @@ TbBool LbTextDrawResized(int posx, int posy, int units_per_px, const char *text)
               x = startx;
               y = starty;
               len = LbTextCharWidth(' ') * units_per_px / 16;
-              put_down_sprites(sbuf, ebuf, x, y, len, units_per_px);
+              put_down_sprites_recorded(rec, sbuf, ebuf, x, y, len, units_per_px);
               posx = startx;
               sbuf = ebuf;
               count = 0;
@@ -1164,7 +1397,52 @@ TbBool LbTextDrawResized(int posx, int posy, int units_per_px, const char *text)
     x = LbGetJustifiedCharPosX(startx, posx, 0, 1, lbDisplay.DrawFlags);
     y = LbGetJustifiedCharPosY(starty, h, h, lbDisplay.DrawFlags);
     len = LbTextCharWidth(' ') * units_per_px / 16;
-    put_down_sprites(sbuf, ebuf, x, y, len, units_per_px);
+    put_down_sprites_recorded(rec, sbuf, ebuf, x, y, len, units_per_px);
+}
+
+
+/**
+ * Draws a string in the current text window in given scale.
+ * @param posx Position of the text, X coord.
+ * @param posy Position of the text, Y coord.
+ * @param units_per_px Scale in pixels; 16 is 100%.
+ * @param text The text to be drawn.
+ * @return
+ */
+TbBool LbTextDrawResized(int posx, int posy, int units_per_px, const char *text)
+{
+    struct TextLayoutKey key;
+    if ((lbFontPtr == NULL) || (text == NULL))
+        return true;
+    TbGraphicsWindow grwnd;
+    LbScreenStoreGraphicsWindow(&grwnd);
+    LbScreenLoadGraphicsWindow(&lbTextClipWindow);
+    TbBool cacheable = text_layout_make_key(&key, text, units_per_px, posx);
+    struct TextLayoutCacheEntry *entry = NULL;
+    if (cacheable)
+        entry = text_layout_cache_find(&key, text);
+    if (entry != NULL)
+    {
+        // Same text was drawn before with the same settings - only vertical position may differ
+        long base_y = posy + lbTextJustifyWindow.y - lbTextClipWindow.y;
+        long i;
+        for (i = 0; i < entry->runs_count; i++)
+        {
+            const struct TextGlyphRun *run = &entry->runs[i];
+            put_down_sprites(text + run->start, text + run->end, run->x, base_y + run->y, run->len, units_per_px);
+        }
+        lbDisplay.DrawFlags ^= entry->align_toggle;
+    } else
+    {
+        struct TextLayoutRecorder rec;
+        rec.text = text;
+        rec.count = 0;
+        rec.overflow = false;
+        unsigned short align_flags = lbDisplay.DrawFlags & TEXT_ALIGN_FLAGS;
+        text_draw_layout(posx, posy, units_per_px, text, &rec);
+        if (cacheable && !rec.overflow)
+            text_layout_cache_store(&key, text, &rec, (lbDisplay.DrawFlags & TEXT_ALIGN_FLAGS) ^ align_flags);
+    }
     LbScreenLoadGraphicsWindow(&grwnd);
     return true;
 }
@@ -1480,16 +1758,8 @@ unsigned char LbTextGetFontBackColor(void)
     }
 }
 
-/**
- * Returns length of part of a text if drawn on screen.
- * @param text The text to be probed.
- * @param part Amount of characters to be probed.
- * @return Width of the text image, in pixels.
- */
-int LbTextStringPartWidth(const char *text, int part)
+static int text_string_part_width_uncached(const char *text, int part)
 {
-    if (lbFontPtr == NULL)
-        return 0;
     int max_len = 0;
     int len = 0;
     for (const char* ebuf = text; *ebuf != '\0'; ebuf++)
@@ -1531,10 +1801,29 @@ int LbTextStringPartWidth(const char *text, int part)
     return max_len;
 }
 
-int LbTextStringPartWidthM(const char *text, int part, long units_per_px)
+/**
+ * Returns length of part of a text if drawn on screen.
+ * @param text The text to be probed.
+ * @param part Amount of characters to be probed.
+ * @return Width of the text image, in pixels.
+ */
+int LbTextStringPartWidth(const char *text, int part)
 {
+    struct TextLayoutKey key;
+    long result;
     if (lbFontPtr == NULL)
         return 0;
+    if (!text_measure_make_key(&key, text, 16, false))
+        return text_string_part_width_uncached(text, part);
+    if (text_measure_cache_get(&key, TxtMsr_PartWidth, part, text, &result))
+        return result;
+    result = text_string_part_width_uncached(text, part);
+    text_measure_cache_put(&key, TxtMsr_PartWidth, part, text, result);
+    return result;
+}
+
+static int text_string_part_width_m_uncached(const char *text, int part, long units_per_px)
+{
     int max_len = 0;
     int len = 0;
     for (const char* ebuf = text; *ebuf != '\0'; ebuf++)
@@ -1579,6 +1868,21 @@ int LbTextStringPartWidthM(const char *text, int part, long units_per_px)
     return max_len;
 }
 
+int LbTextStringPartWidthM(const char *text, int part, long units_per_px)
+{
+    struct TextLayoutKey key;
+    long result;
+    if (lbFontPtr == NULL)
+        return 0;
+    if (!text_measure_make_key(&key, text, units_per_px, false))
+        return text_string_part_width_m_uncached(text, part, units_per_px);
+    if (text_measure_cache_get(&key, TxtMsr_PartWidthM, part, text, &result))
+        return result;
+    result = text_string_part_width_m_uncached(text, part, units_per_px);
+    text_measure_cache_put(&key, TxtMsr_PartWidthM, part, text, result);
+    return result;
+}
+
 /**
  * Returns length of given text if drawn on screen.
  * @param text The text to be probed.
@@ -1863,6 +2167,7 @@ const struct TbSprite *LbFontCharSprite(const struct TbSprite *font,const unsign
 
 void dbc_shutdown(void)
 {
+  LbTextLayoutCacheClear();
   const long fonts_count = dbc_fonts_count();
   struct AsianFont *dbcfonts = dbc_fonts_list();
   for (long i = 0; i < fonts_count; i++)
@@ -1947,6 +2252,7 @@ short dbc_initialize(const char *fpath)
     return ret;
   }
   dbc_initialized = 1;
+  LbTextLayoutCacheClear();
   return ret;
 }
 
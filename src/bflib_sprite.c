@@ -21,6 +21,7 @@
 
 #include "bflib_basics.h"
 #include "globals.h"
+#include "bflib_sprfnt.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -40,6 +41,8 @@ short LbSpriteSetup(struct TbSprite *start, const struct TbSprite *end, const un
       }
       sprt++;
     }
+    // The sprites may be a font which was used for cached text
+    LbTextLayoutCacheClear();
 #ifdef __DEBUG
     LbSyncLog("%s: initied %d of %d sprites\n",func_name,n,(sprt-start));
 #endif
@@ -20,6 +20,7 @@
 /******************************************************************************/
 #include "bflib_video.h"
 
+#include "bflib_memory.h"
 #include "bflib_mouse.h"
 #include "bflib_vidsurface.h"
 #include "bflib_sprfnt.h"
@@ -62,6 +63,389 @@ volatile TbBool lbInteruptMouse;
 volatile unsigned long lbIconIndex = 0;
 SDL_Window *lbWindow = NULL;
 /******************************************************************************/
+/**
+ * Frame copied from draw surface; the present thread expands it to 32-bit pixels,
+ * and the thread which owns the window puts it on screen.
+ */
+struct TbPresentFrame {
+    unsigned char *pixels;
+    unsigned long pixels_size;
+    /** Pixels in SDL_PIXELFORMAT_ARGB8888, filled by the present thread. */
+    Uint32 *converted;
+    unsigned long converted_size;
+    long width;
+    long height;
+    SDL_Color palette[PALETTE_COLORS];
+    /** Performance counter value when the frame was handed over. */
+    Uint64 swap_counter;
+};
+
+/**
+ * Handoff of frames between game thread and present thread.
+ * The game thread never waits for the conversion; if a frame is still
+ * pending when next one comes, the older frame is dropped.
+ * SDL window functions may only be used by the thread which created the window,
+ * so the present thread never touches it; converted frames are shown by the game thread.
+ */
+struct TbPresentQueue {
+    SDL_Thread *thread;
+    SDL_mutex *mutex;
+    SDL_cond *cond;
+    struct TbPresentFrame frames[3];
+    /** Index of frame waiting for conversion, or -1. */
+    int pending;
+    /** Index of frame being converted by the thread, or -1. */
+    int converting;
+    /** Index of converted frame waiting to be shown, or -1. */
+    int ready;
+    TbBool exit;
+    TbPresentStats stats;
+    /** Palette converted to 32-bit pixels; only used by the present thread. */
+    Uint32 colours[PALETTE_COLORS];
+    SDL_Color colours_palette[PALETTE_COLORS];
+    TbBool colours_valid;
+};
+
+static struct TbPresentQueue present_queue;
+/** Amount of frames passed to the present thread between logging its statistics. */
+#define PRESENT_STATS_LOG_INTERVAL 2000
+/******************************************************************************/
+/**
+ * Expands 8-bit palette indexed lines into 32-bit pixels.
+ * Reads four source pixels at once; the colour lookups are independent, so they can overlap.
+ */
+static void present_expand_palette_to_32bit(Uint32 *dst, long dst_pitch, const unsigned char *src, long src_pitch,
+    long width, long height, const Uint32 *colours)
+{
+    for (long h = 0; h < height; h++)
+    {
+        const unsigned char *s = src + h * src_pitch;
+        Uint32 *d = (Uint32 *)((unsigned char *)dst + h * dst_pitch);
+        long w;
+        for (w = 0; w + 4 <= width; w += 4)
+        {
+            Uint32 quad;
+            memcpy(&quad, s + w, sizeof(quad));
+            d[w]   = colours[quad & 0xFF];
+            d[w+1] = colours[(quad >> 8) & 0xFF];
+            d[w+2] = colours[(quad >> 16) & 0xFF];
+            d[w+3] = colours[quad >> 24];
+        }
+        for (; w < width; w++)
+        {
+            d[w] = colours[s[w]];
+        }
+    }
+}
+
+/**
+ * Expands the frame into its private 32-bit buffer.
+ * Called by the present thread; doesn't use any SDL video functions.
+ */
+static TbBool present_frame_convert(struct TbPresentQueue *pque, struct TbPresentFrame *frame)
+{
+    unsigned long size = frame->width * frame->height;
+    if (frame->converted_size < size)
+    {
+        LbMemoryFree(frame->converted);
+        frame->converted = (Uint32 *)LbMemoryAlloc(size * sizeof(Uint32));
+        if (frame->converted == NULL) {
+            frame->converted_size = 0;
+            return false;
+        }
+        frame->converted_size = size;
+    }
+    if ((!pque->colours_valid) ||
+        (memcmp(pque->colours_palette, frame->palette, sizeof(pque->colours_palette)) != 0))
+    {
+        for (int i = 0; i < PALETTE_COLORS; i++) {
+            pque->colours[i] = 0xFF000000 | ((Uint32)frame->palette[i].r << 16)
+                | ((Uint32)frame->palette[i].g << 8) | (Uint32)frame->palette[i].b;
+        }
+        memcpy(pque->colours_palette, frame->palette, sizeof(pque->colours_palette));
+        pque->colours_valid = true;
+    }
+    present_expand_palette_to_32bit(frame->converted, frame->width * sizeof(Uint32), frame->pixels, frame->width,
+        frame->width, frame->height, pque->colours);
+    return true;
+}
+
+/**
+ * Puts converted frame on window surface and updates the window.
+ * Has to be called by the thread which owns the window.
+ */
+static TbBool present_frame_on_window(const struct TbPresentFrame *frame)
+{
+    // Get the surface on every frame, to avoid problems with alt tab
+    SDL_Surface *surf = SDL_GetWindowSurface(lbWindow);
+    if (surf == NULL) {
+        ERRORDBG(11,"Cannot get window surface: %s",SDL_GetError());
+        return false;
+    }
+    if ((surf->format->format == SDL_PIXELFORMAT_ARGB8888) || (surf->format->format == SDL_PIXELFORMAT_RGB888))
+    {
+        if (SDL_MUSTLOCK(surf) && (SDL_LockSurface(surf) < 0)) {
+            ERRORLOG("Cannot lock window surface: %s",SDL_GetError());
+            return false;
+        }
+        long width = min(frame->width, surf->w);
+        long height = min(frame->height, surf->h);
+        for (long h = 0; h < height; h++) {
+            memcpy((unsigned char *)surf->pixels + h * surf->pitch, frame->converted + h * frame->width, width * sizeof(Uint32));
+        }
+        if (SDL_MUSTLOCK(surf))
+            SDL_UnlockSurface(surf);
+    } else
+    {
+        // Other pixel formats are left to SDL
+        SDL_Surface *frmsurf = SDL_CreateRGBSurfaceWithFormatFrom(frame->converted, frame->width, frame->height,
+            32, frame->width * sizeof(Uint32), SDL_PIXELFORMAT_ARGB8888);
+        if (frmsurf == NULL) {
+            ERRORLOG("Cannot wrap frame in surface: %s",SDL_GetError());
+            return false;
+        }
+        int blresult = SDL_BlitSurface(frmsurf, NULL, surf, NULL);
+        SDL_FreeSurface(frmsurf);
+        if (blresult < 0) {
+            ERRORLOG("Blit failed: %s",SDL_GetError());
+            return false;
+        }
+    }
+    if (SDL_UpdateWindowSurface(lbWindow) < 0) {
+        // In some cases this situation seems to be quite common
+        ERRORDBG(11,"Flip failed: %s",SDL_GetError());
+        return false;
+    }
+    return true;
+}
+
+static int present_thread_func(void *data)
+{
+    struct TbPresentQueue *pque = (struct TbPresentQueue *)data;
+    SDL_LockMutex(pque->mutex);
+    while (!pque->exit)
+    {
+        if (pque->pending < 0)
+        {
+            SDL_CondWait(pque->cond, pque->mutex);
+            continue;
+        }
+        int idx = pque->pending;
+        pque->pending = -1;
+        pque->converting = idx;
+        SDL_UnlockMutex(pque->mutex);
+        TbBool result = present_frame_convert(pque, &pque->frames[idx]);
+        SDL_LockMutex(pque->mutex);
+        pque->converting = -1;
+        if (result) {
+            if (pque->ready >= 0) {
+                // Previous converted frame wasn't shown; replace it
+                pque->stats.frames_dropped++;
+            }
+            pque->ready = idx;
+        } else {
+            pque->stats.frames_failed++;
+        }
+        SDL_CondBroadcast(pque->cond);
+    }
+    SDL_UnlockMutex(pque->mutex);
+    return 0;
+}
+
+static TbBool present_thread_start(void)
+{
+    struct TbPresentQueue *pque = &present_queue;
+    if (pque->mutex != NULL)
+        return (pque->thread != NULL);
+    pque->mutex = SDL_CreateMutex();
+    pque->cond = SDL_CreateCond();
+    pque->exit = false;
+    pque->pending = -1;
+    pque->converting = -1;
+    pque->ready = -1;
+    pque->colours_valid = false;
+    pque->thread = SDL_CreateThread(present_thread_func, "ScreenPresent", pque);
+    if (pque->thread == NULL) {
+        WARNLOG("Cannot create present thread, frames will be presented synchronously: %s", SDL_GetError());
+        return false;
+    }
+    return true;
+}
+
+#if (BFDEBUG_LEVEL > 3)
+static void present_stats_log(void)
+{
+    TbPresentStats stats;
+    LbScreenGetPresentStats(&stats);
+    SYNCDBG(3,"Presented %lu frames, dropped %lu, failed %lu; latency last %lu us, max %lu us",
+        stats.frames_presented, stats.frames_dropped, stats.frames_failed,
+        stats.last_latency_us, stats.max_latency_us);
+}
+#endif
+
+/**
+ * Shows the frame converted by the present thread, if there is one.
+ * Has to be called by the thread which owns the window.
+ * @return Lb_SUCCESS if a frame was shown, Lb_OK if there was none, Lb_FAIL on error.
+ */
+TbResult LbScreenPresentReady(void)
+{
+    struct TbPresentQueue *pque = &present_queue;
+    if (pque->thread == NULL)
+        return Lb_OK;
+    SDL_LockMutex(pque->mutex);
+    int idx = pque->ready;
+    pque->ready = -1;
+    SDL_UnlockMutex(pque->mutex);
+    if (idx < 0)
+        return Lb_OK;
+    // Frame taken from ready slot belongs to this thread until it's passed to the present thread again
+    const struct TbPresentFrame *frame = &pque->frames[idx];
+    TbBool result = present_frame_on_window(frame);
+    Uint64 latency = (SDL_GetPerformanceCounter() - frame->swap_counter) * 1000000 / SDL_GetPerformanceFrequency();
+    SDL_LockMutex(pque->mutex);
+    if (result) {
+        pque->stats.frames_presented++;
+        pque->stats.last_latency_us = latency;
+        if (pque->stats.max_latency_us < latency)
+            pque->stats.max_latency_us = latency;
+    } else {
+        pque->stats.frames_failed++;
+    }
+    SDL_UnlockMutex(pque->mutex);
+    return result ? Lb_SUCCESS : Lb_FAIL;
+}
+
+/**
+ * Stops the present thread, after the pending frame is shown.
+ * Needs to be called before the window or draw surface are changed.
+ */
+static void present_thread_stop(void)
+{
+    struct TbPresentQueue *pque = &present_queue;
+    if (pque->mutex == NULL)
+        return;
+    if (pque->thread != NULL)
+    {
+        LbScreenWaitPresented();
+        SDL_LockMutex(pque->mutex);
+        pque->exit = true;
+        SDL_CondBroadcast(pque->cond);
+        SDL_UnlockMutex(pque->mutex);
+        SDL_WaitThread(pque->thread, NULL);
+        pque->thread = NULL;
+#if (BFDEBUG_LEVEL > 3)
+        present_stats_log();
+#endif
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        LbMemoryFree(pque->frames[i].pixels);
+        pque->frames[i].pixels = NULL;
+        pque->frames[i].pixels_size = 0;
+        LbMemoryFree(pque->frames[i].converted);
+        pque->frames[i].converted = NULL;
+        pque->frames[i].converted_size = 0;
+    }
+    SDL_DestroyCond(pque->cond);
+    pque->cond = NULL;
+    SDL_DestroyMutex(pque->mutex);
+    pque->mutex = NULL;
+}
+
+/**
+ * Shows the previously converted frame, then copies draw surface into a free frame
+ * of the present queue and passes it to the present thread.
+ */
+static TbResult present_thread_swap(void)
+{
+    struct TbPresentQueue *pque = &present_queue;
+    LbScreenPresentReady();
+    SDL_LockMutex(pque->mutex);
+    int idx = pque->pending;
+    if (idx >= 0) {
+        // Previous frame wasn't taken yet; replace it
+        pque->pending = -1;
+        pque->stats.frames_dropped++;
+    } else {
+        for (idx = 0; idx < 3; idx++) {
+            if ((idx != pque->converting) && (idx != pque->ready))
+                break;
+        }
+    }
+    SDL_UnlockMutex(pque->mutex);
+    // Frame which is neither pending, converting nor ready belongs to this thread
+    struct TbPresentFrame *frame = &pque->frames[idx];
+    long width = lbDrawSurface->w;
+    long height = lbDrawSurface->h;
+    if (frame->pixels_size < (unsigned long)(width * height))
+    {
+        LbMemoryFree(frame->pixels);
+        frame->pixels = (unsigned char *)LbMemoryAlloc(width * height);
+        if (frame->pixels == NULL) {
+            frame->pixels_size = 0;
+            ERRORLOG("Cannot allocate present frame");
+            return Lb_FAIL;
+        }
+        frame->pixels_size = width * height;
+    }
+    if (SDL_MUSTLOCK(lbDrawSurface) && (SDL_LockSurface(lbDrawSurface) < 0)) {
+        ERRORLOG("Cannot lock draw surface: %s",SDL_GetError());
+        return Lb_FAIL;
+    }
+    const unsigned char *src = (const unsigned char *)lbDrawSurface->pixels;
+    for (long h = 0; h < height; h++) {
+        memcpy(frame->pixels + h * width, src + h * lbDrawSurface->pitch, width);
+    }
+    if (SDL_MUSTLOCK(lbDrawSurface))
+        SDL_UnlockSurface(lbDrawSurface);
+    frame->width = width;
+    frame->height = height;
+    memcpy(frame->palette, lbPaletteColors, sizeof(frame->palette));
+    frame->swap_counter = SDL_GetPerformanceCounter();
+    SDL_LockMutex(pque->mutex);
+    pque->pending = idx;
+    SDL_CondBroadcast(pque->cond);
+    SDL_UnlockMutex(pque->mutex);
+#if (BFDEBUG_LEVEL > 3)
+    static unsigned long swaps_count = 0;
+    swaps_count++;
+    if ((swaps_count % PRESENT_STATS_LOG_INTERVAL) == 0)
+        present_stats_log();
+#endif
+    return Lb_SUCCESS;
+}
+
+/**
+ * Waits until the present thread converts all frames passed to it, and shows the last one.
+ * Has to be called by the thread which owns the window.
+ */
+TbResult LbScreenWaitPresented(void)
+{
+    struct TbPresentQueue *pque = &present_queue;
+    if (pque->thread == NULL)
+        return Lb_SUCCESS;
+    SDL_LockMutex(pque->mutex);
+    while ((pque->pending >= 0) || (pque->converting >= 0))
+        SDL_CondWait(pque->cond, pque->mutex);
+    SDL_UnlockMutex(pque->mutex);
+    LbScreenPresentReady();
+    return Lb_SUCCESS;
+}
+
+void LbScreenGetPresentStats(TbPresentStats *stats)
+{
+    struct TbPresentQueue *pque = &present_queue;
+    if (pque->mutex == NULL) {
+        *stats = pque->stats;
+        return;
+    }
+    SDL_LockMutex(pque->mutex);
+    *stats = pque->stats;
+    SDL_UnlockMutex(pque->mutex);
+}
+/******************************************************************************/
+/******************************************************************************/
 void *LbExeReferenceNumber(void)
 {
   return NULL;
@@ -112,6 +496,12 @@ TbResult LbScreenSwap(void)
     int blresult;
     SYNCDBG(12,"Starting");
     TbResult ret = LbMouseOnBeginSwap();
+    // With a separate draw surface, conversion and window update are done by present thread
+    if ((ret == Lb_SUCCESS) && (lbHasSecondSurface) && present_thread_start()) {
+        ret = present_thread_swap();
+        LbMouseOnEndSwap();
+        return ret;
+    }
     // Put the data from Draw Surface onto Screen Surface
     if ((ret == Lb_SUCCESS) && (lbHasSecondSurface)) {
         // Update pointer to window surface on every frame
@@ -411,6 +801,9 @@ TbResult LbScreenSetup(TbScreenMode mode, TbScreenCoord width, TbScreenCoord hei
         msspr = lbDisplay.MouseSprite;
         GetPointerHotspot(&hot_x,&hot_y);
     }
+    present_thread_stop();
+    // Text layouts depend on screen size and fonts, which are reloaded for new mode
+    LbTextLayoutCacheClear();
     SDL_Surface* prevScreenSurf = lbScreenSurface;
     LbMouseChangeSprite(NULL);
 
@@ -644,6 +1037,7 @@ TbResult LbScreenReset(void)
 {
     if (!lbScreenInitialised)
       return Lb_FAIL;
+    present_thread_stop();
     LbMouseChangeSprite(NULL);
     if (lbHasSecondSurface) {
         SDL_FreeSurface(lbDrawSurface);
@@ -221,6 +221,18 @@ struct DisplayStructEx {
 };
 typedef struct DisplayStructEx TbDisplayStructEx;
 
+/** Statistics of frames shown by the present thread. */
+struct TbPresentStats {
+    unsigned long frames_presented;
+    /** Frames replaced by a newer one before the present thread got to them. */
+    unsigned long frames_dropped;
+    unsigned long frames_failed;
+    /** Time from LbScreenSwap() to window update of the last frame, in microseconds. */
+    unsigned long last_latency_us;
+    unsigned long max_latency_us;
+};
+typedef struct TbPresentStats TbPresentStats;
+
 struct SSurface;
 typedef struct SSurface TSurface;
 
@@ -299,6 +311,9 @@ TbResult LbScreenUnlock(void);
 TbBool LbScreenIsLocked(void);
 
 TbResult LbScreenSwap(void);
+TbResult LbScreenWaitPresented(void);
+TbResult LbScreenPresentReady(void);
+void LbScreenGetPresentStats(TbPresentStats *stats);
 TbResult LbScreenClear(TbPixel colour);
 TbResult LbScreenWaitVbi(void);
 
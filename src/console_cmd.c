@@ -246,6 +246,20 @@ TbBool cmd_exec(PlayerNumber plyr_idx, char *msg)
     {
         message_add_fmt(plyr_idx, "turn %ld", game.play_gameturn);
         return true;
+    } else if (strcmp(parstr, "loglevel") == 0)
+    {
+        // Same as the -loglevel command line option; only affects the local log
+        if (pr2str == NULL)
+            return false;
+        const char * pr3str = cmd_strtok((char *)pr2str);
+        if (pr3str == NULL)
+            return false;
+        if (LbLogSetChannelLevel(pr2str, atoi(pr3str)) != Lb_SUCCESS) {
+            message_add_fmt(plyr_idx, "unknown log channel %s", pr2str);
+            return false;
+        }
+        message_add_fmt(plyr_idx, "log level of %s is %d", pr2str, atoi(pr3str));
+        return true;
     } else if ((game.flags_font & FFlg_AlexCheat) != 0)
     {
         if (strcmp(parstr, "compuchat") == 0)
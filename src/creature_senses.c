@@ -20,6 +20,7 @@
 #include "globals.h"
 
 #include "bflib_math.h"
+#include "bflib_memory.h"
 #include "bflib_planar.h"
 #include "creature_states.h"
 #include "thing_list.h"
@@ -31,11 +32,15 @@
 #include "config_rules.h"
 #include "config_settings.h"
 #include "map_blocks.h"
+#include "slab_data.h"
 #include "game_legacy.h"
 
 /******************************************************************************/
 DLLIMPORT unsigned char _DK_line_of_sight_2d(const struct Coord3d *pos1, const struct Coord3d *pos2);
 /******************************************************************************/
+/** Results of line of sight checks made during current game turn. */
+static struct LineOfSightCacheEntry los_cache[LINE_OF_SIGHT_CACHE_SIZE];
+/******************************************************************************/
 TbBool sibling_line_of_sight_ignoring_door(const struct Coord3d *prevpos,
     const struct Coord3d *nextpos, const struct Thing *doortng)
 {
@@ -138,7 +143,7 @@ TbBool sibling_line_of_sight_ignoring_door(const struct Coord3d *prevpos,
 }
 
 
-TbBool line_of_sight_3d_ignoring_specific_door(const struct Coord3d *frpos,
+static TbBool line_of_sight_3d_ignoring_specific_door_uncached(const struct Coord3d *frpos,
     const struct Coord3d *topos, const struct Thing *doortng)
 {
     MapCoordDelta dx = topos->x.val - (MapCoordDelta)frpos->x.val;
@@ -317,7 +322,7 @@ TbBool sibling_line_of_sight_3d_including_lava_check_ignoring_door(const struct
     return true;
 }
 
-TbBool jonty_line_of_sight_3d_including_lava_check_ignoring_specific_door(const struct Coord3d *frpos,
+static TbBool jonty_line_of_sight_3d_including_lava_check_ignoring_specific_door_uncached(const struct Coord3d *frpos,
     const struct Coord3d *topos, const struct Thing *doortng)
 {
     MapCoordDelta dx = topos->x.val - (MapCoordDelta)frpos->x.val;
@@ -492,7 +497,7 @@ TbBool sibling_line_of_sight_3d_including_lava_check_ignoring_own_door(const str
     return true;
 }
 
-TbBool jonty_line_of_sight_3d_including_lava_check_ignoring_own_door(const struct Coord3d *frpos,
+static TbBool jonty_line_of_sight_3d_including_lava_check_ignoring_own_door_uncached(const struct Coord3d *frpos,
     const struct Coord3d *topos, PlayerNumber plyr_idx)
 {
     MapCoordDelta dx = topos->x.val - (MapCoordDelta)frpos->x.val;
@@ -677,12 +682,7 @@ TbBool jonty_creature_can_see_thing_including_lava_check(const struct Thing *cre
     }
 }
 
-TbBool line_of_sight_2d(const struct Coord3d *pos1, const struct Coord3d *pos2)
-{
-    return _DK_line_of_sight_2d(pos1, pos2);
-}
-
-TbBool line_of_sight_3d(const struct Coord3d *frpos, const struct Coord3d *topos)
+static TbBool line_of_sight_3d_uncached(const struct Coord3d *frpos, const struct Coord3d *topos)
 {
     MapCoordDelta dx = topos->x.val - (MapCoordDelta)frpos->x.val;
     MapCoordDelta dy = topos->y.val - (MapCoordDelta)frpos->y.val;
@@ -772,7 +772,7 @@ TbBool line_of_sight_3d(const struct Coord3d *frpos, const struct Coord3d *topos
     return true;
 }
 
-TbBool nowibble_line_of_sight_3d(const struct Coord3d *frpos, const struct Coord3d *topos)
+static TbBool nowibble_line_of_sight_3d_uncached(const struct Coord3d *frpos, const struct Coord3d *topos)
 {
     MapCoordDelta dx,dy,dz;
     dx = topos->x.val - (MapCoordDelta)frpos->x.val;
@@ -879,6 +879,115 @@ TbBool nowibble_line_of_sight_3d(const struct Coord3d *frpos, const struct Coord
     return true;
 }
 
+/**
+ * Clears line of sight cache. Needs to be called when game turn counter is no longer
+ * increasing, ie. when a level is started or loaded.
+ */
+void clear_line_of_sight_cache(void)
+{
+    LbMemorySet(los_cache, 0, sizeof(los_cache));
+}
+
+static struct LineOfSightCacheEntry *get_line_of_sight_cache_entry(unsigned char kind, long param,
+    const struct Coord3d *frpos, const struct Coord3d *topos)
+{
+    unsigned long hash = kind;
+    hash = (hash * 31 + param) * 2654435761UL;
+    hash = (hash ^ (frpos->x.val & 0xFFFF) ^ ((frpos->y.val & 0xFFFF) << 16)) * 2654435761UL;
+    hash = (hash ^ (topos->x.val & 0xFFFF) ^ ((topos->y.val & 0xFFFF) << 16)) * 2654435761UL;
+    hash = (hash ^ (frpos->z.val & 0xFFFF) ^ ((topos->z.val & 0xFFFF) << 16)) * 2654435761UL;
+    return &los_cache[(hash >> 16) & (LINE_OF_SIGHT_CACHE_SIZE-1)];
+}
+
+/**
+ * Checks if line of sight between given points was already computed in this game turn,
+ * and map blocks or doors haven't changed since.
+ */
+static TbBool line_of_sight_cached(struct LineOfSightCacheEntry *lsce, unsigned char kind, long param,
+    const struct Coord3d *frpos, const struct Coord3d *topos)
+{
+    return (lsce->kind == kind) && (lsce->turn == game.play_gameturn) && (lsce->param == param)
+        && (lsce->map_generation == get_map_blocks_generation())
+        && (lsce->frpos.x.val == frpos->x.val) && (lsce->frpos.y.val == frpos->y.val) && (lsce->frpos.z.val == frpos->z.val)
+        && (lsce->topos.x.val == topos->x.val) && (lsce->topos.y.val == topos->y.val) && (lsce->topos.z.val == topos->z.val);
+}
+
+static TbBool line_of_sight_store(struct LineOfSightCacheEntry *lsce, unsigned char kind, long param,
+    const struct Coord3d *frpos, const struct Coord3d *topos, TbBool result)
+{
+    lsce->kind = kind;
+    lsce->turn = game.play_gameturn;
+    lsce->map_generation = get_map_blocks_generation();
+    lsce->param = param;
+    lsce->frpos.x.val = frpos->x.val;
+    lsce->frpos.y.val = frpos->y.val;
+    lsce->frpos.z.val = frpos->z.val;
+    lsce->topos.x.val = topos->x.val;
+    lsce->topos.y.val = topos->y.val;
+    lsce->topos.z.val = topos->z.val;
+    lsce->result = result;
+    return result;
+}
+
+TbBool line_of_sight_2d(const struct Coord3d *pos1, const struct Coord3d *pos2)
+{
+    struct LineOfSightCacheEntry* lsce = get_line_of_sight_cache_entry(LoSK_2D, 0, pos1, pos2);
+    if (line_of_sight_cached(lsce, LoSK_2D, 0, pos1, pos2))
+        return lsce->result;
+    return line_of_sight_store(lsce, LoSK_2D, 0, pos1, pos2, _DK_line_of_sight_2d(pos1, pos2));
+}
+
+TbBool line_of_sight_3d(const struct Coord3d *frpos, const struct Coord3d *topos)
+{
+    struct LineOfSightCacheEntry* lsce = get_line_of_sight_cache_entry(LoSK_3D, 0, frpos, topos);
+    if (line_of_sight_cached(lsce, LoSK_3D, 0, frpos, topos))
+        return lsce->result;
+    return line_of_sight_store(lsce, LoSK_3D, 0, frpos, topos, line_of_sight_3d_uncached(frpos, topos));
+}
+
+TbBool nowibble_line_of_sight_3d(const struct Coord3d *frpos, const struct Coord3d *topos)
+{
+    struct LineOfSightCacheEntry* lsce = get_line_of_sight_cache_entry(LoSK_3DNoWibble, 0, frpos, topos);
+    if (line_of_sight_cached(lsce, LoSK_3DNoWibble, 0, frpos, topos))
+        return lsce->result;
+    return line_of_sight_store(lsce, LoSK_3DNoWibble, 0, frpos, topos, nowibble_line_of_sight_3d_uncached(frpos, topos));
+}
+
+TbBool line_of_sight_3d_ignoring_specific_door(const struct Coord3d *frpos,
+    const struct Coord3d *topos, const struct Thing *doortng)
+{
+    // Handle rather than index, so a new door re-using the slot within this turn does not match
+    long param = thing_get_handle(doortng);
+    struct LineOfSightCacheEntry* lsce = get_line_of_sight_cache_entry(LoSK_3DSpecificDoor, param, frpos, topos);
+    if (line_of_sight_cached(lsce, LoSK_3DSpecificDoor, param, frpos, topos))
+        return lsce->result;
+    return line_of_sight_store(lsce, LoSK_3DSpecificDoor, param, frpos, topos,
+        line_of_sight_3d_ignoring_specific_door_uncached(frpos, topos, doortng));
+}
+
+TbBool jonty_line_of_sight_3d_including_lava_check_ignoring_specific_door(const struct Coord3d *frpos,
+    const struct Coord3d *topos, const struct Thing *doortng)
+{
+    // Handle rather than index, so a new door re-using the slot within this turn does not match
+    long param = thing_get_handle(doortng);
+    struct LineOfSightCacheEntry* lsce = get_line_of_sight_cache_entry(LoSK_3DLavaSpecificDoor, param, frpos, topos);
+    if (line_of_sight_cached(lsce, LoSK_3DLavaSpecificDoor, param, frpos, topos))
+        return lsce->result;
+    return line_of_sight_store(lsce, LoSK_3DLavaSpecificDoor, param, frpos, topos,
+        jonty_line_of_sight_3d_including_lava_check_ignoring_specific_door_uncached(frpos, topos, doortng));
+}
+
+TbBool jonty_line_of_sight_3d_including_lava_check_ignoring_own_door(const struct Coord3d *frpos,
+    const struct Coord3d *topos, PlayerNumber plyr_idx)
+{
+    long param = plyr_idx;
+    struct LineOfSightCacheEntry* lsce = get_line_of_sight_cache_entry(LoSK_3DLavaOwnDoor, param, frpos, topos);
+    if (line_of_sight_cached(lsce, LoSK_3DLavaOwnDoor, param, frpos, topos))
+        return lsce->result;
+    return line_of_sight_store(lsce, LoSK_3DLavaOwnDoor, param, frpos, topos,
+        jonty_line_of_sight_3d_including_lava_check_ignoring_own_door_uncached(frpos, topos, plyr_idx));
+}
+
 long get_explore_sight_distance_in_slabs(const struct Thing *thing)
 {
     if (!thing_exists(thing)) {
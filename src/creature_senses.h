@@ -27,12 +27,34 @@ extern "C" {
 #endif
 
 /******************************************************************************/
+#define LINE_OF_SIGHT_CACHE_SIZE 4096
+/******************************************************************************/
+enum LineOfSightKinds {
+    LoSK_None = 0,
+    LoSK_2D,
+    LoSK_3D,
+    LoSK_3DNoWibble,
+    LoSK_3DSpecificDoor,
+    LoSK_3DLavaSpecificDoor,
+    LoSK_3DLavaOwnDoor,
+};
+
 #pragma pack(1)
 
 struct Thing;
 
 #pragma pack()
 /******************************************************************************/
+struct LineOfSightCacheEntry {
+    GameTurn turn;
+    unsigned long map_generation;
+    unsigned char kind;
+    TbBool result;
+    long param;
+    struct Coord3d frpos;
+    struct Coord3d topos;
+};
+/******************************************************************************/
 TbBool jonty_creature_can_see_thing_including_lava_check(const struct Thing *creatng, const struct Thing *thing);
 TbBool sibling_line_of_sight_ignoring_door(const struct Coord3d *prevpos,
     const struct Coord3d *nextpos, const struct Thing *doortng);
@@ -42,6 +64,11 @@ TbBool line_of_sight_3d(const struct Coord3d *frpos, const struct Coord3d *topos
 TbBool line_of_sight_2d(const struct Coord3d *pos1, const struct Coord3d *pos2);
 TbBool line_of_sight_3d_ignoring_specific_door(const struct Coord3d *frpos, const struct Coord3d *topos, const struct Thing *doortng);
 TbBool nowibble_line_of_sight_3d(const struct Coord3d *frpos, const struct Coord3d *topos);
+TbBool jonty_line_of_sight_3d_including_lava_check_ignoring_specific_door(const struct Coord3d *frpos,
+    const struct Coord3d *topos, const struct Thing *doortng);
+TbBool jonty_line_of_sight_3d_including_lava_check_ignoring_own_door(const struct Coord3d *frpos,
+    const struct Coord3d *topos, PlayerNumber plyr_idx);
+void clear_line_of_sight_cache(void);
 
 long get_explore_sight_distance_in_slabs(const struct Thing *thing);
 /******************************************************************************/
@@ -4625,6 +4625,23 @@ void process_person_moods_and_needs(struct Thing *thing)
     process_piss_need(thing, crstat);
 }
 
+/**
+ * Processes the part of creature needs which changes every turn, without trying to satisfy any need.
+ * Used instead of process_person_moods_and_needs() on turns when the creature doesn't re-evaluate its needs.
+ */
+void process_person_needs_counters(struct Thing *thing)
+{
+    if (is_hero_thing(thing) || is_neutral_thing(thing)) {
+        return;
+    }
+    if (creature_is_kept_in_custody(thing)) {
+        return;
+    }
+    struct CreatureStats* crstat = creature_stats_get_from_thing(thing);
+    process_creature_hunger(thing);
+    process_training_need(thing, crstat);
+}
+
 TbBool setup_move_off_lava(struct Thing* thing)
 {
     //return _DK_setup_move_off_lava(thing);
@@ -101,6 +101,10 @@ void clear_dungeons(void)
   LbMemorySet(&bad_dungeon, 0, sizeof(struct Dungeon));
   LbMemorySet(&bad_dungeonadd, 0, sizeof(struct DungeonAdd));
   bad_dungeon.owner = PLAYERS_COUNT;
+  for (int i = 0; i < DUNGEONS_COUNT; i++)
+  {
+      rebuild_task_list_index(i);
+  }
   game.field_14E4A4 = 0;
   game.field_14E4A0 = 0;
   game.field_14E49E = 0;
@@ -299,6 +299,10 @@ struct DungeonAdd
     struct TrapInfo       mnfct_info;
     struct BoxInfo        box_info;
     struct Coord3d        last_combat_location;
+    /** Map tasks which don't fit into Dungeon task_list; their indexes start at MAPTASKS_COUNT. */
+    struct MapTask        task_list_ext[MAPTASKS_EXT_COUNT];
+    /** Highest used task index plus one; Dungeon field of the same name is limited to MAPTASKS_COUNT. */
+    short                 highest_task_number;
 };
 /******************************************************************************/
 extern struct Dungeon bad_dungeon;
@@ -143,6 +143,22 @@ static int water_wibble_angle = 0;
 static unsigned long render_problems;
 static long render_prob_kind;
 static long sp_x, sp_y, sp_dx, sp_dy;
+
+/** Max distance, in 2D box metric, at which a light casts shadows of creatures. */
+#define SHADOW_LIGHT_MAX_DISTANCE 2560
+/** Size of light bins; with max distance as the size, lights casting shadows are always in neighbouring bins. */
+#define LIGHT_BIN_SIZE SHADOW_LIGHT_MAX_DISTANCE
+#define LIGHT_BINS_PER_SIDE ((65536 + LIGHT_BIN_SIZE - 1) / LIGHT_BIN_SIZE)
+
+struct LightBins {
+    /** Index of first entry of each bin within arrays below; last item marks the end. */
+    unsigned short bin_start[LIGHT_BINS_PER_SIDE*LIGHT_BINS_PER_SIDE+1];
+    unsigned short light_idx[LIGHTS_COUNT];
+    /** Position of the light within sweep of the lights lists. */
+    unsigned short sweep_order[LIGHTS_COUNT];
+};
+/** Lights put into map bins; rebuilt for every drawn view. */
+static struct LightBins light_bins;
 /******************************************************************************/
 #ifdef __cplusplus
 }
@@ -2295,6 +2311,7 @@ static TbBool add_light_to_nearest_list(struct NearestLights* nlgt, long* nlgt_d
     return true;
 }
 
+#if (BFDEBUG_LEVEL > 0)
 static void find_closest_lights_on_list(struct NearestLights *nlgt, long *nlgt_dist, const struct Coord3d *pos, ThingIndex list_start_idx)
 {
     long i;
@@ -2309,11 +2326,11 @@ static void find_closest_lights_on_list(struct NearestLights *nlgt, long *nlgt_d
         lgt = &game.lish.lights[i];
         i = lgt->field_26;
         // Per-light code
-        if ((lgt->flags & 1) != 0)
+        if ((lgt->flags & LgtF_Allocated) != 0)
         {
             long dist;
             dist = get_2d_box_distance(pos, &lgt->mappos);
-            if ((dist < 2560) && (nlgt_dist[settings.video_shadows-1] > dist)
+            if ((dist < SHADOW_LIGHT_MAX_DISTANCE) && (nlgt_dist[settings.video_shadows-1] > dist)
                 && (pos->x.val != lgt->mappos.x.val) && (pos->y.val != lgt->mappos.y.val))
             {
                 add_light_to_nearest_list(nlgt, nlgt_dist, lgt, dist);
@@ -2328,6 +2345,154 @@ static void find_closest_lights_on_list(struct NearestLights *nlgt, long *nlgt_d
         }
     }
 }
+#endif
+
+static long light_bin_coord(MapCoord pos)
+{
+    long n;
+    n = pos / LIGHT_BIN_SIZE;
+    if (n >= LIGHT_BINS_PER_SIDE)
+        n = LIGHT_BINS_PER_SIDE-1;
+    return n;
+}
+
+static long add_lights_list_to_bins(long *bin_of_entry, long count, ThingIndex list_start_idx)
+{
+    long i;
+    unsigned long k;
+    i = list_start_idx;
+    k = 0;
+    while (i > 0)
+    {
+        struct Light *lgt;
+        lgt = &game.lish.lights[i];
+        // Per-light code
+        if ((lgt->flags & LgtF_Allocated) != 0)
+        {
+            if (count >= LIGHTS_COUNT)
+            {
+                ERRORLOG("Too many lights to put into bins");
+                break;
+            }
+            light_bins.light_idx[count] = i;
+            bin_of_entry[count] = light_bin_coord(lgt->mappos.y.val) * LIGHT_BINS_PER_SIDE + light_bin_coord(lgt->mappos.x.val);
+            count++;
+        }
+        // Per-light code ends
+        i = lgt->field_26;
+        k++;
+        if (k > LIGHTS_COUNT)
+        {
+            ERRORLOG("Infinite loop detected when sweeping lights list");
+            break;
+        }
+    }
+    return count;
+}
+
+/**
+ * Puts lights into map bins, so that closest lights search doesn't have to sweep all lights.
+ * Needs to be called before drawing things, once per drawn view.
+ * Within each bin, lights are kept in order of the lights lists sweep.
+ */
+static void update_light_bins(void)
+{
+    long bin_of_entry[LIGHTS_COUNT];
+    unsigned short sweep_idx[LIGHTS_COUNT];
+    long count;
+    long i;
+    count = add_lights_list_to_bins(bin_of_entry, 0, game.thing_lists[TngList_StaticLights].index);
+    count = add_lights_list_to_bins(bin_of_entry, count, game.thing_lists[TngList_DynamLights].index);
+    // Counting sort by bin; stable, so the sweep order is kept within bins
+    LbMemorySet(light_bins.bin_start, 0, sizeof(light_bins.bin_start));
+    for (i = 0; i < count; i++) {
+        light_bins.bin_start[bin_of_entry[i]+1]++;
+    }
+    for (i = 0; i < LIGHT_BINS_PER_SIDE*LIGHT_BINS_PER_SIDE; i++) {
+        light_bins.bin_start[i+1] += light_bins.bin_start[i];
+    }
+    for (i = 0; i < count; i++) {
+        sweep_idx[i] = light_bins.light_idx[i];
+    }
+    unsigned short bin_pos[LIGHT_BINS_PER_SIDE*LIGHT_BINS_PER_SIDE];
+    LbMemoryCopy(bin_pos, light_bins.bin_start, sizeof(bin_pos));
+    for (i = 0; i < count; i++)
+    {
+        long n;
+        n = bin_pos[bin_of_entry[i]]++;
+        light_bins.light_idx[n] = sweep_idx[i];
+        light_bins.sweep_order[n] = i;
+    }
+}
+
+/**
+ * Finds closest lights using map bins. Visits lights from bins around the position
+ * in order of the lights lists sweep, so the result is identical to sweeping the lists.
+ */
+static void find_closest_lights_in_bins(struct NearestLights *nlgt, long *nlgt_dist, const struct Coord3d *pos)
+{
+    unsigned short cursor[9];
+    unsigned short cursor_end[9];
+    long bin_x;
+    long bin_y;
+    long cur_count;
+    long bx;
+    long by;
+    if (settings.video_shadows < 1)
+        return;
+    // Any light closer than the max distance is within the neighbouring bins
+    bin_x = light_bin_coord(pos->x.val);
+    bin_y = light_bin_coord(pos->y.val);
+    cur_count = 0;
+    for (by = bin_y-1; by <= bin_y+1; by++)
+    {
+        if ((by < 0) || (by >= LIGHT_BINS_PER_SIDE))
+            continue;
+        for (bx = bin_x-1; bx <= bin_x+1; bx++)
+        {
+            long n;
+            if ((bx < 0) || (bx >= LIGHT_BINS_PER_SIDE))
+                continue;
+            n = by * LIGHT_BINS_PER_SIDE + bx;
+            if (light_bins.bin_start[n] < light_bins.bin_start[n+1])
+            {
+                cursor[cur_count] = light_bins.bin_start[n];
+                cursor_end[cur_count] = light_bins.bin_start[n+1];
+                cur_count++;
+            }
+        }
+    }
+    // Merge the bins by sweep order
+    while (cur_count > 0)
+    {
+        struct Light *lgt;
+        long best;
+        long i;
+        best = 0;
+        for (i = 1; i < cur_count; i++)
+        {
+            if (light_bins.sweep_order[cursor[i]] < light_bins.sweep_order[cursor[best]])
+                best = i;
+        }
+        lgt = &game.lish.lights[light_bins.light_idx[cursor[best]]];
+        cursor[best]++;
+        if (cursor[best] >= cursor_end[best])
+        {
+            cur_count--;
+            cursor[best] = cursor[cur_count];
+            cursor_end[best] = cursor_end[cur_count];
+        }
+        // Per-light code
+        long dist;
+        dist = get_2d_box_distance(pos, &lgt->mappos);
+        if ((dist < SHADOW_LIGHT_MAX_DISTANCE) && (nlgt_dist[settings.video_shadows-1] > dist)
+            && (pos->x.val != lgt->mappos.x.val) && (pos->y.val != lgt->mappos.y.val))
+        {
+            add_light_to_nearest_list(nlgt, nlgt_dist, lgt, dist);
+        }
+        // Per-light code ends
+    }
+}
 
 static long find_closest_lights(const struct Coord3d* pos, struct NearestLights* nlgt)
 {
@@ -2338,16 +2503,38 @@ static long find_closest_lights(const struct Coord3d* pos, struct NearestLights*
     for (i = 0; i < SHADOW_SOURCES_MAX_COUNT; i++) {
         nlgt_dist[i] = LONG_MAX;
     }
-    i = game.thing_lists[TngList_StaticLights].index;
-    find_closest_lights_on_list(nlgt, nlgt_dist, pos, i);
-    i = game.thing_lists[TngList_DynamLights].index;
-    find_closest_lights_on_list(nlgt, nlgt_dist, pos, i);
+    find_closest_lights_in_bins(nlgt, nlgt_dist, pos);
     count = 0;
     for (i = 0; i < SHADOW_SOURCES_MAX_COUNT; i++) {
         if (nlgt_dist[i] == LONG_MAX)
             break;
         count++;
     }
+#if (BFDEBUG_LEVEL > 0)
+    {
+        // Verify the bins against sweeping whole lights lists
+        struct NearestLights chk_nlgt;
+        long chk_dist[SHADOW_SOURCES_MAX_COUNT];
+        for (i = 0; i < SHADOW_SOURCES_MAX_COUNT; i++) {
+            chk_dist[i] = LONG_MAX;
+        }
+        find_closest_lights_on_list(&chk_nlgt, chk_dist, pos, game.thing_lists[TngList_StaticLights].index);
+        find_closest_lights_on_list(&chk_nlgt, chk_dist, pos, game.thing_lists[TngList_DynamLights].index);
+        for (i = 0; i < count; i++)
+        {
+            if ((chk_dist[i] != nlgt_dist[i]) || (chk_nlgt.coord[i].x.val != nlgt->coord[i].x.val)
+              || (chk_nlgt.coord[i].y.val != nlgt->coord[i].y.val) || (chk_nlgt.coord[i].z.val != nlgt->coord[i].z.val))
+            {
+                ERRORLOG("Light bins result differs from lights lists at (%d,%d), entry %d",
+                    (int)pos->x.val, (int)pos->y.val, (int)i);
+                break;
+            }
+        }
+        if ((count < SHADOW_SOURCES_MAX_COUNT) && (chk_dist[count] != LONG_MAX)) {
+            ERRORLOG("Light bins missed a light at (%d,%d)",(int)pos->x.val, (int)pos->y.val);
+        }
+    }
+#endif
     return count;
 }
 
@@ -4792,6 +4979,7 @@ void draw_view(struct Camera *cam, unsigned char a2)
     y = cam->mappos.y.val;
     z = cam->mappos.z.val;
     frame_wibble_generate();
+    update_light_bins();
     view_alt = z;
     if (lens_mode != 0)
     {
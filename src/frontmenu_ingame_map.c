@@ -54,6 +54,18 @@ long *MapShapeStart = NULL;
 long *MapShapeEnd = NULL;
 long MapDiagonalLength = 0;
 const TbPixel RoomColours[] = {132, 92, 164, 183, 21, 132};
+/**
+ * Rotated minimap cache; for every pixel, stores index into PannelColours.
+ * Rebuilt only when camera, zoom or PannelMap changes.
+ */
+unsigned short *MapSampleCache = NULL;
+long *MapSampleStart = NULL;
+long *MapSampleEnd = NULL;
+struct MinimapSampleCacheKey MapSampleCacheKey;
+/** Incremented on every change of PannelMap, to invalidate the rotated cache. */
+unsigned long PannelMapGeneration = 1;
+/** Creature and trap dots, gathered once per game turn and only rotated when drawing. */
+struct MinimapOverlayList MapOverlayList;
 /******************************************************************************/
 void pannel_map_draw_pixel(RealScreenCoord x, RealScreenCoord y, TbPixel col)
 {
@@ -222,22 +234,32 @@ int draw_overlay_call_to_arms(struct PlayerInfo *player, long units_per_px, long
     return n;
 }
 
+static struct MinimapOverlayDot *add_overlay_dot(struct MinimapOverlayList *ovlist, MapCoord pos_x, MapCoord pos_y, unsigned char shape, TbPixel col)
+{
+    if (ovlist->dots_count >= MINIMAP_OVERLAY_DOTS_COUNT)
+        return NULL;
+    struct MinimapOverlayDot *dot;
+    dot = &ovlist->dots[ovlist->dots_count];
+    ovlist->dots_count++;
+    dot->pos_x = pos_x;
+    dot->pos_y = pos_y;
+    dot->shape = shape;
+    dot->col = col;
+    return dot;
+}
+
 /**
- * Draws all owned traps on minimap.
+ * Gathers all owned traps into minimap overlay list.
+ * @param ovlist The list to be filled.
  * @param player The player for whom drawing occurs.
- * @param zoom Scale between map coordinates and minimap pixels.
- * @return Amount of traps drawn.
+ * @return Amount of traps gathered.
  */
-int draw_overlay_traps(struct PlayerInfo *player, long units_per_px, long zoom)
+int gather_overlay_traps(struct MinimapOverlayList *ovlist, struct PlayerInfo *player)
 {
     unsigned long k;
     int i;
     int n;
     SYNCDBG(18,"Starting");
-    if (player->acamera == NULL)
-        return 0;
-    const struct Camera *cam;
-    cam = player->acamera;
     n = 0;
     k = 0;
     const struct StructureList *slist;
@@ -256,20 +278,6 @@ int draw_overlay_traps(struct PlayerInfo *player, long units_per_px, long zoom)
         // Per-thing code
         if (player->id_number == thing->owner)
         {
-            // Position of the thing on unrotated map
-            // for camera, coordinates within subtile are skipped; the thing uses full resolution coordinates
-            long zmpos_x;
-            long zmpos_y;
-            zmpos_x = (thing->mappos.x.val - (MapCoordDelta)subtile_coord(cam->mappos.x.stl.num,0)) / zoom;
-            zmpos_y = (thing->mappos.y.val - (MapCoordDelta)subtile_coord(cam->mappos.y.stl.num,0)) / zoom;
-            // Now rotate the coordinates to receive minimap points
-            RealScreenCoord mapos_x;
-            RealScreenCoord mapos_y;
-            mapos_x = (zmpos_x * LbCosL(cam->orient_a) + zmpos_y * LbSinL(cam->orient_a)) >> 16;
-            mapos_y = (zmpos_y * LbCosL(cam->orient_a) - zmpos_x * LbSinL(cam->orient_a)) >> 16;
-            RealScreenCoord basepos;
-            basepos = MapDiagonalLength/2;
-            // Do the drawing
             if ((thing->byte_18) || (player->id_number == thing->owner))
             {
                 TbPixel col;
@@ -278,11 +286,7 @@ int draw_overlay_traps(struct PlayerInfo *player, long units_per_px, long zoom)
                 } else {
                     col = 60;
                 }
-                pannel_map_draw_pixel(mapos_x+basepos,   mapos_y+basepos,   col);
-                pannel_map_draw_pixel(mapos_x+basepos-1, mapos_y+basepos,   col);
-                pannel_map_draw_pixel(mapos_x+basepos+1, mapos_y+basepos,   col);
-                pannel_map_draw_pixel(mapos_x+basepos,   mapos_y+basepos+1, col);
-                pannel_map_draw_pixel(mapos_x+basepos,   mapos_y+basepos-1, col);
+                add_overlay_dot(ovlist, thing->mappos.x.val, thing->mappos.y.val, MMDot_Cross, col);
                 n++;
             }
         }
@@ -433,22 +437,18 @@ void pannel_map_draw_creature_dot(long mapos_x, long mapos_y, RealScreenCoord ba
     }*/
 }
 
-int draw_overlay_creatures(struct PlayerInfo *player, long units_per_px, long zoom, long basic_zoom)
+/**
+ * Gathers creatures, and hero tunnelers parties, into minimap overlay list.
+ * @param ovlist The list to be filled.
+ * @param player The player for whom drawing occurs.
+ * @return Amount of creatures gathered.
+ */
+int gather_overlay_creatures(struct MinimapOverlayList *ovlist, struct PlayerInfo *player)
 {
-    TbBool isLowRes = 0;
-    if (units_per_px <= 16)
-    {
-       isLowRes = 1;
-    }
-
     unsigned long k;
     int i;
     int n;
     SYNCDBG(18,"Starting");
-    if (player->acamera == NULL)
-        return 0;
-    const struct Camera *cam;
-    cam = player->acamera;
     n = 0;
     k = 0;
     const struct StructureList *slist;
@@ -479,33 +479,14 @@ int draw_overlay_creatures(struct PlayerInfo *player, long units_per_px, long zo
                     col1 = player_room_colours[thing->owner];
                     col2 = player_room_colours[thing->owner];
                 }
-                // Position of the thing on unrotated map
-                // for camera, coordinates within subtile are skipped; the thing uses full resolution coordinates
-                long zmpos_x;
-                long zmpos_y;
-                zmpos_x = (thing->mappos.x.val - (MapCoordDelta)subtile_coord(cam->mappos.x.stl.num,0)) / zoom;
-                zmpos_y = (thing->mappos.y.val - (MapCoordDelta)subtile_coord(cam->mappos.y.stl.num,0)) / zoom;
-                // Now rotate the coordinates to receive minimap points
-                long mapos_x;
-                long mapos_y;
-                mapos_x = (zmpos_x * LbCosL(cam->orient_a) + zmpos_y * LbSinL(cam->orient_a)) >> 16;
-                mapos_y = (zmpos_y * LbCosL(cam->orient_a) - zmpos_x * LbSinL(cam->orient_a)) >> 16;
-                RealScreenCoord basepos;
-                basepos = MapDiagonalLength/2;
-                // Do the drawing
                 if (thing->owner == player->id_number)
                 {
                     if ((thing->model == gui_creature_type_highlighted) && (game.play_gameturn & 1))
                     {
-                        pannel_map_draw_pixel(mapos_x+basepos,   mapos_y+basepos,   31);
-                        pannel_map_draw_pixel(mapos_x+basepos-1, mapos_y+basepos,   col2);
-                        pannel_map_draw_pixel(mapos_x+basepos+1, mapos_y+basepos,   col2);
-                        pannel_map_draw_pixel(mapos_x+basepos,   mapos_y+basepos,   col2);
-                        pannel_map_draw_pixel(mapos_x+basepos,   mapos_y+basepos-1, col2);
-
+                        add_overlay_dot(ovlist, thing->mappos.x.val, thing->mappos.y.val, MMDot_HighlightCross, col2);
                     } else
                     {
-                        pannel_map_draw_creature_dot(mapos_x, mapos_y, basepos, col2, basic_zoom, isLowRes);
+                        add_overlay_dot(ovlist, thing->mappos.x.val, thing->mappos.y.val, MMDot_Creature, col2);
                     }
                 } else
                 {
@@ -514,8 +495,9 @@ int draw_overlay_creatures(struct PlayerInfo *player, long units_per_px, long zo
                     } else {
                         col = col1;
                     }
-                    pannel_map_draw_creature_dot(mapos_x, mapos_y, basepos, col, basic_zoom, isLowRes);
+                    add_overlay_dot(ovlist, thing->mappos.x.val, thing->mappos.y.val, MMDot_Creature, col);
                 }
+                n++;
             } else
             // Hero tunnelers may be visible on unrevealed terrain too (if on revealed, then they're already drawn)
             if (is_hero_tunnelling_to_attack(thing))
@@ -534,24 +516,15 @@ int draw_overlay_creatures(struct PlayerInfo *player, long units_per_px, long zo
                         col1 = player_room_colours[cctrl->party.target_plyr_idx];
                         col2 = player_room_colours[thing->owner];
                     }
-                    long zmpos_x;
-                    long zmpos_y;
-                    zmpos_x = ((stl_num_decode_x(memberpos) - (MapSubtlDelta)cam->mappos.x.stl.num) << 8) / zoom;
-                    zmpos_y = ((stl_num_decode_y(memberpos) - (MapSubtlDelta)cam->mappos.y.stl.num) << 8) / zoom;
-                    long mapos_x;
-                    long mapos_y;
-                    mapos_x = (zmpos_x * LbCosL(cam->orient_a) + zmpos_y * LbSinL(cam->orient_a)) >> 16;
-                    mapos_y = (zmpos_y * LbCosL(cam->orient_a) - zmpos_x * LbSinL(cam->orient_a)) >> 16;
-                    RealScreenCoord basepos;
-                    basepos = MapDiagonalLength/2;
-                    // Do the drawing
                     if (thing->owner == player->id_number) {
                         col = col2;
                     } else {
                         col = col1;
                     }
-                    pannel_map_draw_creature_dot(mapos_x, mapos_y, basepos, col, basic_zoom, isLowRes);
+                    add_overlay_dot(ovlist, subtile_coord(stl_num_decode_x(memberpos),0),
+                        subtile_coord(stl_num_decode_y(memberpos),0), MMDot_Creature, col);
                 }
+                n++;
             }
         }
         // Per-thing code ends
@@ -565,6 +538,117 @@ int draw_overlay_creatures(struct PlayerInfo *player, long units_per_px, long zo
     return n;
 }
 
+/**
+ * Makes sure the overlay list contains creatures and traps for current game turn.
+ * Things only move between game turns, so the list is gathered once per turn.
+ */
+void update_overlay_list(struct PlayerInfo *player)
+{
+    struct MinimapOverlayList *ovlist;
+    ovlist = &MapOverlayList;
+    if ((ovlist->gameturn == game.play_gameturn) && (ovlist->plyr_idx == player->id_number)
+     && (ovlist->creature_highlight == gui_creature_type_highlighted)
+     && (ovlist->trap_highlight == gui_trap_type_highlighted) && (ovlist->dots_count > 0)) {
+        return;
+    }
+    ovlist->gameturn = game.play_gameturn;
+    ovlist->plyr_idx = player->id_number;
+    ovlist->creature_highlight = gui_creature_type_highlighted;
+    ovlist->trap_highlight = gui_trap_type_highlighted;
+    ovlist->dots_count = 0;
+    gather_overlay_traps(ovlist, player);
+    ovlist->traps_end = ovlist->dots_count;
+    gather_overlay_creatures(ovlist, player);
+}
+
+/**
+ * Draws overlay dots from given range of the overlay list.
+ * @param first Index of the first dot to draw.
+ * @param last Index after the last dot to draw.
+ * @return Amount of dots drawn.
+ */
+int draw_overlay_dots(struct PlayerInfo *player, long units_per_px, long zoom, long basic_zoom, int first, int last)
+{
+    TbBool isLowRes = 0;
+    if (units_per_px <= 16)
+    {
+       isLowRes = 1;
+    }
+    if (player->acamera == NULL)
+        return 0;
+    const struct Camera *cam;
+    cam = player->acamera;
+    long cos_a;
+    long sin_a;
+    cos_a = LbCosL(cam->orient_a);
+    sin_a = LbSinL(cam->orient_a);
+    // for camera, coordinates within subtile are skipped; the thing uses full resolution coordinates
+    MapCoordDelta cam_x;
+    MapCoordDelta cam_y;
+    cam_x = subtile_coord(cam->mappos.x.stl.num,0);
+    cam_y = subtile_coord(cam->mappos.y.stl.num,0);
+    RealScreenCoord basepos;
+    basepos = MapDiagonalLength/2;
+    int i;
+    for (i = first; i < last; i++)
+    {
+        const struct MinimapOverlayDot *dot;
+        dot = &MapOverlayList.dots[i];
+        // Position of the thing on unrotated map
+        long zmpos_x;
+        long zmpos_y;
+        zmpos_x = (dot->pos_x - cam_x) / zoom;
+        zmpos_y = (dot->pos_y - cam_y) / zoom;
+        // Now rotate the coordinates to receive minimap points
+        long mapos_x;
+        long mapos_y;
+        mapos_x = (zmpos_x * cos_a + zmpos_y * sin_a) >> 16;
+        mapos_y = (zmpos_y * cos_a - zmpos_x * sin_a) >> 16;
+        // Do the drawing
+        switch (dot->shape)
+        {
+        case MMDot_Creature:
+            pannel_map_draw_creature_dot(mapos_x, mapos_y, basepos, dot->col, basic_zoom, isLowRes);
+            break;
+        case MMDot_HighlightCross:
+            pannel_map_draw_pixel(mapos_x+basepos,   mapos_y+basepos,   31);
+            pannel_map_draw_pixel(mapos_x+basepos-1, mapos_y+basepos,   dot->col);
+            pannel_map_draw_pixel(mapos_x+basepos+1, mapos_y+basepos,   dot->col);
+            pannel_map_draw_pixel(mapos_x+basepos,   mapos_y+basepos,   dot->col);
+            pannel_map_draw_pixel(mapos_x+basepos,   mapos_y+basepos-1, dot->col);
+            break;
+        case MMDot_Cross:
+            pannel_map_draw_pixel(mapos_x+basepos,   mapos_y+basepos,   dot->col);
+            pannel_map_draw_pixel(mapos_x+basepos-1, mapos_y+basepos,   dot->col);
+            pannel_map_draw_pixel(mapos_x+basepos+1, mapos_y+basepos,   dot->col);
+            pannel_map_draw_pixel(mapos_x+basepos,   mapos_y+basepos+1, dot->col);
+            pannel_map_draw_pixel(mapos_x+basepos,   mapos_y+basepos-1, dot->col);
+            break;
+        }
+    }
+    return last - first;
+}
+
+/**
+ * Draws all owned traps on minimap.
+ * @param player The player for whom drawing occurs.
+ * @param zoom Scale between map coordinates and minimap pixels.
+ * @return Amount of traps drawn.
+ */
+int draw_overlay_traps(struct PlayerInfo *player, long units_per_px, long zoom)
+{
+    SYNCDBG(18,"Starting");
+    update_overlay_list(player);
+    return draw_overlay_dots(player, units_per_px, zoom, 0, 0, MapOverlayList.traps_end);
+}
+
+int draw_overlay_creatures(struct PlayerInfo *player, long units_per_px, long zoom, long basic_zoom)
+{
+    SYNCDBG(18,"Starting");
+    update_overlay_list(player);
+    return draw_overlay_dots(player, units_per_px, zoom, basic_zoom, MapOverlayList.traps_end, MapOverlayList.dots_count);
+}
+
 /**
  * Draws own dungeon heart line on minimap.
  * @param player The player for whom drawing occurs.
@@ -739,7 +823,11 @@ void pannel_map_update_subtile(PlayerNumber plyr_idx, MapSubtlCoord stl_x, MapSu
     }
     TbPixel *mapptr;
     mapptr = &PannelMap[stl_num];
-    *mapptr = col;
+    if (*mapptr != col)
+    {
+        *mapptr = col;
+        PannelMapGeneration++;
+    }
 }
 
 void pannel_map_update(long x, long y, long w, long h)
@@ -888,8 +976,17 @@ void setup_background(long units_per_px)
         MapShapeStart = (long *)LbMemoryAlloc(MapDiagonalLength*sizeof(long));
         LbMemoryFree(MapShapeEnd);
         MapShapeEnd = (long *)LbMemoryAlloc(MapDiagonalLength*sizeof(long));
+        LbMemoryFree(MapSampleCache);
+        MapSampleCache = (unsigned short *)LbMemoryAlloc(MapDiagonalLength*MapDiagonalLength*sizeof(unsigned short));
+        LbMemoryFree(MapSampleStart);
+        MapSampleStart = (long *)LbMemoryAlloc(MapDiagonalLength*sizeof(long));
+        LbMemoryFree(MapSampleEnd);
+        MapSampleEnd = (long *)LbMemoryAlloc(MapDiagonalLength*sizeof(long));
     }
-    if ((MapBackground == NULL) || (MapShapeStart == NULL) || (MapShapeEnd == NULL)) {
+    // Background colours are to be re-read, so the cached samples are outdated
+    MapSampleCacheKey.diagonal_length = 0;
+    if ((MapBackground == NULL) || (MapShapeStart == NULL) || (MapShapeEnd == NULL)
+     || (MapSampleCache == NULL) || (MapSampleStart == NULL) || (MapSampleEnd == NULL)) {
         MapDiagonalLength = 0;
         return;
     }
@@ -1140,35 +1237,16 @@ void auto_gen_tables(long units_per_px)
     }
 }
 
-void pannel_map_draw_slabs(long x, long y, long units_per_px, long zoom)
+/**
+ * Fills the rotated minimap cache with indices into PannelColours.
+ * Needs to be called only if camera position, angle, zoom or PannelMap have changed.
+ */
+static void pannel_map_rebuild_sample_cache(long shift_x, long shift_y, long shift_stl_x, long shift_stl_y)
 {
-    PannelMapX = x * units_per_px / 16;
-    PannelMapY = y * units_per_px / 16;
-    auto_gen_tables(units_per_px);
-    update_pannel_colours();
-    struct PlayerInfo *player;
-    player = get_my_player();
-    struct Camera *cam;
-    cam = player->acamera;
-    if ((cam == NULL) || (MapDiagonalLength < 1))
-        return;
-    long shift_x;
-    long shift_y;
-    long shift_stl_x;
-    long shift_stl_y;
-    {
-        int angle;
-        angle = cam->orient_a & 0x1FFC;
-        shift_x = -LbSinL(angle) * zoom / 256;
-        shift_y = LbCosL(angle) * zoom / 256;
-        shift_stl_x = (cam->mappos.x.stl.num << 16) - MapDiagonalLength * shift_x / 2 - MapDiagonalLength * shift_y / 2;
-        shift_stl_y = (cam->mappos.y.stl.num << 16) - MapDiagonalLength * shift_y / 2 + MapDiagonalLength * shift_x / 2;
-    }
-
     TbPixel *bkgnd_line;
     bkgnd_line = MapBackground;
-    TbPixel *out_line;
-    out_line = &lbDisplay.WScreen[PannelMapX + lbDisplay.GraphicsScreenWidth * PannelMapY];
+    unsigned short *cache_line;
+    cache_line = MapSampleCache;
     int h;
     for (h = 0; h < MapDiagonalLength; h++)
     {
@@ -1198,10 +1276,12 @@ void pannel_map_draw_slabs(long x, long y, long units_per_px, long zoom)
             subpos_y += shift_y;
             subpos_x -= shift_x;
         }
+        MapSampleStart[h] = start_w;
+        MapSampleEnd[h] = end_w;
         TbPixel *bkgnd;
         bkgnd = &bkgnd_line[start_w];
-        TbPixel *out;
-        out = &out_line[start_w];
+        unsigned short *cache;
+        cache = &cache_line[start_w];
         unsigned int precor_y;
         unsigned int precor_x;
         precor_x = subpos_y;
@@ -1211,18 +1291,68 @@ void pannel_map_draw_slabs(long x, long y, long units_per_px, long zoom)
         {
             int pnmap_idx;
             pnmap_idx = ((precor_x>>16) & 0xff) | (((precor_y>>16) & 0xff) << 8);
-            int pncol_idx;
-            pncol_idx = PannelMap[pnmap_idx] | (*bkgnd << 8);
-            *out = PannelColours[pncol_idx];
+            *cache = PannelMap[pnmap_idx] | (*bkgnd << 8);
             precor_x += shift_y;
             precor_y -= shift_x;
-            out++;
+            cache++;
             bkgnd++;
         }
-        out_line += lbDisplay.GraphicsScreenWidth;
+        cache_line += MapDiagonalLength;
         bkgnd_line += MapDiagonalLength;
         shift_stl_x += shift_x;
         shift_stl_y += shift_y;
     }
 }
+
+void pannel_map_draw_slabs(long x, long y, long units_per_px, long zoom)
+{
+    PannelMapX = x * units_per_px / 16;
+    PannelMapY = y * units_per_px / 16;
+    auto_gen_tables(units_per_px);
+    update_pannel_colours();
+    struct PlayerInfo *player;
+    player = get_my_player();
+    struct Camera *cam;
+    cam = player->acamera;
+    if ((cam == NULL) || (MapDiagonalLength < 1))
+        return;
+    {
+        struct MinimapSampleCacheKey key;
+        key.stl_x = cam->mappos.x.stl.num;
+        key.stl_y = cam->mappos.y.stl.num;
+        key.angle = cam->orient_a & 0x1FFC;
+        key.zoom = zoom;
+        key.diagonal_length = MapDiagonalLength;
+        key.pannel_map_generation = PannelMapGeneration;
+        if (memcmp(&key, &MapSampleCacheKey, sizeof(struct MinimapSampleCacheKey)) != 0)
+        {
+            long shift_x;
+            long shift_y;
+            long shift_stl_x;
+            long shift_stl_y;
+            shift_x = -LbSinL(key.angle) * zoom / 256;
+            shift_y = LbCosL(key.angle) * zoom / 256;
+            shift_stl_x = (key.stl_x << 16) - MapDiagonalLength * shift_x / 2 - MapDiagonalLength * shift_y / 2;
+            shift_stl_y = (key.stl_y << 16) - MapDiagonalLength * shift_y / 2 + MapDiagonalLength * shift_x / 2;
+            pannel_map_rebuild_sample_cache(shift_x, shift_y, shift_stl_x, shift_stl_y);
+            MapSampleCacheKey = key;
+        }
+    }
+    // Only the colour lookup is done every frame; colours animate and highlight rooms
+    const unsigned short *cache_line;
+    cache_line = MapSampleCache;
+    TbPixel *out_line;
+    out_line = &lbDisplay.WScreen[PannelMapX + lbDisplay.GraphicsScreenWidth * PannelMapY];
+    int h;
+    for (h = 0; h < MapDiagonalLength; h++)
+    {
+        int w;
+        for (w = MapSampleStart[h]; w < MapSampleEnd[h]; w++)
+        {
+            out_line[w] = PannelColours[cache_line[w]];
+        }
+        out_line += lbDisplay.GraphicsScreenWidth;
+        cache_line += MapDiagonalLength;
+    }
+}
 /******************************************************************************/
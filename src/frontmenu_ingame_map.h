@@ -22,12 +22,49 @@
 
 #include "bflib_basics.h"
 #include "globals.h"
+#include "bflib_video.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 /******************************************************************************/
 #define PANNEL_MAP_RADIUS       58
+#define MINIMAP_OVERLAY_DOTS_COUNT 2048
+/******************************************************************************/
+enum MinimapOverlayDotShapes {
+    MMDot_Creature = 0,
+    MMDot_HighlightCross,
+    MMDot_Cross,
+};
+
+/** Values on which the rotated minimap cache depends. */
+struct MinimapSampleCacheKey {
+    long stl_x;
+    long stl_y;
+    long angle;
+    long zoom;
+    long diagonal_length;
+    unsigned long pannel_map_generation;
+};
+
+struct MinimapOverlayDot {
+    MapCoord pos_x;
+    MapCoord pos_y;
+    unsigned char shape;
+    TbPixel col;
+};
+
+struct MinimapOverlayList {
+    unsigned long gameturn;
+    PlayerNumber plyr_idx;
+    long creature_highlight;
+    long trap_highlight;
+    /** Traps are stored first, creatures start at this index. */
+    int traps_end;
+    int dots_count;
+    struct MinimapOverlayDot dots[MINIMAP_OVERLAY_DOTS_COUNT];
+};
+
 /******************************************************************************/
 DLLIMPORT long _DK_clicked_on_small_map;
 #define clicked_on_small_map _DK_clicked_on_small_map
@@ -59,6 +96,7 @@ DLLIMPORT unsigned char _DK_PannelMap[256*256];//map subtiles x*y
 #define PannelMap _DK_PannelMap
 /******************************************************************************/
 extern long MapDiagonalLength;
+extern unsigned long PannelMapGeneration;
 /******************************************************************************/
 void pannel_map_update(long x, long y, long w, long h);
 void pannel_map_draw_slabs(long x, long y, long units_per_px, long zoom);
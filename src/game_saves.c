@@ -24,6 +24,7 @@
 #include "bflib_fileio.h"
 #include "bflib_dernc.h"
 #include "bflib_bufrw.h"
+#include "bflib_compress.h"
 
 #include "config.h"
 #include "config_campaigns.h"
@@ -38,13 +39,18 @@
 #include "gui_soundmsgs.h"
 #include "game_legacy.h"
 #include "game_merge.h"
+#include "ariadne.h"
 #include "frontmenu_ingame_map.h"
 #include "keeperfx.hpp"
 
+#include <stddef.h>
+#include <SDL2/SDL.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 /******************************************************************************/
+#define SAVE_UNPACK_THREADS_MAX 3
 /******************************************************************************/
 TbBool load_catalogue_entry(TbFileHandle fh,struct FileChunkHeader *hdr,struct CatalogueEntry *centry);
 /******************************************************************************/
@@ -56,6 +62,249 @@ const char *saved_game_filename="fx1g%04d.sav";
 const char *packet_filename="fx1rp%04d.pck";
 
 struct CatalogueEntry save_game_catalogue[TOTAL_SAVE_SLOTS_COUNT];
+/** Describes a part of structure which is stored as separate sub-chunk. */
+struct SaveSubChunkDesc {
+    unsigned long id;
+    unsigned long offset;
+    unsigned long len;
+};
+
+/** Parts of the Game struct which get separate sub-chunks; must be sorted by offset. */
+static const struct SaveSubChunkDesc game_subchunk_fields[] = {
+    {SGSC_Players,   offsetof(struct Game, players),        sizeof(((struct Game *)0)->players)},
+    {SGSC_Columns,   offsetof(struct Game, columns_data),   sizeof(((struct Game *)0)->columns_data)},
+    {SGSC_Creatures, offsetof(struct Game, cctrl_data),     sizeof(((struct Game *)0)->cctrl_data)},
+    {SGSC_Things,    offsetof(struct Game, things_data),    sizeof(((struct Game *)0)->things_data)},
+    {SGSC_Map,       offsetof(struct Game, navigation_map), sizeof(((struct Game *)0)->navigation_map)},
+    {SGSC_Map,       offsetof(struct Game, map),            sizeof(((struct Game *)0)->map)},
+    {SGSC_Slabs,     offsetof(struct Game, slabmap),        sizeof(((struct Game *)0)->slabmap)},
+    {SGSC_Rooms,     offsetof(struct Game, rooms),          sizeof(((struct Game *)0)->rooms)},
+    {SGSC_Dungeons,  offsetof(struct Game, dungeon),        sizeof(((struct Game *)0)->dungeon)},
+    {SGSC_Events,    offsetof(struct Game, event),          sizeof(((struct Game *)0)->event)},
+    {SGSC_Script,    offsetof(struct Game, script),         sizeof(((struct Game *)0)->script)},
+};
+
+/** Copy of the game state, written to disk by the background save thread. */
+struct BackgroundSave {
+    SDL_Thread *thread;
+    SDL_atomic_t done;
+    TbBool result;
+    long slot_num;
+    char fname[DISKPATH_SIZE];
+    struct CatalogueEntry centry;
+    struct Game *game;
+    struct GameAdd *gameadd;
+    struct IntralevelData *intralvl;
+};
+
+struct SubChunkUnpackTask {
+    struct SaveSubChunkHeader shdr;
+    const unsigned char *src;
+};
+
+struct SubChunkUnpackJobs {
+    struct SubChunkUnpackTask tasks[SAVE_SUBCHUNKS_MAX];
+    int count;
+    unsigned char *dst;
+    SDL_atomic_t next;
+    SDL_atomic_t failed;
+};
+
+struct BackgroundSave background_save;
+/******************************************************************************/
+/**
+ * Splits a structure into sub-chunks, filling gaps between listed fields with misc sub-chunks.
+ * @return Amount of sub-chunks in the list.
+ */
+static int build_subchunk_list(const struct SaveSubChunkDesc *fields, int fields_num, unsigned long total_len,
+    struct SaveSubChunkDesc *list, int list_max)
+{
+    int count = 0;
+    unsigned long pos = 0;
+    int fld_idx = 0;
+    while (pos < total_len)
+    {
+        struct SaveSubChunkDesc part;
+        if ((fld_idx < fields_num) && (fields[fld_idx].offset == pos))
+        {
+            part = fields[fld_idx];
+            fld_idx++;
+        } else
+        {
+            part.id = SGSC_Misc;
+            part.offset = pos;
+            part.len = total_len - pos;
+            if ((fld_idx < fields_num) && (fields[fld_idx].offset < total_len))
+                part.len = fields[fld_idx].offset - pos;
+        }
+        // Big parts are split so that they can be unpacked in parallel
+        while (part.len > 0)
+        {
+            if (count >= list_max)
+                return -1;
+            list[count] = part;
+            if (list[count].len > SAVE_SUBCHUNK_MAX_LEN)
+                list[count].len = SAVE_SUBCHUNK_MAX_LEN;
+            part.offset += list[count].len;
+            part.len -= list[count].len;
+            count++;
+        }
+        pos = list[count-1].offset + list[count-1].len;
+    }
+    return count;
+}
+
+/**
+ * Writes a chunk containing given structure as compressed sub-chunks.
+ */
+static TbBool save_packed_chunk(TbFileHandle fhandle, unsigned long chunk_id, const void *data, unsigned long len,
+    const struct SaveSubChunkDesc *fields, int fields_num)
+{
+    struct SaveSubChunkDesc list[SAVE_SUBCHUNKS_MAX];
+    int count = build_subchunk_list(fields, fields_num, len, list, SAVE_SUBCHUNKS_MAX);
+    if (count < 0)
+    {
+        ERRORLOG("Too many sub-chunks in chunk %08lx",chunk_id);
+        return false;
+    }
+    unsigned long buf_len = 0;
+    int i;
+    for (i = 0; i < count; i++)
+        buf_len += sizeof(struct SaveSubChunkHeader) + LbLzCompressBound(list[i].len);
+    unsigned char *buf = LbMemoryAlloc(buf_len);
+    if (buf == NULL)
+    {
+        ERRORLOG("Can't allocate %lu bytes for packed chunk",buf_len);
+        return false;
+    }
+    unsigned long pos = 0;
+    for (i = 0; i < count; i++)
+    {
+        struct SaveSubChunkHeader *shdr = (struct SaveSubChunkHeader *)(buf + pos);
+        pos += sizeof(struct SaveSubChunkHeader);
+        shdr->id = list[i].id;
+        shdr->offset = list[i].offset;
+        shdr->len = list[i].len;
+        const unsigned char *src = (const unsigned char *)data + list[i].offset;
+        long packed_len = LbLzCompress(buf + pos, buf_len - pos, src, list[i].len);
+        if ((packed_len < 0) || (packed_len >= list[i].len))
+        {
+            // Not worth compressing
+            memcpy(buf + pos, src, list[i].len);
+            packed_len = list[i].len;
+        }
+        shdr->packed_len = packed_len;
+        pos += packed_len;
+    }
+    struct FileChunkHeader hdr;
+    hdr.id = chunk_id;
+    hdr.ver = SGCV_Packed;
+    hdr.len = pos;
+    TbBool result = false;
+    if (LbFileWrite(fhandle, &hdr, sizeof(struct FileChunkHeader)) == sizeof(struct FileChunkHeader))
+    if (LbFileWrite(fhandle, buf, pos) == pos)
+        result = true;
+    LbMemoryFree(buf);
+    return result;
+}
+
+static int unpack_subchunks_thread(void *data)
+{
+    struct SubChunkUnpackJobs *jobs = (struct SubChunkUnpackJobs *)data;
+    while (true)
+    {
+        int idx = SDL_AtomicAdd(&jobs->next, 1);
+        if (idx >= jobs->count)
+            break;
+        struct SubChunkUnpackTask *task = &jobs->tasks[idx];
+        unsigned char *dst = jobs->dst + task->shdr.offset;
+        if (task->shdr.packed_len == task->shdr.len)
+        {
+            memcpy(dst, task->src, task->shdr.len);
+        } else
+        if (LbLzDecompress(dst, task->shdr.len, task->src, task->shdr.packed_len) != task->shdr.len)
+        {
+            SDL_AtomicSet(&jobs->failed, 1);
+        }
+    }
+    return 0;
+}
+
+/**
+ * Reads a packed chunk and decompresses its sub-chunks into given structure.
+ * Sub-chunks are decompressed in parallel. Whole chunk is consumed from file even on failure.
+ */
+static TbBool load_packed_chunk(TbFileHandle fhandle, const struct FileChunkHeader *hdr, void *data, unsigned long len)
+{
+    unsigned char *buf = LbMemoryAlloc(hdr->len);
+    if (buf == NULL)
+    {
+        ERRORLOG("Can't allocate %lu bytes for packed chunk",hdr->len);
+        if (LbFileSeek(fhandle, hdr->len, Lb_FILE_SEEK_CURRENT) < 0)
+            LbFileSeek(fhandle, 0, Lb_FILE_SEEK_END);
+        return false;
+    }
+    if (LbFileRead(fhandle, buf, hdr->len) != hdr->len)
+    {
+        LbMemoryFree(buf);
+        return false;
+    }
+    struct SubChunkUnpackJobs *jobs = (struct SubChunkUnpackJobs *)LbMemoryAlloc(sizeof(struct SubChunkUnpackJobs));
+    if (jobs == NULL)
+    {
+        LbMemoryFree(buf);
+        return false;
+    }
+    // Verify that sub-chunks cover the whole structure, without gaps or overlapping
+    jobs->dst = (unsigned char *)data;
+    unsigned long pos = 0;
+    unsigned long unpacked_len = 0;
+    while (pos + sizeof(struct SaveSubChunkHeader) <= hdr->len)
+    {
+        if (jobs->count >= SAVE_SUBCHUNKS_MAX)
+            break;
+        struct SubChunkUnpackTask *task = &jobs->tasks[jobs->count];
+        memcpy(&task->shdr, buf + pos, sizeof(struct SaveSubChunkHeader));
+        pos += sizeof(struct SaveSubChunkHeader);
+        if ((task->shdr.offset != unpacked_len) || (task->shdr.len > len - unpacked_len)
+         || (task->shdr.packed_len > hdr->len - pos))
+            break;
+        task->src = buf + pos;
+        pos += task->shdr.packed_len;
+        unpacked_len += task->shdr.len;
+        jobs->count++;
+    }
+    if ((pos != hdr->len) || (unpacked_len != len))
+    {
+        WARNLOG("Invalid sub-chunks in packed chunk %08lx",hdr->id);
+        LbMemoryFree(jobs);
+        LbMemoryFree(buf);
+        return false;
+    }
+    SDL_Thread *threads[SAVE_UNPACK_THREADS_MAX];
+    int threads_num = SDL_GetCPUCount() - 1;
+    if (threads_num > SAVE_UNPACK_THREADS_MAX)
+        threads_num = SAVE_UNPACK_THREADS_MAX;
+    int i;
+    for (i = 0; i < threads_num; i++)
+    {
+        threads[i] = SDL_CreateThread(unpack_subchunks_thread, "SaveUnpack", jobs);
+        if (threads[i] == NULL)
+            break;
+    }
+    threads_num = i;
+    // This thread works on the sub-chunks too
+    unpack_subchunks_thread(jobs);
+    for (i = 0; i < threads_num; i++)
+        SDL_WaitThread(threads[i], NULL);
+    TbBool result = (SDL_AtomicGet(&jobs->failed) == 0);
+    if (!result)
+        WARNLOG("Corrupted data in packed chunk %08lx",hdr->id);
+    LbMemoryFree(jobs);
+    LbMemoryFree(buf);
+    return result;
+}
+
 /******************************************************************************/
 TbBool is_primitive_save_version(long filesize)
 {
@@ -87,12 +336,15 @@ short save_version_compatible(long filesize,struct Game *header)
   return false;
 }*/
 
-TbBool save_game_chunks(TbFileHandle fhandle,struct CatalogueEntry *centry)
+/**
+ * Writes saved game chunks. Big structures are stored packed, as compressed sub-chunks.
+ * Works on given copies of game state, so it may be called from background save thread.
+ */
+TbBool save_game_chunks(TbFileHandle fhandle,struct CatalogueEntry *centry,
+    const struct Game *sgame, const struct GameAdd *sgameadd, const struct IntralevelData *sintralvl)
 {
     struct FileChunkHeader hdr;
     long chunks_done = 0;
-    // Currently there is some game data oustide of structs - make sure it is updated
-    light_export_system_state(&gameadd.lightst);
     { // Info chunk
         hdr.id = SGC_InfoBlock;
         hdr.ver = 0;
@@ -101,28 +353,19 @@ TbBool save_game_chunks(TbFileHandle fhandle,struct CatalogueEntry *centry)
         if (LbFileWrite(fhandle, centry, sizeof(struct CatalogueEntry)) == sizeof(struct CatalogueEntry))
             chunks_done |= SGF_InfoBlock;
     }
-    { // Game data chunk
-        hdr.id = SGC_GameOrig;
-        hdr.ver = 0;
-        hdr.len = sizeof(struct Game);
-        if (LbFileWrite(fhandle, &hdr, sizeof(struct FileChunkHeader)) == sizeof(struct FileChunkHeader))
-        if (LbFileWrite(fhandle, &game, sizeof(struct Game)) == sizeof(struct Game))
-            chunks_done |= SGF_GameOrig;
-    }
-    { // GameAdd data chunk
-        hdr.id = SGC_GameAdd;
-        hdr.ver = 0;
-        hdr.len = sizeof(struct GameAdd);
-        if (LbFileWrite(fhandle, &hdr, sizeof(struct FileChunkHeader)) == sizeof(struct FileChunkHeader))
-        if (LbFileWrite(fhandle, &gameadd, sizeof(struct GameAdd)) == sizeof(struct GameAdd))
-            chunks_done |= SGF_GameAdd;
-    }
+    // Game data chunk
+    if (save_packed_chunk(fhandle, SGC_GameOrig, sgame, sizeof(struct Game),
+        game_subchunk_fields, sizeof(game_subchunk_fields)/sizeof(game_subchunk_fields[0])))
+        chunks_done |= SGF_GameOrig;
+    // GameAdd data chunk
+    if (save_packed_chunk(fhandle, SGC_GameAdd, sgameadd, sizeof(struct GameAdd), NULL, 0))
+        chunks_done |= SGF_GameAdd;
     { // IntralevelData data chunk
         hdr.id = SGC_IntralevelData;
         hdr.ver = 0;
         hdr.len = sizeof(struct IntralevelData);
         if (LbFileWrite(fhandle, &hdr, sizeof(struct FileChunkHeader)) == sizeof(struct FileChunkHeader))
-        if (LbFileWrite(fhandle, &intralvl, sizeof(struct IntralevelData)) == sizeof(struct IntralevelData))
+        if (LbFileWrite(fhandle, sintralvl, sizeof(struct IntralevelData)) == sizeof(struct IntralevelData))
             chunks_done |= SGF_IntralevelData;
     }
     if (chunks_done != SGF_SavedGame)
@@ -182,6 +425,118 @@ TbBool save_packet_chunks(TbFileHandle fhandle,struct CatalogueEntry *centry)
     return true;
 }
 
+/**
+ * Writes packet file keyframe - a snapshot of game state from which replay can be continued.
+ * Game structures are stored packed, the same way as in saved games.
+ * Navigation triangulation is stored too, as the one rebuilt on load would lead to different routes.
+ */
+TbBool save_packet_keyframe_chunks(TbFileHandle fhandle,const struct PacketKeyframeHead *kfhead)
+{
+    struct FileChunkHeader hdr;
+    long chunks_done = 0;
+    { // Keyframe header
+        hdr.id = SGC_PacketKeyframe;
+        hdr.ver = 0;
+        hdr.len = sizeof(struct PacketKeyframeHead);
+        if (LbFileWrite(fhandle, &hdr, sizeof(struct FileChunkHeader)) == sizeof(struct FileChunkHeader))
+        if (LbFileWrite(fhandle, kfhead, sizeof(struct PacketKeyframeHead)) == sizeof(struct PacketKeyframeHead))
+            chunks_done |= SGF_PacketKeyframe;
+    }
+    // Currently there is some game data oustide of structs - make sure it is updated
+    light_export_system_state(&gameadd.lightst);
+    if (save_packed_chunk(fhandle, SGC_GameOrig, &game, sizeof(struct Game),
+        game_subchunk_fields, sizeof(game_subchunk_fields)/sizeof(game_subchunk_fields[0])))
+        chunks_done |= SGF_GameOrig;
+    if (save_packed_chunk(fhandle, SGC_GameAdd, &gameadd, sizeof(struct GameAdd), NULL, 0))
+        chunks_done |= SGF_GameAdd;
+    { // IntralevelData data chunk
+        hdr.id = SGC_IntralevelData;
+        hdr.ver = 0;
+        hdr.len = sizeof(struct IntralevelData);
+        if (LbFileWrite(fhandle, &hdr, sizeof(struct FileChunkHeader)) == sizeof(struct FileChunkHeader))
+        if (LbFileWrite(fhandle, &intralvl, sizeof(struct IntralevelData)) == sizeof(struct IntralevelData))
+            chunks_done |= SGF_IntralevelData;
+    }
+    struct NavigationState *navst = (struct NavigationState *)LbMemoryAlloc(sizeof(struct NavigationState));
+    if (navst != NULL)
+    {
+        navigation_export_state(navst);
+        if (save_packed_chunk(fhandle, SGC_NavigationData, navst, sizeof(struct NavigationState), NULL, 0))
+            chunks_done |= SGF_NavigationData;
+        LbMemoryFree(navst);
+    } else
+    {
+        ERRORLOG("Can't allocate navigation state copy for keyframe");
+    }
+    if (chunks_done != SGF_PacketKeyframeData)
+        return false;
+    return true;
+}
+
+/**
+ * Reads packet file keyframe chunks into given copies of game state.
+ * File position should be at the keyframe header chunk.
+ */
+static TbBool load_packet_keyframe_chunks(TbFileHandle fhandle, struct PacketKeyframeHead *kfhead,
+    struct Game *sgame, struct GameAdd *sgameadd, struct IntralevelData *sintralvl, struct NavigationState *snavst)
+{
+    long chunks_done = 0;
+    while ((chunks_done & SGF_PacketKeyframeData) != SGF_PacketKeyframeData)
+    {
+        struct FileChunkHeader hdr;
+        if (LbFileRead(fhandle, &hdr, sizeof(struct FileChunkHeader)) != sizeof(struct FileChunkHeader))
+            break;
+        switch(hdr.id)
+        {
+        case SGC_PacketKeyframe:
+            // Header of next keyframe means this one is incomplete
+            if ((chunks_done != 0) || (hdr.len != sizeof(struct PacketKeyframeHead)))
+                return false;
+            if (LbFileRead(fhandle, kfhead, sizeof(struct PacketKeyframeHead)) != sizeof(struct PacketKeyframeHead))
+                return false;
+            chunks_done |= SGF_PacketKeyframe;
+            break;
+        case SGC_GameOrig:
+            if ((hdr.ver != SGCV_Packed) || !load_packed_chunk(fhandle, &hdr, sgame, sizeof(struct Game)))
+            {
+                WARNLOG("Could not read keyframe GameOrig chunk");
+                return false;
+            }
+            chunks_done |= SGF_GameOrig;
+            break;
+        case SGC_GameAdd:
+            if ((hdr.ver != SGCV_Packed) || !load_packed_chunk(fhandle, &hdr, sgameadd, sizeof(struct GameAdd)))
+            {
+                WARNLOG("Could not read keyframe GameAdd chunk");
+                return false;
+            }
+            chunks_done |= SGF_GameAdd;
+            break;
+        case SGC_IntralevelData:
+            if ((hdr.len != sizeof(struct IntralevelData))
+             || (LbFileRead(fhandle, sintralvl, sizeof(struct IntralevelData)) != sizeof(struct IntralevelData)))
+            {
+                WARNLOG("Could not read keyframe IntralevelData chunk");
+                return false;
+            }
+            chunks_done |= SGF_IntralevelData;
+            break;
+        case SGC_NavigationData:
+            if ((hdr.ver != SGCV_Packed) || !load_packed_chunk(fhandle, &hdr, snavst, sizeof(struct NavigationState)))
+            {
+                WARNLOG("Could not read keyframe NavigationData chunk");
+                return false;
+            }
+            chunks_done |= SGF_NavigationData;
+            break;
+        default:
+            WARNLOG("Unrecognized keyframe chunk, ID = %08lx",hdr.id);
+            return false;
+        }
+    }
+    return ((chunks_done & SGF_PacketKeyframeData) == SGF_PacketKeyframeData);
+}
+
 int load_game_chunks(TbFileHandle fhandle,struct CatalogueEntry *centry)
 {
     long chunks_done = 0;
@@ -210,6 +565,15 @@ int load_game_chunks(TbFileHandle fhandle,struct CatalogueEntry *centry)
             }
             break;
         case SGC_GameAdd:
+            if (hdr.ver == SGCV_Packed)
+            {
+                if (load_packed_chunk(fhandle, &hdr, &gameadd, sizeof(struct GameAdd))) {
+                    chunks_done |= SGF_GameAdd;
+                } else {
+                    WARNLOG("Could not read packed GameAdd chunk");
+                }
+                break;
+            }
             if (hdr.len != sizeof(struct GameAdd))
             {
                 if (LbFileSeek(fhandle, hdr.len, Lb_FILE_SEEK_CURRENT) < 0)
@@ -225,6 +589,15 @@ int load_game_chunks(TbFileHandle fhandle,struct CatalogueEntry *centry)
             }
             break;
         case SGC_GameOrig:
+            if (hdr.ver == SGCV_Packed)
+            {
+                if (load_packed_chunk(fhandle, &hdr, &game, sizeof(struct Game))) {
+                    chunks_done |= SGF_GameOrig;
+                } else {
+                    WARNLOG("Could not read packed GameOrig chunk");
+                }
+                break;
+            }
             if (hdr.len != sizeof(struct Game))
             {
                 if (LbFileSeek(fhandle, hdr.len, Lb_FILE_SEEK_CURRENT) < 0)
@@ -291,8 +664,88 @@ int load_game_chunks(TbFileHandle fhandle,struct CatalogueEntry *centry)
     return GLoad_Failed;
 }
 
+static TbBool write_background_save(struct BackgroundSave *bgsave)
+{
+    TbFileHandle handle = LbFileOpen(bgsave->fname, Lb_FILE_MODE_NEW);
+    if (handle == -1)
+    {
+        WARNMSG("Cannot open file to save, \"%s\".",bgsave->fname);
+        return false;
+    }
+    if (!save_game_chunks(handle, &bgsave->centry, bgsave->game, bgsave->gameadd, bgsave->intralvl))
+    {
+        LbFileClose(handle);
+        WARNMSG("Cannot write to save file, \"%s\".",bgsave->fname);
+        return false;
+    }
+    LbFileClose(handle);
+    return true;
+}
+
+static void free_background_save_state(struct BackgroundSave *bgsave)
+{
+    // Game, GameAdd and IntralevelData copies are one allocation
+    LbMemoryFree(bgsave->game);
+    bgsave->game = NULL;
+    bgsave->gameadd = NULL;
+    bgsave->intralvl = NULL;
+}
+
+static int background_save_thread(void *data)
+{
+    struct BackgroundSave *bgsave = (struct BackgroundSave *)data;
+    bgsave->result = write_background_save(bgsave);
+    SDL_AtomicSet(&bgsave->done, 1);
+    return 0;
+}
+
+/**
+ * Finishes the background save, reporting its result.
+ * @param wait If true, waits for the save thread; otherwise returns if it is still writing.
+ * @return True if there is no save in progress anymore.
+ */
+static TbBool finish_background_save(TbBool wait)
+{
+    struct BackgroundSave *bgsave = &background_save;
+    if (bgsave->game == NULL)
+        return true;
+    if (bgsave->thread != NULL)
+    {
+        if (!wait && (SDL_AtomicGet(&bgsave->done) == 0))
+            return false;
+        SDL_WaitThread(bgsave->thread, NULL);
+        bgsave->thread = NULL;
+    }
+    if (!bgsave->result)
+    {
+        ERRORLOG("Error in background save of slot %d",(int)bgsave->slot_num);
+        save_catalogue_slot_disable(bgsave->slot_num);
+        create_error_box(GUIStr_ErrorSaving);
+    }
+    free_background_save_state(bgsave);
+    return true;
+}
+
+/**
+ * Checks whether the background save has finished, without blocking.
+ */
+TbBool process_background_save(void)
+{
+    return finish_background_save(false);
+}
+
+/**
+ * Blocks until the background save, if any, is written.
+ * Needs to be called before reading save files or quitting.
+ */
+TbBool wait_for_background_save(void)
+{
+    return finish_background_save(true);
+}
+
 /**
  * Saves the game state file (savegame).
+ * The state is copied, and then compressed and written by a background thread.
  * @note fill_game_catalogue_entry() should be called before to fill level information.
  *
  * @param slot_num
@@ -305,25 +758,41 @@ TbBool save_game(long slot_num)
 /*  game.version_major = VersionMajor;
     game.version_minor = VersionMinor;
     game.load_restart_level = get_loaded_level_number();*/
-    char* fname = prepare_file_fmtpath(FGrp_Save, saved_game_filename, slot_num);
-    TbFileHandle handle = LbFileOpen(fname, Lb_FILE_MODE_NEW);
-    if (handle == -1)
+    wait_for_background_save();
+    struct BackgroundSave *bgsave = &background_save;
+    // Currently there is some game data oustide of structs - make sure it is updated
+    light_export_system_state(&gameadd.lightst);
+    unsigned char *snapshot = LbMemoryAlloc(sizeof(struct Game) + sizeof(struct GameAdd) + sizeof(struct IntralevelData));
+    if (snapshot == NULL)
     {
-        WARNMSG("Cannot open file to save, \"%s\".",fname);
+        ERRORLOG("Can't allocate game state copy for saving");
         return false;
     }
-    if (!save_game_chunks(handle,&save_game_catalogue[slot_num]))
+    bgsave->game = (struct Game *)snapshot;
+    bgsave->gameadd = (struct GameAdd *)(snapshot + sizeof(struct Game));
+    bgsave->intralvl = (struct IntralevelData *)(snapshot + sizeof(struct Game) + sizeof(struct GameAdd));
+    memcpy(bgsave->game, &game, sizeof(struct Game));
+    memcpy(bgsave->gameadd, &gameadd, sizeof(struct GameAdd));
+    memcpy(bgsave->intralvl, &intralvl, sizeof(struct IntralevelData));
+    memcpy(&bgsave->centry, &save_game_catalogue[slot_num], sizeof(struct CatalogueEntry));
+    char* fname = prepare_file_fmtpath(FGrp_Save, saved_game_filename, slot_num);
+    LbStringCopy(bgsave->fname, fname, sizeof(bgsave->fname));
+    bgsave->slot_num = slot_num;
+    SDL_AtomicSet(&bgsave->done, 0);
+    bgsave->thread = SDL_CreateThread(background_save_thread, "SaveGame", bgsave);
+    if (bgsave->thread == NULL)
     {
-        LbFileClose(handle);
-        WARNMSG("Cannot write to save file, \"%s\".",fname);
-        return false;
+        WARNLOG("Cannot create save thread, saving synchronously: %s", SDL_GetError());
+        TbBool result = write_background_save(bgsave);
+        free_background_save_state(bgsave);
+        return result;
     }
-    LbFileClose(handle);
     return true;
 }
 
 TbBool is_save_game_loadable(long slot_num)
 {
+    wait_for_background_save();
     // Prepare filename and open the file
     char* fname = prepare_file_fmtpath(FGrp_Save, saved_game_filename, slot_num);
     TbFileHandle fh = LbFileOpen(fname, Lb_FILE_MODE_READ_ONLY);
@@ -347,6 +816,7 @@ TbBool load_game(long slot_num)
 //  unsigned char buf[14];
 //  char cmpgn_fname[CAMPAIGN_FNAME_LEN];
     SYNCDBG(6,"Starting");
+    wait_for_background_save();
     reset_eye_lenses();
     {
         // Use fname only here - it is overwritten by next use of prepare_file_fmtpath()
@@ -431,6 +901,52 @@ TbBool load_game(long slot_num)
     return true;
 }
 
+/**
+ * Replaces game state with the one stored in packet file keyframe.
+ * State of the packet replay itself is kept, so that the replay can continue from the keyframe turn.
+ * If the keyframe can't be read, game state stays unchanged.
+ */
+TbBool load_packet_keyframe(TbFileHandle fhandle,struct PacketKeyframeHead *kfhead)
+{
+    SYNCDBG(6,"Starting");
+    wait_for_background_save();
+    unsigned char *snapshot = LbMemoryAlloc(sizeof(struct Game) + sizeof(struct GameAdd) + sizeof(struct IntralevelData)
+        + sizeof(struct NavigationState));
+    if (snapshot == NULL)
+    {
+        ERRORLOG("Can't allocate game state copy for loading keyframe");
+        return false;
+    }
+    struct Game *sgame = (struct Game *)snapshot;
+    struct GameAdd *sgameadd = (struct GameAdd *)(snapshot + sizeof(struct Game));
+    struct IntralevelData *sintralvl = (struct IntralevelData *)(snapshot + sizeof(struct Game) + sizeof(struct GameAdd));
+    struct NavigationState *snavst = (struct NavigationState *)(snapshot + sizeof(struct Game) + sizeof(struct GameAdd)
+        + sizeof(struct IntralevelData));
+    if (!load_packet_keyframe_chunks(fhandle, kfhead, sgame, sgameadd, sintralvl, snavst))
+    {
+        LbMemoryFree(snapshot);
+        return false;
+    }
+    // Packet replay state is stored within Game structure; it shouldn't be taken from the keyframe
+    unsigned char replay_state[offsetof(struct Game, campaign_fname) - offsetof(struct Game, packet_save_enable)];
+    memcpy(replay_state, &game.packet_save_enable, sizeof(replay_state));
+    memcpy(&game, sgame, sizeof(struct Game));
+    memcpy(&gameadd, sgameadd, sizeof(struct GameAdd));
+    memcpy(&intralvl, sintralvl, sizeof(struct IntralevelData));
+    LbStringCopy(game.campaign_fname,campaign.fname,sizeof(game.campaign_fname));
+    reinit_level_after_load();
+    // Triangulation made by reinit is replaced by the stored one, so that routes are the same as in recorded game
+    navigation_import_state(snavst);
+    LbMemoryFree(snapshot);
+    memcpy(&game.packet_save_enable, replay_state, sizeof(replay_state));
+    pannel_map_update(0, 0, map_subtiles_x+1, map_subtiles_y+1);
+    struct PlayerInfo* player = get_my_player();
+    PaletteSetPlayerPalette(player, engine_palette);
+    // Update the lights system state
+    light_import_system_state(&gameadd.lightst);
+    return true;
+}
+
 int count_valid_saved_games(void)
 {
   number_of_saved_games = 0;
@@ -517,6 +1033,7 @@ TbBool load_catalogue_entry(TbFileHandle fh,struct FileChunkHeader *hdr,struct C
 TbBool load_game_save_catalogue(void)
 {
     //return load_game_catalogue(save_game_catalogue);
+    wait_for_background_save();
     long saves_found = 0;
     for (long slot_num = 0; slot_num < TOTAL_SAVE_SLOTS_COUNT; slot_num++)
     {
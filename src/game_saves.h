@@ -30,6 +30,9 @@ extern "C" {
 #define TOTAL_SAVE_SLOTS_COUNT    8
 #define SAVE_TEXTNAME_LEN        15
 #define PLAYER_NAME_LENGTH       64
+/** Max size of uncompressed sub-chunk; bigger parts are split, so they can be decompressed in parallel. */
+#define SAVE_SUBCHUNK_MAX_LEN    (256*1024)
+#define SAVE_SUBCHUNKS_MAX       64
 
 enum SaveGameChunks {
      SGC_InfoBlock      = 0x4F464E49, //"INFO"
@@ -38,6 +41,29 @@ enum SaveGameChunks {
      SGC_PacketHeader   = 0x52444850, //"PHDR"
      SGC_PacketData     = 0x544B4350, //"PCKT"
      SGC_IntralevelData = 0x4C564C49, //"ILVL"
+     SGC_PacketKeyframe = 0x4D52464B, //"KFRM"
+     SGC_NavigationData = 0x4956414E, //"NAVI"
+};
+
+/** Versions of chunk contents, stored in chunk header. */
+enum SaveGameChunkVersions {
+     SGCV_Raw           = 0, /**< Chunk contains raw structure. */
+     SGCV_Packed        = 1, /**< Chunk contains compressed sub-chunks. */
+};
+
+/** Identifiers of sub-chunks inside packed chunks. */
+enum SaveGameSubChunks {
+     SGSC_Misc          = 0x4353494D, //"MISC"
+     SGSC_Players       = 0x52594C50, //"PLYR"
+     SGSC_Columns       = 0x534C4F43, //"COLS"
+     SGSC_Creatures     = 0x52545243, //"CRTR"
+     SGSC_Things        = 0x474E4854, //"THNG"
+     SGSC_Map           = 0x5350414D, //"MAPS"
+     SGSC_Slabs         = 0x42414C53, //"SLAB"
+     SGSC_Rooms         = 0x4D4F4F52, //"ROOM"
+     SGSC_Dungeons      = 0x4E474E44, //"DNGN"
+     SGSC_Events        = 0x544E5645, //"EVNT"
+     SGSC_Script        = 0x54504353, //"SCPT"
 };
 
 enum SaveGameChunkFlags {
@@ -47,10 +73,13 @@ enum SaveGameChunkFlags {
      SGF_PacketHeader   = 0x0100,
      SGF_PacketData     = 0x0200,
      SGF_IntralevelData = 0x0400,
+     SGF_PacketKeyframe = 0x0800,
+     SGF_NavigationData = 0x1000,
 };
 #define SGF_SavedGame      (SGF_InfoBlock|SGF_GameOrig|SGF_GameAdd|SGF_IntralevelData)
 #define SGF_PacketStart    (SGF_PacketHeader|SGF_PacketData|SGF_InfoBlock)
 #define SGF_PacketContinue (SGF_PacketHeader|SGF_PacketData|SGF_InfoBlock|SGF_GameOrig|SGF_GameAdd)
+#define SGF_PacketKeyframeData (SGF_PacketKeyframe|SGF_GameOrig|SGF_GameAdd|SGF_IntralevelData|SGF_NavigationData)
 
 enum GameLoadStatus {
     GLoad_Failed = 0,
@@ -63,6 +92,9 @@ enum GameLoadStatus {
 #pragma pack(1)
 
 struct Game;
+struct GameAdd;
+struct IntralevelData;
+struct PacketKeyframeHead;
 
 enum CatalogueEntryFlags {
     CEF_InUse       = 0x0001,
@@ -84,6 +116,16 @@ struct FileChunkHeader {
     unsigned long ver;
 };
 
+/** Header of a sub-chunk; packed chunk consists of these, each followed by its data. */
+struct SaveSubChunkHeader {
+    unsigned long id;
+    /** Position of the data within unpacked structure. */
+    unsigned long offset;
+    unsigned long len;
+    /** Compressed data length; if equal to len, the data is stored uncompressed. */
+    unsigned long packed_len;
+};
+
 /******************************************************************************/
 //DLLIMPORT extern struct CatalogueEntry _DK_save_game_catalogue[SAVE_SLOTS_COUNT];
 //#define save_game_catalogue _DK_save_game_catalogue
@@ -98,14 +140,19 @@ extern struct CatalogueEntry save_game_catalogue[];
 /******************************************************************************/
 int load_game_chunks(TbFileHandle fhandle,struct CatalogueEntry *centry);
 TbBool fill_game_catalogue_entry(struct CatalogueEntry *centry,const char *textname);
-TbBool save_game_chunks(TbFileHandle fhandle,struct CatalogueEntry *centry);
+TbBool save_game_chunks(TbFileHandle fhandle,struct CatalogueEntry *centry,
+    const struct Game *sgame, const struct GameAdd *sgameadd, const struct IntralevelData *sintralvl);
 TbBool save_packet_chunks(TbFileHandle fhandle,struct CatalogueEntry *centry);
+TbBool save_packet_keyframe_chunks(TbFileHandle fhandle,const struct PacketKeyframeHead *kfhead);
+TbBool load_packet_keyframe(TbFileHandle fhandle,struct PacketKeyframeHead *kfhead);
 /******************************************************************************/
 TbBool load_game(long slot_idx);
 TbBool save_game(long slot_idx);
 TbBool initialise_load_game_slots(void);
 int count_valid_saved_games(void);
 TbBool is_save_game_loadable(long slot_num);
+TbBool process_background_save(void);
+TbBool wait_for_background_save(void);
 /******************************************************************************/
 TbBool save_catalogue_slot_disable(unsigned int slot_idx);
 TbBool save_game_save_catalogue(void);
@@ -126,28 +126,28 @@ extern "C" {
 #define NETLOG(format, ...) LbNetLog("%s: " format "\n", __func__ , ##__VA_ARGS__)
 #define NOLOG(format, ...)
 
-// Debug function-like macros - for debug code logging
+// Debug function-like macros - for debug code logging; limited by compiled in and runtime channel level
 #if (BFDEBUG_LEVEL > 0)
   #define SYNCDBG(dblv,format, ...) {\
-    if (BFDEBUG_LEVEL > dblv)\
+    if ((BFDEBUG_LEVEL > dblv) && (log_channel_level[LbLogCh_Sync] > dblv))\
       LbSyncLog("%s: " format "\n", __func__ , ##__VA_ARGS__); }
   #define WARNDBG(dblv,format, ...) {\
-    if (BFDEBUG_LEVEL > dblv)\
+    if ((BFDEBUG_LEVEL > dblv) && (log_channel_level[LbLogCh_Warning] > dblv))\
       LbWarnLog("%s: " format "\n", __func__ , ##__VA_ARGS__); }
   #define ERRORDBG(dblv,format, ...) {\
-    if (BFDEBUG_LEVEL > dblv)\
+    if ((BFDEBUG_LEVEL > dblv) && (log_channel_level[LbLogCh_Error] > dblv))\
       LbErrorLog("%s: " format "\n", __func__ , ##__VA_ARGS__); }
   #define NAVIDBG(dblv,format, ...) {\
-    if (BFDEBUG_LEVEL > dblv)\
+    if ((BFDEBUG_LEVEL > dblv) && (log_channel_level[LbLogCh_Navi] > dblv))\
       LbNaviLog("%s: " format "\n", __func__ , ##__VA_ARGS__); }
   #define NETDBG(dblv,format, ...) {\
-    if (BFDEBUG_LEVEL > dblv)\
+    if ((BFDEBUG_LEVEL > dblv) && (log_channel_level[LbLogCh_Net] > dblv))\
       LbNetLog("%s: " format "\n", __func__ , ##__VA_ARGS__); }
   #define SCRIPTDBG(dblv,format, ...) {\
-    if (BFDEBUG_LEVEL > dblv)\
+    if ((BFDEBUG_LEVEL > dblv) && (log_channel_level[LbLogCh_Script] > dblv))\
       LbScriptLog(text_line_number,"%s: " format "\n", __func__ , ##__VA_ARGS__); }
   #define AIDBG(dblv,format, ...) {\
-    if (BFDEBUG_LEVEL > dblv)\
+    if ((BFDEBUG_LEVEL > dblv) && (log_channel_level[LbLogCh_AI] > dblv))\
       LbAiLog("%s: " format "\n", __func__ , ##__VA_ARGS__); }
 #else
   #define SYNCDBG(dblv,format, ...)
@@ -197,6 +197,8 @@ typedef unsigned char ThingClass;
 typedef unsigned char ThingModel;
 /** Type which stores thing index. */
 typedef unsigned short ThingIndex;
+/** Type which stores thing index with generation of its slot; allows detecting stale references. */
+typedef unsigned long ThingHandle;
 /** Type which stores creature state index. */
 typedef unsigned short CrtrStateId;
 /** Type which stores creature experience level. */
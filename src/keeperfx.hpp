@@ -98,7 +98,8 @@ enum AutotestFlags {
     ATF_ExitOnTurn          = 0x01, // Exit from a game after some time
     ATF_FixedSeed           = 0x02, // Set randomseed to 1 on game start
     ATF_AI_Player           = 0x04, // Activate Ai player on level start
-    ATF_TestsCampaign       = 0x08  // Switch to testing levels
+    ATF_TestsCampaign       = 0x08, // Switch to testing levels
+    ATF_InjectDesync        = 0x10  // Modify a creature on given turn, to test desync location
 };
 #endif
 
@@ -131,12 +132,15 @@ struct StartupParameters {
     unsigned char packet_load_enable;
     char packet_fname[150];
     unsigned char packet_checksum_verify;
+    /** Packet file turn to which the replay is moved at start. */
+    GameTurn packet_seek_turn;
     unsigned char force_ppro_poly;
     int frame_skip;
     char selected_campaign[CMDLN_MAXLEN+1];
 #ifdef AUTOTESTING
     unsigned char autotest_flags;
     unsigned long autotest_exit_turn;
+    unsigned long autotest_desync_turn;
 #endif
 };
 
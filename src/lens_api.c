@@ -19,6 +19,7 @@
 #include "lens_api.h"
 
 #include <math.h>
+#include <SDL2/SDL.h>
 #include "globals.h"
 #include "bflib_basics.h"
 #include "bflib_memory.h"
@@ -40,6 +41,157 @@ extern "C" {
 void init_lens(unsigned long *lens_mem, int width, int height, int pitch, int nlens, int mag, int period);
 void draw_displacement_lens(unsigned char *dstbuf, unsigned char *srcbuf, unsigned long *lens_mem, int width, int height, int scanln);
 /******************************************************************************/
+#define LENS_BLIT_THREADS_MAX 3
+/** Images with less lines are drawn by the game thread only. */
+#define LENS_BLIT_MIN_LINES 240
+
+struct LensBlitParams {
+    unsigned char *dstbuf;
+    long dstpitch;
+    unsigned char *srcbuf;
+    long srcpitch;
+    long width;
+    long height;
+};
+
+/** Callback which draws lines from start_h up to (but not including) end_h. */
+typedef void (*LensBlitBandFunc)(const struct LensBlitParams *blit, long start_h, long end_h);
+
+/**
+ * Worker threads which draw lens effects in bands of lines.
+ * The game thread draws a band as well, then waits for all bands to finish.
+ */
+struct LensBlitWorkers {
+    SDL_Thread *threads[LENS_BLIT_THREADS_MAX];
+    int threads_num;
+    SDL_mutex *mutex;
+    SDL_cond *cond;
+    TbBool exit;
+    LensBlitBandFunc band_func;
+    const struct LensBlitParams *blit;
+    long start_h;
+    long end_h;
+    long bands_num;
+    long bands_next;
+    long bands_done;
+};
+
+static struct LensBlitWorkers lens_workers;
+/******************************************************************************/
+
+/**
+ * Draws bands of the current job, until there are none left.
+ * Needs to be called with workers mutex locked; returns with the mutex locked.
+ */
+static void lens_workers_draw_bands(struct LensBlitWorkers *lwork)
+{
+    while (lwork->bands_next < lwork->bands_num)
+    {
+        long band = lwork->bands_next++;
+        long lines = lwork->end_h - lwork->start_h;
+        long band_start = lwork->start_h + lines * band / lwork->bands_num;
+        long band_end = lwork->start_h + lines * (band + 1) / lwork->bands_num;
+        SDL_UnlockMutex(lwork->mutex);
+        lwork->band_func(lwork->blit, band_start, band_end);
+        SDL_LockMutex(lwork->mutex);
+        lwork->bands_done++;
+        if (lwork->bands_done >= lwork->bands_num)
+            SDL_CondBroadcast(lwork->cond);
+    }
+}
+
+static int lens_blit_worker_thread(void *data)
+{
+    struct LensBlitWorkers *lwork = (struct LensBlitWorkers *)data;
+    SDL_LockMutex(lwork->mutex);
+    while (!lwork->exit)
+    {
+        if (lwork->bands_next < lwork->bands_num)
+            lens_workers_draw_bands(lwork);
+        else
+            SDL_CondWait(lwork->cond, lwork->mutex);
+    }
+    SDL_UnlockMutex(lwork->mutex);
+    return 0;
+}
+
+static void lens_workers_start(void)
+{
+    struct LensBlitWorkers *lwork = &lens_workers;
+    if (lwork->mutex != NULL)
+        return;
+    lwork->mutex = SDL_CreateMutex();
+    lwork->cond = SDL_CreateCond();
+    lwork->exit = false;
+    lwork->bands_num = 0;
+    lwork->bands_next = 0;
+    lwork->bands_done = 0;
+    int threads_num = SDL_GetCPUCount() - 1;
+    if (threads_num > LENS_BLIT_THREADS_MAX)
+        threads_num = LENS_BLIT_THREADS_MAX;
+    int i;
+    for (i = 0; i < threads_num; i++)
+    {
+        lwork->threads[i] = SDL_CreateThread(lens_blit_worker_thread, "LensBlit", lwork);
+        if (lwork->threads[i] == NULL)
+        {
+            WARNLOG("Cannot create lens blit thread: %s", SDL_GetError());
+            break;
+        }
+    }
+    lwork->threads_num = i;
+    SYNCDBG(8,"Started %d lens blit threads",lwork->threads_num);
+}
+
+static void lens_workers_stop(void)
+{
+    struct LensBlitWorkers *lwork = &lens_workers;
+    if (lwork->mutex == NULL)
+        return;
+    SDL_LockMutex(lwork->mutex);
+    lwork->exit = true;
+    SDL_CondBroadcast(lwork->cond);
+    SDL_UnlockMutex(lwork->mutex);
+    int i;
+    for (i = 0; i < lwork->threads_num; i++)
+        SDL_WaitThread(lwork->threads[i], NULL);
+    lwork->threads_num = 0;
+    SDL_DestroyCond(lwork->cond);
+    lwork->cond = NULL;
+    SDL_DestroyMutex(lwork->mutex);
+    lwork->mutex = NULL;
+}
+
+/**
+ * Draws lines from start_h to end_h with given function, splitting them into bands drawn concurrently.
+ * Returns after all lines are drawn.
+ */
+static void lens_blit_in_bands(LensBlitBandFunc band_func, const struct LensBlitParams *blit, long start_h, long end_h)
+{
+    struct LensBlitWorkers *lwork = &lens_workers;
+    if (end_h - start_h >= LENS_BLIT_MIN_LINES)
+        lens_workers_start();
+    if ((end_h - start_h < LENS_BLIT_MIN_LINES) || (lwork->threads_num < 1))
+    {
+        band_func(blit, start_h, end_h);
+        return;
+    }
+    SDL_LockMutex(lwork->mutex);
+    lwork->band_func = band_func;
+    lwork->blit = blit;
+    lwork->start_h = start_h;
+    lwork->end_h = end_h;
+    lwork->bands_num = lwork->threads_num + 1;
+    lwork->bands_next = 0;
+    lwork->bands_done = 0;
+    SDL_CondBroadcast(lwork->cond);
+    lens_workers_draw_bands(lwork);
+    while (lwork->bands_done < lwork->bands_num)
+        SDL_CondWait(lwork->cond, lwork->mutex);
+    lwork->bands_num = 0;
+    lwork->bands_next = 0;
+    SDL_UnlockMutex(lwork->mutex);
+}
 
 void init_lens(unsigned long *lens_mem, int width, int height, int pitch, int nlens, int mag, int period)
 {
@@ -167,6 +319,7 @@ void set_lens_palette(unsigned char *palette)
 void reset_eye_lenses(void)
 {
     SYNCDBG(7,"Starting");
+    lens_workers_stop();
     free_mist();
     clear_lens_palette();
     if (eye_lens_memory != NULL)
@@ -292,16 +445,45 @@ void draw_displacement_lens(unsigned char *dstbuf, unsigned char *srcbuf, unsign
     unsigned long* mem = lens_mem;
     for (int h = 0; h < height; h++)
     {
-        for (int w = 0; w < width; w++)
+        int w;
+        // Gather four pixels at a time; lookups don't depend on each other
+        for (w = 0; w + 4 <= width; w += 4)
+        {
+            unsigned char px0 = srcbuf[mem[0]];
+            unsigned char px1 = srcbuf[mem[1]];
+            unsigned char px2 = srcbuf[mem[2]];
+            unsigned char px3 = srcbuf[mem[3]];
+            dst[w] = px0;
+            dst[w+1] = px1;
+            dst[w+2] = px2;
+            dst[w+3] = px3;
+            mem += 4;
+        }
+        for (; w < width; w++)
         {
-            long pos_map = *mem;
-            dst[w] = srcbuf[pos_map];
+            dst[w] = srcbuf[*mem];
             mem++;
         }
         dst += dstpitch;
     }
 }
 
+static void draw_displacement_lens_band(const struct LensBlitParams *blit, long start_h, long end_h)
+{
+    draw_displacement_lens(blit->dstbuf + start_h * blit->dstpitch, blit->srcbuf,
+        eye_lens_memory + start_h * blit->width, blit->width, end_h - start_h, blit->dstpitch);
+}
+
+static void draw_flyeye_lens_band(const struct LensBlitParams *blit, long start_h, long end_h)
+{
+    flyeye_blitsec(blit->srcbuf, blit->srcpitch, blit->dstbuf, blit->dstpitch, start_h, end_h);
+}
+
+static void draw_mist_lens_band(const struct LensBlitParams *blit, long start_h, long end_h)
+{
+    draw_mist_lines(blit->dstbuf, blit->dstpitch, blit->srcbuf, blit->srcpitch, blit->width, blit->height, start_h, end_h);
+}
+
 void draw_copy(unsigned char *dstbuf, long dstpitch, unsigned char *srcbuf, long srcpitch, long width, long height)
 {
     unsigned char* dst = dstbuf;
@@ -324,9 +506,17 @@ void draw_lens_effect(unsigned char *dstbuf, long dstpitch, unsigned char *srcbu
         effect = 0;
     }
     struct LensConfig* lenscfg = &lenses_conf.lenses[effect];
+    struct LensBlitParams blit;
+    blit.dstbuf = dstbuf;
+    blit.dstpitch = dstpitch;
+    blit.srcbuf = srcbuf;
+    blit.srcpitch = srcpitch;
+    blit.width = width;
+    blit.height = height;
     if ((lenscfg->flags & LCF_HasMist) != 0)
     {
-        draw_mist(dstbuf, dstpitch, srcbuf, srcpitch, width, height);
+        lens_blit_in_bands(draw_mist_lens_band, &blit, 0, height);
+        animate_mist();
         copied = true;
     }
     if ((lenscfg->flags & LCF_HasDisplace) != 0)
@@ -335,12 +525,11 @@ void draw_lens_effect(unsigned char *dstbuf, long dstpitch, unsigned char *srcbu
         {
         case 1:
         case 2:
-            draw_displacement_lens(dstbuf, srcbuf, eye_lens_memory,
-                width, height, dstpitch);
+            lens_blit_in_bands(draw_displacement_lens_band, &blit, 0, height);
             copied = true;
             break;
         case 3:
-            flyeye_blitsec(srcbuf, srcpitch, dstbuf, dstpitch, 1, height);
+            lens_blit_in_bands(draw_flyeye_lens_band, &blit, 1, height);
             copied = true;
             break;
         }
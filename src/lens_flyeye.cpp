@@ -35,7 +35,7 @@ class CHex {
     void BlitHex(void);
     void DrawOutline(void);
     static void AddScan(struct CScan *scan, long a2, long a3, long a4, long a5);
-    static void BlitScan(struct CScan *scan, long h);
+    static void BlitScan(struct CScan *scan, long h, unsigned char *dstbuf, long dstpitch, const unsigned char *srcbuf, long srcpitch);
  private:
     long arrA[6];
     long arrB[6];
@@ -43,10 +43,6 @@ class CHex {
     long source_strip_h;
 };
 /******************************************************************************/
-static unsigned char *lens_Source;
-static long lens_SourcePitch;
-static unsigned char *lens_Screen;
-static long lens_ScreenPitch;
 struct CScan *ScanBuffer;
 /******************************************************************************/
 CHex::CHex(long width, long height)
@@ -253,13 +249,14 @@ void flyeye_setup(long width, long height)
 
 /**
  * Draws displacement on image line, based on given CScan data.
+ * Only reads the source and writes given line of destination, so lines may be drawn concurrently.
  * @param scan
  * @param h
  */
-void CHex::BlitScan(struct CScan *scan, long h)
+void CHex::BlitScan(struct CScan *scan, long h, unsigned char *dstbuf, long dstpitch, const unsigned char *srcbuf, long srcpitch)
 {
   unsigned char *dst;
-  unsigned char *src;
+  const unsigned char *src;
   long shift_w;
   long shift_h;
   long w;
@@ -275,11 +272,11 @@ void CHex::BlitScan(struct CScan *scan, long h)
           end_w = scan->strip_len[i+1];
       shift_w = (long)scan->strip_w[i] + w;
       shift_h = (long)scan->strip_h[i] + h;
-      dst = &lens_Screen[h * lens_ScreenPitch + w];
-      src = &lens_Source[shift_h * lens_SourcePitch + shift_w];
+      dst = &dstbuf[h * dstpitch + w];
+      src = &srcbuf[shift_h * srcpitch + shift_w];
       //some debug code
-      //if ((shift_w > lens_ScreenPitch) || (shift_h > 1022) || (end_w - w < 0) || (shift_w + end_w - w > lens_ScreenPitch)) {
-      //    ERRORLOG("POS(%d,%d) DST(%d,%d) SRC(%d,%d) LEN %d",w,h,(dst-lens_Screen)%lens_ScreenPitch,(dst-lens_Screen)/lens_ScreenPitch,(src-lens_Source)%lens_SourcePitch,(src-lens_Source)/lens_SourcePitch,end_w - w);
+      //if ((shift_w > dstpitch) || (shift_h > 1022) || (end_w - w < 0) || (shift_w + end_w - w > dstpitch)) {
+      //    ERRORLOG("POS(%d,%d) DST(%d,%d) SRC(%d,%d) LEN %d",w,h,(dst-dstbuf)%dstpitch,(dst-dstbuf)/dstpitch,(src-srcbuf)%srcpitch,(src-srcbuf)/srcpitch,end_w - w);
       //    break;
       //}
       memcpy(dst, src, end_w - w);
@@ -299,14 +296,10 @@ void flyeye_blitsec(unsigned char *srcbuf, long srcpitch, unsigned char *dstbuf,
 {
     long h;
     SYNCDBG(16,"Starting");
-    lens_Source = srcbuf;
-    lens_SourcePitch = srcpitch;
-    lens_Screen = dstbuf;
-    lens_ScreenPitch = dstpitch;
     // Draw lines
     for (h=start_h; h < end_h; h++)
     {
-        CHex::BlitScan(&ScanBuffer[h], h);
+        CHex::BlitScan(&ScanBuffer[h], h, dstbuf, dstpitch, srcbuf, srcpitch);
     }
 }
 /******************************************************************************/
@@ -30,7 +30,7 @@ class CMistFade {
     virtual ~CMistFade(void);
     void setup(unsigned char *lens_mem, unsigned char *fade, unsigned char *ghost);
     void animset(long a1, long a2);
-    void mist(unsigned char *dstbuf, long dstwidth, unsigned char *srcbuf, long srcwidth, long width, long height);
+    void mist(unsigned char *dstbuf, long dstwidth, unsigned char *srcbuf, long srcwidth, long width, long height, long start_h, long end_h);
     void animate(void);
   protected:
     /** Mist data width and height are the same and equal to this dimension */
@@ -87,7 +87,14 @@ void CMistFade::animate(void)
   this->field_F += this->field_1B;
 }
 
-void CMistFade::mist(unsigned char *dstbuf, long dstpitch, unsigned char *srcbuf, long srcpitch, long width, long height)
+/**
+ * Draws mist on given lines of the image.
+ * Counters at start of each line only depend on line number, so the image
+ * may be drawn in separate bands, in any order.
+ * @param start_h First line to draw.
+ * @param end_h Line beyond end of the drawn area.
+ */
+void CMistFade::mist(unsigned char *dstbuf, long dstpitch, unsigned char *srcbuf, long srcpitch, long width, long height, long start_h, long end_h)
 {
     unsigned char *src;
     unsigned char *dst;
@@ -107,15 +114,30 @@ void CMistFade::mist(unsigned char *dstbuf, long dstpitch, unsigned char *srcbuf
         ERRORLOG("Can't draw Mist as it's not initialized!");
         return;
     }
-    src = srcbuf;
-    dst = dstbuf;
+    src = srcbuf + start_h * srcpitch;
+    dst = dstbuf + start_h * dstpitch;
     p2 = this->field_C;
     c2 = this->field_D;
     p1 = this->field_E;
     c1 = this->field_F;
     lens_div = width/(2*lens_dim);
     if (lens_div < 1) lens_div = 1;
-    for (h=height; h > 0; h--)
+    // Skip the lines before start; every line moves the counters by the same amount.
+    // Counters are unsigned and lens_dim divides their range, so wrapping doesn't matter.
+    unsigned long line_steps = width / lens_div;
+    for (h=height; h > height-start_h; h--)
+    {
+        c1 = (c1 - line_steps) % lens_dim;
+        p2 = (p2 + line_steps) % lens_dim;
+        if ((h%lens_div) == 0)
+        {
+            c1 = (c1 + width) % lens_dim;
+            p2 = (p2 - width) % lens_dim;
+            c2 = (c2 + 1) % lens_dim;
+            p1 = (p1 - 1) % lens_dim;
+        }
+    }
+    for (h=height-start_h; h > height-end_h; h--)
     {
         for (w=width; w > 0; w--)
         {
@@ -174,11 +196,32 @@ TbBool draw_mist(unsigned char *dstbuf, long dstpitch, unsigned char *srcbuf, lo
         WARNLOG("Tried to use uninitialized mist!");
         return false;
     }
-    mist->mist(dstbuf, dstpitch, srcbuf, srcpitch, width, height);
+    mist->mist(dstbuf, dstpitch, srcbuf, srcpitch, width, height, 0, height);
     mist->animate();
     return true;
 }
 
+/**
+ * Draws mist on a band of lines, without animating it.
+ * Bands of one frame may be drawn concurrently; animate_mist() should be called after all of them.
+ */
+TbBool draw_mist_lines(unsigned char *dstbuf, long dstpitch, unsigned char *srcbuf, long srcpitch, long width, long height, long start_h, long end_h)
+{
+    if (mist == NULL)
+    {
+        WARNLOG("Tried to use uninitialized mist!");
+        return false;
+    }
+    mist->mist(dstbuf, dstpitch, srcbuf, srcpitch, width, height, start_h, end_h);
+    return true;
+}
+
+void animate_mist(void)
+{
+    if (mist != NULL)
+        mist->animate();
+}
+
 void setup_mist(unsigned char *lens_mem, unsigned char *fade, unsigned char *ghost)
 {
     SYNCDBG(8,"Starting");
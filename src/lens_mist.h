@@ -28,6 +28,8 @@ extern "C" {
 /******************************************************************************/
 void setup_mist(unsigned char *lens_mem, unsigned char *fade, unsigned char *ghost);
 TbBool draw_mist(unsigned char *dstbuf, long dstpitch, unsigned char *srcbuf, long srcpitch, long width, long height);
+TbBool draw_mist_lines(unsigned char *dstbuf, long dstpitch, unsigned char *srcbuf, long srcpitch, long width, long height, long start_h, long end_h);
+void animate_mist(void);
 void free_mist(void);
 /******************************************************************************/
 #ifdef __cplusplus
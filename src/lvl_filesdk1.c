@@ -1101,7 +1101,7 @@ short load_map_slab_file(unsigned long lv_num)
           WARNMSG("Slab Type %d exceeds limit of %d",(int)n,SLAB_TYPES_COUNT);
           n = SlbT_ROCK;
         }
-        slb->kind = n;
+        slabmap_set_kind(slb, n);
         i += 2;
       }
     LbMemoryFree(buf);
@@ -58,6 +58,7 @@
 #include "lvl_script.h"
 #include "lvl_filesdk1.h"
 #include "thing_list.h"
+#include "creature_senses.h"
 #include "player_instances.h"
 #include "player_utils.h"
 #include "player_states.h"
@@ -117,6 +118,7 @@
 #include "frontmenu_ingame_tabs.h"
 #include "ariadne.h"
 #include "net_game.h"
+#include "net_checksums.h"
 #include "sounds.h"
 #include "vidfade.h"
 #include "KeeperSpeech.h"
@@ -136,6 +138,11 @@
 
 int test_variable;
 
+#ifdef AUTOTESTING
+/** Exit code of the process; non-zero if autotest detected a failure. */
+static int autotest_exit_code = 0;
+#endif
+
 char cmndline[CMDLN_MAXLEN+1];
 unsigned short bf_argc;
 char *bf_argv[CMDLN_MAXLEN+1];
@@ -1413,10 +1420,10 @@ void reinit_tagged_blocks_for_player(PlayerNumber plyr_idx)
     struct Dungeon *dungeon;
     dungeon = get_dungeon(plyr_idx);
     int task_idx;
-    for (task_idx = 0; task_idx < dungeon->highest_task_number; task_idx++)
+    for (task_idx = 0; task_idx < get_dungeon_highest_task_number(dungeon); task_idx++)
     {
         struct MapTask  *mtask;
-        mtask = &dungeon->task_list[task_idx];
+        mtask = get_dungeon_task_list_entry(dungeon, task_idx);
         MapSubtlCoord taskstl_x;
         MapSubtlCoord taskstl_y;
         taskstl_x = stl_num_decode_x(mtask->coords);
@@ -1543,6 +1550,16 @@ void reinit_level_after_load(void)
     }
     start_rooms = &game.rooms[1];
     end_rooms = &game.rooms[ROOMS_COUNT];
+    invalidate_room_kind_indexes();
+    for (i=0; i < DUNGEONS_COUNT; i++)
+    {
+        rebuild_task_list_index(i);
+    }
+    rebuild_events_index();
+    reinit_thing_slots_tracking();
+    rebuild_creature_cells_index();
+    rebuild_sync_checksums();
+    clear_line_of_sight_cache();
     load_texture_map_file(game.texture_id, 2);
     init_animating_texture_maps();
 
@@ -1730,6 +1747,7 @@ void delete_all_thing_structures(void)
       game.free_things[i] = i+1;
     }
     game.free_things_start_index = 0;
+    reinit_thing_slots_tracking();
 }
 
 void delete_all_structures(void)
@@ -3652,11 +3670,34 @@ void keeper_gameplay_loop(void)
 #ifdef AUTOTESTING
         if ((start_params.autotest_flags & ATF_ExitOnTurn) && (start_params.autotest_exit_turn == game.play_gameturn))
         {
+            if (game.packet_load_enable)
+            {
+                // Replay is only proven to match the recorded game if checksums were compared
+                unsigned long verified;
+                unsigned long mismatched;
+                get_packet_replay_verification(&verified, &mismatched);
+                SYNCMSG("Packet replay checksums at turn %lu: %lu verified, %lu mismatched",
+                    (unsigned long)game.play_gameturn, verified, mismatched);
+                evm_stat(1, "replay.checksums verified=%lu,mismatched=%lu", verified, mismatched);
+                if ((mismatched > 0) || (verified == 0))
+                    autotest_exit_code = 1;
+            }
             quit_game = true;
             exit_keeper = true;
             break;
         }
         evm_stat(1, "turn val=%ld,action_seed=%ld,unsync_seed=%ld", game.play_gameturn, game.action_rand_seed, game.unsync_rand_seed);
+        if ((start_params.autotest_flags & ATF_InjectDesync) && (start_params.autotest_desync_turn == game.play_gameturn))
+        {
+            // Only this instance is modified, so other players should locate the desync in this creature
+            struct Thing* thing = thing_get(game.thing_lists[TngList_Creatures].index);
+            if (thing_exists(thing))
+            {
+                thing->health++;
+                SYNCLOG("Injected desync into thing %d",(int)thing->index);
+                evm_stat(1, "desync.injected,thing=%d cnt=1", (int)thing->index);
+            }
+        }
         if (start_params.autotest_flags & ATF_FixedSeed)
         {
             game.action_rand_seed = game.play_gameturn;
@@ -3668,6 +3709,8 @@ void keeper_gameplay_loop(void)
         do_draw = display_should_be_updated_this_turn() || (!LbIsActive());
 
         LbWindowsControl();
+        // Packet file keyframe has to be stored before inputs of the turn are applied
+        save_packet_file_keyframe();
         input_eastegg();
         input();
         update();
@@ -3687,6 +3730,9 @@ void keeper_gameplay_loop(void)
             LbScreenUnlock();
         }
 
+        // Release the savegame written in background, if it's done
+        process_background_save();
+
         // Music and sound control
         if ( !SoundDisabled )
         {
@@ -4079,6 +4125,9 @@ void init_level(void)
     game.loaded_swipe_idx = -1;
     game.play_gameturn = 0;
     clear_game();
+    rebuild_creature_cells_index();
+    rebuild_sync_checksums();
+    clear_line_of_sight_cache();
     reset_heap_manager();
     lens_mode = 0;
     setup_heap_manager();
@@ -4223,6 +4272,8 @@ void startup_saved_packet_game(void)
       game.turns_fastforward = game.turns_stored;
     post_init_level();
     post_init_players();
+    if (start_params.packet_seek_turn > 0)
+        seek_packet_file_to_turn(start_params.packet_seek_turn);
     set_selected_level_number(0);
     if (is_key_pressed(KC_LALT, KMod_NONE))
     {
@@ -4572,6 +4623,8 @@ void game_loop(void)
     if ((game.system_flags & GSF_CaptureMovie) != 0) {
         movie_record_stop();
     }
+    screen_capture_shutdown();
+    wait_for_background_save();
     SYNCDBG(7,"Done");
 }
 
@@ -4709,6 +4762,11 @@ short process_command_line(unsigned short argc, char *argv[])
          strncpy(start_params.packet_fname,pr2str,sizeof(start_params.packet_fname)-1);
          narg++;
       } else
+      if (strcasecmp(parstr,"packetseek") == 0)
+      {
+         start_params.packet_seek_turn = atol(pr2str);
+         narg++;
+      } else
       if (strcasecmp(parstr,"packetsave") == 0)
       {
          if (start_params.packet_load_enable)
@@ -4738,6 +4796,12 @@ short process_command_line(unsigned short argc, char *argv[])
       {
 	      start_params.debug_flags |= DFlg_CreatrPaths;
       } else
+      if (strcasecmp(parstr, "loglevel") == 0)
+      {
+          if (LbLogSetChannelLevel(pr2str, atoi(pr3str)) != Lb_SUCCESS)
+              WARNMSG("Unrecognized log channel '%s'.",pr2str);
+          narg += 2;
+      } else
       if (strcasecmp(parstr, "compuchat") == 0)
       {
           if (strcasecmp(pr2str,"scarce") == 0) {
@@ -4770,6 +4834,12 @@ short process_command_line(unsigned short argc, char *argv[])
          start_params.autotest_exit_turn = atol(pr2str);
          narg++;
       } else
+      if (strcasecmp(parstr, "desync_at_turn") == 0)
+      {
+         set_flag_byte(&start_params.autotest_flags, ATF_InjectDesync, true);
+         start_params.autotest_desync_turn = atol(pr2str);
+         narg++;
+      } else
       if (strcasecmp(parstr, "fixed_seed") == 0)
       {
          set_flag_byte(&start_params.autotest_flags, ATF_FixedSeed, true);
@@ -4912,7 +4982,11 @@ int LbBullfrogMain(unsigned short argc, char *argv[])
         SYNCDBG(0,"finished properly");
     }
     LbErrorLogClose();
+#ifdef AUTOTESTING
+    return autotest_exit_code;
+#else
     return 0;
+#endif
 }
 
 void get_cmdln_args(unsigned short &argc, char *argv[])
@@ -5016,8 +5090,9 @@ int main(int argc, char *argv[])
   }
 #endif
 
+  int exit_code;
   try {
-  LbBullfrogMain(bf_argc, bf_argv);
+  exit_code = LbBullfrogMain(bf_argc, bf_argv);
   } catch (...)
   {
       text = buf_sprintf("Exception raised!");
@@ -5027,7 +5102,7 @@ int main(int argc, char *argv[])
 
 //  LbFileSaveAt("!tmp_file", &_DK_game, sizeof(struct Game));
 
-  return 0;
+  return exit_code;
 }
 
 #ifdef __cplusplus
@@ -1351,7 +1351,7 @@ void dump_slab_on_map(SlabKind slbkind, long slabct_num, MapSubtlCoord stl_x, Ma
     }
 
     slb = get_slabmap_block(slb_x, slb_y);
-    slb->kind = slbkind;
+    slabmap_set_kind(slb, slbkind);
     pannel_map_update(stl_xa, stl_ya, STL_PER_SLB, STL_PER_SLB);
     if ((slbkind == SlbT_GUARDPOST) || (slbkind == SlbT_BRIDGE) || (slbkind == SlbT_GEMS))
     {
@@ -1388,6 +1388,7 @@ void place_animating_slab_type_on_map(SlabKind slbkind, char ani_frame, MapSubtl
     }
     delete_attached_things_on_slab(slb_x, slb_y);
     dump_slab_on_map(slbkind, 840 + 8 * slbkind + ani_frame, stl_x, stl_y, owner);
+    map_blocks_changed();
     shuffle_unattached_things_on_slab(slb_x, slb_y);
     int i;
     for (i = 0; i < AROUND_EIGHT_LENGTH; i++)
@@ -1518,7 +1519,7 @@ void place_slab_type_on_map_f(SlabKind nslab, MapSubtlCoord stl_x, MapSubtlCoord
             all_players_untag_blocks_for_digging_in_area(slb_x, slb_y);
         }
     }
-    slb->kind = skind;
+    slabmap_set_kind(slb, skind);
 
     set_whole_slab_owner(slb_x, slb_y, owner);
     place_single_slab_type_on_map(skind, slb_x, slb_y, owner);
@@ -1537,9 +1538,9 @@ void place_slab_type_on_map_f(SlabKind nslab, MapSubtlCoord stl_x, MapSubtlCoord
           if (slb->kind == SlbT_EARTH)
           {
               if (torch_flags_for_slab(spos_x, spos_y) == 0)
-                  slb->kind = SlbT_EARTH;
+                  slabmap_set_kind(slb, SlbT_EARTH);
               else
-                  slb->kind = SlbT_TORCHDIRT;
+                  slabmap_set_kind(slb, SlbT_TORCHDIRT);
           }
       }
     } else
@@ -1553,7 +1554,7 @@ void place_slab_type_on_map_f(SlabKind nslab, MapSubtlCoord stl_x, MapSubtlCoord
               continue;
           if (!slab_kind_is_animated(slb->kind))
           {
-              slb->kind = alter_rock_style(slb->kind, spos_x, spos_y, owner);
+              slabmap_set_kind(slb, alter_rock_style(slb->kind, spos_x, spos_y, owner));
           }
       }
     }
@@ -2279,7 +2280,37 @@ unsigned short get_point_in_map_solid_flags_ignoring_own_door(const struct Coord
 void fill_in_reinforced_corners(PlayerNumber plyr_idx, MapSlabCoord slb_x, MapSlabCoord slb_y)
 {
     SYNCDBG(16,"Starting");
-    _DK_fill_in_reinforced_corners(plyr_idx, slb_x, slb_y); return;
+    // DLL places the corner slabs without our setters; remember the area to report what it changed
+    SlabKind prev_kind[3][3];
+    PlayerNumber prev_owner[3][3];
+    long dx;
+    long dy;
+    for (dy = 0; dy < 3; dy++)
+    {
+        for (dx = 0; dx < 3; dx++)
+        {
+            struct SlabMap* slb = get_slabmap_block(slb_x + dx - 1, slb_y + dy - 1);
+            prev_kind[dy][dx] = slb->kind;
+            prev_owner[dy][dx] = slabmap_owner(slb);
+        }
+    }
+    _DK_fill_in_reinforced_corners(plyr_idx, slb_x, slb_y);
+    TbBool changed = false;
+    for (dy = 0; dy < 3; dy++)
+    {
+        for (dx = 0; dx < 3; dx++)
+        {
+            struct SlabMap* slb = get_slabmap_block(slb_x + dx - 1, slb_y + dy - 1);
+            if (slabmap_note_direct_change(slb, prev_kind[dy][dx], prev_owner[dy][dx]))
+                changed = true;
+        }
+    }
+    // DLL also updates PannelMap and map blocks by itself, bypassing our change tracking
+    if (changed)
+    {
+        PannelMapGeneration++;
+        map_blocks_changed();
+    }
 }
 
 unsigned char choose_pretty_type(PlayerNumber plyr_idx, MapSlabCoord slb_x, MapSlabCoord slb_y)
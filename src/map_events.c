@@ -43,50 +43,113 @@ extern "C" {
 /******************************************************************************/
 DLLIMPORT long _DK_event_move_player_towards_event(struct PlayerInfo *player, long var);
 
+/******************************************************************************/
+#define EVENT_INDEX_WORDS ((EVENTS_COUNT + 31) / 32)
+/** Bitmaps of existing events of each kind owned by each player. Not saved; rebuilt from the events array. */
+static unsigned long events_of_kind[DUNGEONS_COUNT][EVENT_KIND_COUNT][EVENT_INDEX_WORDS];
 /******************************************************************************/
 TbBool event_is_invalid(const struct Event *event)
 {
     return (event <= &game.event[0]) || (event > &game.event[EVENTS_COUNT-1]) || (event == NULL);
 }
 
-struct Event *get_event_nearby_of_type_for_player(MapCoord map_x, MapCoord map_y, long max_dist, EventKind evkind, PlayerNumber plyr_idx)
+static unsigned long *get_events_of_kind_bitmap(PlayerNumber plyr_idx, EventKind evkind)
+{
+    if ((plyr_idx < 0) || (plyr_idx >= DUNGEONS_COUNT) || (evkind <= EvKind_Nothing) || (evkind >= EVENT_KIND_COUNT))
+        return NULL;
+    return events_of_kind[plyr_idx][evkind];
+}
+
+static void event_index_add(const struct Event *event)
+{
+    unsigned long* bitmap = get_events_of_kind_bitmap(event->owner, event->kind);
+    if (bitmap != NULL)
+        bitmap[event->index / 32] |= (1UL << (event->index % 32));
+}
+
+static void event_index_remove(const struct Event *event)
+{
+    unsigned long* bitmap = get_events_of_kind_bitmap(event->owner, event->kind);
+    if (bitmap != NULL)
+        bitmap[event->index / 32] &= ~(1UL << (event->index % 32));
+}
+
+/**
+ * Re-creates index of events by owner and kind from the events array.
+ * Needs to be called after the events were loaded or cleared.
+ */
+void rebuild_events_index(void)
 {
+    LbMemorySet(events_of_kind, 0, sizeof(events_of_kind));
     for (int i = 1; i < EVENTS_COUNT; i++)
     {
         struct Event* event = &game.event[i];
-        if (((event->flags & EvF_Exists) != 0) && (event->owner == plyr_idx) && (event->kind == evkind)
-         && get_distance_xy(event->mappos_x, event->mappos_y, map_x, map_y) < max_dist) {
-            return event;
+        if ((event->flags & EvF_Exists) != 0) {
+            event_index_add(event);
+        }
+    }
+}
+
+/**
+ * Returns next event of given kind owned by given player, in order of event indexes.
+ * @param evidx Index of the previous event, or 0 to get the first one.
+ */
+static struct Event *get_next_event_of_type_for_player(EventIndex evidx, EventKind evkind, PlayerNumber plyr_idx)
+{
+    const unsigned long* bitmap = get_events_of_kind_bitmap(plyr_idx, evkind);
+    if (bitmap == NULL)
+        return INVALID_EVENT;
+    long i = evidx + 1;
+    while (i < EVENTS_COUNT)
+    {
+        unsigned long bits = (bitmap[i / 32] & 0xFFFFFFFFUL) >> (i % 32);
+        if (bits == 0)
+        {
+            i = (i / 32 + 1) * 32;
+            continue;
         }
+        if ((bits & 1) != 0)
+        {
+            struct Event* event = &game.event[i];
+            if (((event->flags & EvF_Exists) != 0) && (event->owner == plyr_idx) && (event->kind == evkind))
+                return event;
+        }
+        i++;
     }
     return INVALID_EVENT;
 }
 
-struct Event *get_event_of_target_and_type_for_player(long target, EventKind evkind, PlayerNumber plyr_idx)
+struct Event *get_event_nearby_of_type_for_player(MapCoord map_x, MapCoord map_y, long max_dist, EventKind evkind, PlayerNumber plyr_idx)
 {
-    for (int i = 1; i < EVENTS_COUNT; i++)
+    struct Event* event = get_next_event_of_type_for_player(0, evkind, plyr_idx);
+    while (!event_is_invalid(event))
     {
-        struct Event* event = &game.event[i];
-        if (((event->flags & EvF_Exists) != 0) && (event->owner == plyr_idx) && (event->kind == evkind)
-         && (event->target == target)) {
+        if (get_distance_xy(event->mappos_x, event->mappos_y, map_x, map_y) < max_dist) {
             return event;
         }
+        event = get_next_event_of_type_for_player(event->index, evkind, plyr_idx);
     }
     return INVALID_EVENT;
 }
 
-struct Event *get_event_of_type_for_player(EventKind evkind, PlayerNumber plyr_idx)
+struct Event *get_event_of_target_and_type_for_player(long target, EventKind evkind, PlayerNumber plyr_idx)
 {
-    for (int i = 1; i < EVENTS_COUNT; i++)
+    struct Event* event = get_next_event_of_type_for_player(0, evkind, plyr_idx);
+    while (!event_is_invalid(event))
     {
-        struct Event* event = &game.event[i];
-        if (((event->flags & EvF_Exists) != 0) && (event->owner == plyr_idx) && (event->kind == evkind)) {
+        if (event->target == target) {
             return event;
         }
+        event = get_next_event_of_type_for_player(event->index, evkind, plyr_idx);
     }
     return INVALID_EVENT;
 }
 
+struct Event *get_event_of_type_for_player(EventKind evkind, PlayerNumber plyr_idx)
+{
+    return get_next_event_of_type_for_player(0, evkind, plyr_idx);
+}
+
 /** Creates a map event or updates existing map event of given kind which is within 5 subtiles of the new event location.
  *
  * @param map_x Event position on map, X coord.
@@ -246,6 +309,7 @@ struct Event *event_allocate_free_event_structure(void)
 
 void event_initialise_event(struct Event *event, MapCoord map_x, MapCoord map_y, EventKind evkind, unsigned char dngn_id, long target)
 {
+    event_index_remove(event);
     event->mappos_x = map_x;
     event->mappos_y = map_y;
     event->kind = evkind;
@@ -253,10 +317,12 @@ void event_initialise_event(struct Event *event, MapCoord map_x, MapCoord map_y,
     event->lifespan_turns = event_button_info[evkind].lifespan_turns;
     event->target = target;
     event->flags |= EvF_BtnFirstFall;
+    event_index_add(event);
 }
 
 void event_delete_event_structure(long ev_idx)
 {
+    event_index_remove(&game.event[ev_idx]);
     LbMemorySet(&game.event[ev_idx], 0, sizeof(struct Event));
 }
 
@@ -746,6 +812,8 @@ struct Thing *event_is_attached_to_thing(EventIndex evidx)
 
 void event_process_events(void)
 {
+    // Events may also be created by the original DLL code; keep the index in sync once per turn
+    rebuild_events_index();
     for (long i = 0; i < EVENTS_COUNT; i++)
     {
         struct Event* event = &game.event[i];
@@ -847,6 +915,7 @@ void clear_events(void)
     {
       memset(&game.bookmark[i], 0, sizeof(struct Bookmark));
     }
+    rebuild_events_index();
 }
 /******************************************************************************/
 #ifdef __cplusplus
@@ -121,6 +121,7 @@ void event_update_last_use(struct Event *event);
 void go_on_then_activate_the_event_box(PlayerNumber plyr_idx, EventIndex evidx);
 int event_get_button_index(const struct Dungeon *dungeon, EventIndex evidx);
 void clear_events(void);
+void rebuild_events_index(void);
 void remove_events_thing_is_attached_to(struct Thing *thing);
 struct Thing *event_is_attached_to_thing(EventIndex evidx);
 void maintain_my_event_list(struct Dungeon *dungeon);
@@ -0,0 +1,400 @@
+/******************************************************************************/
+// Free implementation of Bullfrog's Dungeon Keeper strategy game.
+/******************************************************************************/
+/** @file net_checksums.c
+ *     Hierarchical checksums of game state.
+ * @par Purpose:
+ *     Keeps a tree of checksums - subsystems, buckets and single items, like
+ *     things, rooms or slabs. The tree is updated when items change, and
+ *     allows narrowing down a network desync to a single item.
+ * @par Comment:
+ *     Node hashes are sums of hashes of their children, so changing one
+ *     item only requires updating its bucket and subsystem.
+ *     Slabs are updated when they're modified. Things, rooms and players are
+ *     modified in too many places, some within the DLL, so their leaves are
+ *     updated in the per-turn loops which already compute their checksums;
+ *     the leaf is only re-hashed if the checksum has changed.
+ * @author   KeeperFX Team
+ * @date     19 Oct 2026 - 19 Oct 2026
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+/******************************************************************************/
+#include "net_checksums.h"
+
+#include "globals.h"
+#include "bflib_basics.h"
+#include "bflib_memory.h"
+
+#include "thing_data.h"
+#include "thing_list.h"
+#include "room_data.h"
+#include "slab_data.h"
+#include "player_data.h"
+#include "dungeon_data.h"
+#include "game_legacy.h"
+#include "keeperfx.hpp"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/******************************************************************************/
+#define SYNC_SLABS_COUNT (85*85)
+
+struct SyncChecksums {
+    unsigned long subsys_hash[SCkS_COUNT];
+    unsigned long bucket_hash[SCkS_COUNT][SYNC_CHECKSUM_BUCKETS];
+    /** Leaf hashes; zero means the item doesn't exist. */
+    unsigned long players_leaf[PLAYERS_COUNT+1];
+    unsigned long dungeons_leaf[DUNGEONS_COUNT];
+    unsigned long rooms_leaf[ROOMS_COUNT];
+    unsigned long slabs_leaf[SYNC_SLABS_COUNT];
+    unsigned long things_leaf[THINGS_COUNT];
+    /** Subsystem to which the thing leaf belongs; depends on thing class. */
+    unsigned char things_subsys[THINGS_COUNT];
+    /** Item checksums from which the leaf hashes were computed. */
+    TbBigChecksum players_sum[PLAYERS_COUNT+1];
+    TbBigChecksum dungeons_sum[DUNGEONS_COUNT];
+    TbBigChecksum rooms_sum[ROOMS_COUNT];
+    TbBigChecksum slabs_sum[SYNC_SLABS_COUNT];
+    TbBigChecksum things_sum[THINGS_COUNT];
+};
+
+static struct SyncChecksums sync_checksums;
+
+static const char *sync_checksum_subsystem_names[] = {
+    "players", "dungeons", "rooms", "slabs",
+};
+/******************************************************************************/
+/**
+ * Hashes a value of single item. Result is never zero, so existing item always differs from a missing one.
+ * Computed in 32 bits, so that the value is the same regardless of the size of long.
+ */
+static unsigned long sync_checksum_hash(int subsys, long item, TbBigChecksum sum)
+{
+    unsigned long h = ((unsigned long)sum * 0x9E3779B1UL) & 0xFFFFFFFFUL;
+    h ^= ((unsigned long)item << 8) ^ (unsigned long)subsys;
+    h ^= h >> 16;
+    h = (h * 0x85EBCA6BUL) & 0xFFFFFFFFUL;
+    h ^= h >> 13;
+    h = (h * 0xC2B2AE35UL) & 0xFFFFFFFFUL;
+    h ^= h >> 16;
+    return h | 1;
+}
+
+static long get_sync_checksum_items_count(int subsys)
+{
+    switch (subsys)
+    {
+    case SCkS_Players:
+        return PLAYERS_COUNT+1;
+    case SCkS_Dungeons:
+        return DUNGEONS_COUNT;
+    case SCkS_Rooms:
+        return ROOMS_COUNT;
+    case SCkS_Slabs:
+        return SYNC_SLABS_COUNT;
+    default:
+        if ((subsys >= SCkS_Things) && (subsys < SCkS_COUNT))
+            return THINGS_COUNT;
+        return 0;
+    }
+}
+
+static long get_sync_checksum_items_per_bucket(int subsys)
+{
+    return (get_sync_checksum_items_count(subsys) + SYNC_CHECKSUM_BUCKETS - 1) / SYNC_CHECKSUM_BUCKETS;
+}
+
+static unsigned long *get_sync_checksum_leaf_ptr(int subsys, long item)
+{
+    if ((item < 0) || (item >= get_sync_checksum_items_count(subsys)))
+        return NULL;
+    switch (subsys)
+    {
+    case SCkS_Players:
+        return &sync_checksums.players_leaf[item];
+    case SCkS_Dungeons:
+        return &sync_checksums.dungeons_leaf[item];
+    case SCkS_Rooms:
+        return &sync_checksums.rooms_leaf[item];
+    case SCkS_Slabs:
+        return &sync_checksums.slabs_leaf[item];
+    default:
+        return &sync_checksums.things_leaf[item];
+    }
+}
+
+static TbBigChecksum *get_sync_checksum_leaf_sum_ptr(int subsys, long item)
+{
+    if ((item < 0) || (item >= get_sync_checksum_items_count(subsys)))
+        return NULL;
+    switch (subsys)
+    {
+    case SCkS_Players:
+        return &sync_checksums.players_sum[item];
+    case SCkS_Dungeons:
+        return &sync_checksums.dungeons_sum[item];
+    case SCkS_Rooms:
+        return &sync_checksums.rooms_sum[item];
+    case SCkS_Slabs:
+        return &sync_checksums.slabs_sum[item];
+    default:
+        return &sync_checksums.things_sum[item];
+    }
+}
+
+static unsigned long get_sync_checksum_leaf(int subsys, long item)
+{
+    unsigned long *leaf = get_sync_checksum_leaf_ptr(subsys, item);
+    if (leaf == NULL)
+        return 0;
+    if ((subsys >= SCkS_Things) && (sync_checksums.things_subsys[item] != subsys))
+        return 0;
+    return *leaf;
+}
+
+/**
+ * Replaces leaf hash, and applies the difference to its bucket and subsystem.
+ */
+static void set_sync_checksum_leaf(int subsys, long item, unsigned long hash)
+{
+    unsigned long *leaf = get_sync_checksum_leaf_ptr(subsys, item);
+    if (leaf == NULL)
+        return;
+    unsigned long delta = hash - *leaf;
+    if (delta == 0)
+        return;
+    *leaf = hash;
+    long bucket = item / get_sync_checksum_items_per_bucket(subsys);
+    sync_checksums.bucket_hash[subsys][bucket] += delta;
+    sync_checksums.subsys_hash[subsys] += delta;
+}
+
+/**
+ * Sets leaf of an existing item from its checksum. Hashing is skipped if the checksum
+ * is the same as the one the leaf was computed from, which is true for most items in most turns.
+ */
+static void update_sync_checksum_leaf(int subsys, long item, TbBigChecksum sum)
+{
+    unsigned long *leaf = get_sync_checksum_leaf_ptr(subsys, item);
+    TbBigChecksum *leaf_sum = get_sync_checksum_leaf_sum_ptr(subsys, item);
+    if ((leaf == NULL) || (leaf_sum == NULL))
+        return;
+    if ((*leaf != 0) && (*leaf_sum == sum))
+        return;
+    *leaf_sum = sum;
+    set_sync_checksum_leaf(subsys, item, sync_checksum_hash(subsys, item, sum));
+}
+
+static TbBool set_sync_checksum_thing_subsys(ThingIndex tng_idx, int subsys)
+{
+    if ((tng_idx == 0) || (tng_idx >= THINGS_COUNT))
+        return false;
+    int prev_subsys = sync_checksums.things_subsys[tng_idx];
+    if ((prev_subsys != subsys) && (prev_subsys >= SCkS_Things))
+    {
+        // Thing slot was reused by another class; remove the leaf from previous subsystem
+        set_sync_checksum_leaf(prev_subsys, tng_idx, 0);
+    }
+    sync_checksums.things_subsys[tng_idx] = subsys;
+    return true;
+}
+/******************************************************************************/
+void clear_sync_checksums(void)
+{
+    LbMemorySet(&sync_checksums, 0, sizeof(struct SyncChecksums));
+}
+
+/**
+ * Fills the tree from current game state. Should be called by all players at the same time,
+ * as incremental updates only take place when items are processed.
+ */
+void rebuild_sync_checksums(void)
+{
+    SYNCDBG(8,"Starting");
+    clear_sync_checksums();
+    for (long i = 1; i < THINGS_COUNT; i++)
+    {
+        struct Thing* thing = thing_get(i);
+        if (thing_exists(thing) && (thing->class_id != TCls_AmbientSnd)) {
+            sync_checksum_update_thing(thing, get_thing_checksum(thing));
+        }
+    }
+    for (SlabCodedCoords slb_num = 0; slb_num < map_tiles_x*map_tiles_y; slb_num++)
+    {
+        sync_checksum_update_slab(get_slabmap_direct(slb_num));
+    }
+    // Rooms and players are updated every turn
+    sync_checksum_update_dungeons();
+    sync_checksum_update_random_seed();
+}
+
+void sync_checksum_update_thing(const struct Thing *thing, TbBigChecksum sum)
+{
+    if ((thing->class_id >= THING_CLASSES_COUNT) || !thing_exists(thing))
+        return;
+    int subsys = SCkS_Things + thing->class_id;
+    if (set_sync_checksum_thing_subsys(thing->index, subsys))
+        update_sync_checksum_leaf(subsys, thing->index, sum);
+}
+
+void sync_checksum_remove_thing(const struct Thing *thing)
+{
+    if (thing->class_id >= THING_CLASSES_COUNT)
+        return;
+    int subsys = SCkS_Things + thing->class_id;
+    if (set_sync_checksum_thing_subsys(thing->index, subsys))
+        set_sync_checksum_leaf(subsys, thing->index, 0);
+}
+
+void sync_checksum_update_room(const struct Room *room, TbBigChecksum sum)
+{
+    long room_idx = room - game.rooms;
+    if (!room_exists(room)) {
+        set_sync_checksum_leaf(SCkS_Rooms, room_idx, 0);
+        return;
+    }
+    sum += room->kind + ((TbBigChecksum)room->owner << 16);
+    update_sync_checksum_leaf(SCkS_Rooms, room_idx, sum);
+}
+
+void sync_checksum_update_slab(const struct SlabMap *slb)
+{
+    if (slabmap_block_invalid(slb))
+        return;
+    SlabCodedCoords slb_num = slb - game.slabmap;
+    TbBigChecksum sum = slb->kind + ((TbBigChecksum)slabmap_owner(slb) << 8);
+    update_sync_checksum_leaf(SCkS_Slabs, slb_num, sum);
+}
+
+void sync_checksum_update_player(PlayerNumber plyr_idx, TbBigChecksum sum)
+{
+    struct PlayerInfo* player = get_player(plyr_idx);
+    if (!player_exists(player)) {
+        set_sync_checksum_leaf(SCkS_Players, plyr_idx, 0);
+        return;
+    }
+    update_sync_checksum_leaf(SCkS_Players, plyr_idx, sum);
+}
+
+void sync_checksum_update_random_seed(void)
+{
+    update_sync_checksum_leaf(SCkS_Players, PLAYERS_COUNT, game.action_rand_seed);
+}
+
+void sync_checksum_update_dungeons(void)
+{
+    for (PlayerNumber plyr_idx = 0; plyr_idx < DUNGEONS_COUNT; plyr_idx++)
+    {
+        struct Dungeon* dungeon = get_dungeon(plyr_idx);
+        if (dungeon_invalid(dungeon)) {
+            set_sync_checksum_leaf(SCkS_Dungeons, plyr_idx, 0);
+            continue;
+        }
+        TbBigChecksum sum = (TbBigChecksum)dungeon->total_money_owned + (TbBigChecksum)dungeon->offmap_money_owned;
+        sum += ((TbBigChecksum)dungeon->num_active_creatrs << 24) + ((TbBigChecksum)dungeon->total_rooms << 16);
+        sum += ((TbBigChecksum)dungeon->total_doors << 8) + (TbBigChecksum)dungeon->total_area;
+        sum += (TbBigChecksum)dungeon->creatr_list_start;
+        update_sync_checksum_leaf(SCkS_Dungeons, plyr_idx, sum);
+    }
+}
+/******************************************************************************/
+unsigned long get_sync_checksums_root(void)
+{
+    unsigned long hash = 0;
+    for (int subsys = 0; subsys < SCkS_COUNT; subsys++)
+    {
+        hash += sync_checksum_hash(SCkS_COUNT, subsys, sync_checksums.subsys_hash[subsys]);
+    }
+    return hash;
+}
+
+long get_sync_checksum_children_count(int level, int subsys, int bucket)
+{
+    switch (level)
+    {
+    case SCkL_Subsystem:
+        return SCkS_COUNT;
+    case SCkL_Bucket:
+        return SYNC_CHECKSUM_BUCKETS;
+    case SCkL_Item:
+    {
+        long per_bucket = get_sync_checksum_items_per_bucket(subsys);
+        long count = get_sync_checksum_items_count(subsys) - bucket * per_bucket;
+        if (count > per_bucket)
+            return per_bucket;
+        if (count < 0)
+            return 0;
+        return count;
+    }
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Returns hash of a child of sync checksums tree node.
+ * For subsystem level, the child is a subsystem; for bucket level, a bucket within given subsystem;
+ * for item level, an item within given bucket.
+ */
+unsigned long get_sync_checksum_node(int level, int subsys, int bucket, long child_idx)
+{
+    switch (level)
+    {
+    case SCkL_Subsystem:
+        if ((child_idx < 0) || (child_idx >= SCkS_COUNT))
+            return 0;
+        return sync_checksums.subsys_hash[child_idx];
+    case SCkL_Bucket:
+        if ((subsys < 0) || (subsys >= SCkS_COUNT) || (child_idx < 0) || (child_idx >= SYNC_CHECKSUM_BUCKETS))
+            return 0;
+        return sync_checksums.bucket_hash[subsys][child_idx];
+    case SCkL_Item:
+        return get_sync_checksum_leaf(subsys, bucket * get_sync_checksum_items_per_bucket(subsys) + child_idx);
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Goes down the sync checksums tree, following the first differing child on each level.
+ * @param compare_children Function which compares children of a node with the other side.
+ * @param loc Location to be filled; parts which couldn't be narrowed down are set to -1.
+ * @return True if a difference was found.
+ */
+TbBool locate_sync_checksums_difference(SyncChecksumsCompareFunc compare_children, struct SyncChecksumLocation *loc)
+{
+    loc->subsys = -1;
+    loc->bucket = -1;
+    loc->item = -1;
+    long subsys = compare_children(SCkL_Subsystem, -1, -1, get_sync_checksum_children_count(SCkL_Subsystem, -1, -1));
+    if (subsys < 0)
+        return false;
+    loc->subsys = subsys;
+    long bucket = compare_children(SCkL_Bucket, subsys, -1, get_sync_checksum_children_count(SCkL_Bucket, subsys, -1));
+    if (bucket < 0)
+        return true;
+    loc->bucket = bucket;
+    long item = compare_children(SCkL_Item, subsys, bucket, get_sync_checksum_children_count(SCkL_Item, subsys, bucket));
+    if (item < 0)
+        return true;
+    loc->item = bucket * get_sync_checksum_items_per_bucket(subsys) + item;
+    return true;
+}
+
+const char *sync_checksum_subsystem_name(int subsys)
+{
+    if ((subsys >= 0) && (subsys < SCkS_Things))
+        return sync_checksum_subsystem_names[subsys];
+    if ((subsys >= SCkS_Things) && (subsys < SCkS_COUNT))
+        return "things";
+    return "unknown";
+}
+/******************************************************************************/
+#ifdef __cplusplus
+}
+#endif
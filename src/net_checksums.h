@@ -0,0 +1,86 @@
+/******************************************************************************/
+// Free implementation of Bullfrog's Dungeon Keeper strategy game.
+/******************************************************************************/
+/** @file net_checksums.h
+ *     Header file for net_checksums.c.
+ * @par Purpose:
+ *     Hierarchical checksums of game state, for locating network desync.
+ * @par Comment:
+ *     Just a header file - #defines, typedefs, function prototypes etc.
+ * @author   KeeperFX Team
+ * @date     19 Oct 2026 - 19 Oct 2026
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+/******************************************************************************/
+#ifndef DK_NETCHECKSUMS_H
+#define DK_NETCHECKSUMS_H
+
+#include "globals.h"
+#include "bflib_basics.h"
+#include "thing_list.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/******************************************************************************/
+/** Amount of buckets in each subsystem; items are assigned to buckets by index ranges. */
+#define SYNC_CHECKSUM_BUCKETS 64
+
+/** Subsystems of the sync checksums tree; these are children of the root node. */
+enum SyncChecksumSubsystems {
+    SCkS_Players = 0, /**< Players, followed by the synchronized random seed. */
+    SCkS_Dungeons,
+    SCkS_Rooms,
+    SCkS_Slabs,
+    SCkS_Things,      /**< Things of the first class; each thing class is a separate subsystem. */
+    SCkS_COUNT = SCkS_Things + THING_CLASSES_COUNT,
+};
+
+/** Levels of the sync checksums tree, below the root. */
+enum SyncChecksumLevels {
+    SCkL_Subsystem = 0,
+    SCkL_Bucket,
+    SCkL_Item,
+};
+
+struct Thing;
+struct Room;
+struct SlabMap;
+
+/** Place in game state where a desync was found; -1 in fields which couldn't be narrowed down. */
+struct SyncChecksumLocation {
+    int subsys;
+    int bucket;
+    long item;
+};
+
+/**
+ * Compares children of a sync checksums tree node with the other side.
+ * @return Index of the first child which differs, or -1 if there's none.
+ */
+typedef long (*SyncChecksumsCompareFunc)(int level, int subsys, int bucket, long children_count);
+/******************************************************************************/
+void clear_sync_checksums(void);
+void rebuild_sync_checksums(void);
+void sync_checksum_update_thing(const struct Thing *thing, TbBigChecksum sum);
+void sync_checksum_remove_thing(const struct Thing *thing);
+void sync_checksum_update_room(const struct Room *room, TbBigChecksum sum);
+void sync_checksum_update_slab(const struct SlabMap *slb);
+void sync_checksum_update_player(PlayerNumber plyr_idx, TbBigChecksum sum);
+void sync_checksum_update_random_seed(void);
+void sync_checksum_update_dungeons(void);
+
+unsigned long get_sync_checksums_root(void);
+long get_sync_checksum_children_count(int level, int subsys, int bucket);
+unsigned long get_sync_checksum_node(int level, int subsys, int bucket, long child_idx);
+TbBool locate_sync_checksums_difference(SyncChecksumsCompareFunc compare_children, struct SyncChecksumLocation *loc);
+const char *sync_checksum_subsystem_name(int subsys);
+/******************************************************************************/
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -30,6 +30,8 @@
 #include "net_game.h"
 #include "lens_api.h"
 #include "game_legacy.h"
+#include "net_checksums.h"
+#include "thing_data.h"
 #include "keeperfx.hpp"
 
 #ifdef __cplusplus
@@ -160,6 +162,126 @@ void resync_game(void)
     set_flag_byte(&game.system_flags,GSF_NetSeedNoSync,false);
 }
 
+/**
+ * Folds sync checksums tree node hash, so that four of them fit into a packet.
+ */
+static unsigned short fold_sync_checksum(unsigned long hash)
+{
+    return (hash ^ (hash >> 16)) & 0xFFFF;
+}
+
+static unsigned short get_packet_sync_checksum(const struct Packet *pckt, int n)
+{
+    switch (n)
+    {
+    case 0:
+        return pckt->field_0 & 0xFFFF;
+    case 1:
+        return (pckt->field_0 >> 16) & 0xFFFF;
+    case 2:
+        return pckt->pos_x;
+    default:
+        return pckt->pos_y;
+    }
+}
+
+/**
+ * Checks if all active players packets have the same sync checksum at given position.
+ * The result doesn't depend on which player checks it, so all players follow the same tree branch.
+ */
+static TbBool packets_sync_checksum_different(int n)
+{
+    unsigned short checksum = 0;
+    TbBool is_set = false;
+    for (int i = 0; i < PLAYERS_COUNT; i++)
+    {
+        struct PlayerInfo* player = get_player(i);
+        if (player_exists(player) && ((player->allocflags & PlaF_CompCtrl) == 0))
+        {
+            struct Packet* pckt = get_packet_direct(player->packet_num);
+            if (!is_set)
+            {
+                checksum = get_packet_sync_checksum(pckt, n);
+                is_set = true;
+            } else
+            if (checksum != get_packet_sync_checksum(pckt, n))
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * Exchanges hashes of sync checksums tree node children with other players, four per exchange.
+ * @return Index of the first child which isn't the same for all players, or -1.
+ */
+static long exchange_sync_checksum_children(int level, int subsys, int bucket, long children_count)
+{
+    for (long first = 0; first < children_count; first += 4)
+    {
+        unsigned short hash[4];
+        int n;
+        for (n = 0; n < 4; n++)
+        {
+            if (first + n < children_count)
+                hash[n] = fold_sync_checksum(get_sync_checksum_node(level, subsys, bucket, first + n));
+            else
+                hash[n] = 0;
+        }
+        clear_packets();
+        struct Packet* pckt = get_packet(my_player_number);
+        set_packet_action(pckt, PckA_LocateDesync, level, first, 0, 0);
+        pckt->field_0 = hash[0] | ((unsigned long)hash[1] << 16);
+        pckt->pos_x = hash[2];
+        pckt->pos_y = hash[3];
+        if (LbNetwork_Exchange(pckt))
+        {
+            ERRORLOG("Network exchange failed on desync location");
+            return -1;
+        }
+        for (n = 0; (n < 4) && (first + n < children_count); n++)
+        {
+            if (packets_sync_checksum_different(n))
+                return first + n;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Compares sync checksums tree with other players, to find which item got out of sync.
+ * All players have to call it at the same time, after a checksum mismatch was found.
+ * The result is only logged; packets are cleared after it.
+ */
+TbBool locate_desync(struct SyncChecksumLocation *loc)
+{
+    SYNCDBG(6,"Starting");
+    TbBool found = locate_sync_checksums_difference(exchange_sync_checksum_children, loc);
+    clear_packets();
+    if (!found)
+    {
+        WARNLOG("Desync not found in sync checksums, turn %lu",(unsigned long)game.play_gameturn);
+        return false;
+    }
+    if ((loc->subsys >= SCkS_Things) && (loc->item >= 0))
+    {
+        struct Thing* thing = thing_get(loc->item);
+        ERRORLOG("Desync located at turn %lu in %s, thing %ld class %d model %d owner %d",
+            (unsigned long)game.play_gameturn, sync_checksum_subsystem_name(loc->subsys), loc->item,
+            (int)(loc->subsys - SCkS_Things), (int)thing->model, (int)thing->owner);
+    } else
+    {
+        ERRORLOG("Desync located at turn %lu in %s, bucket %d item %ld",
+            (unsigned long)game.play_gameturn, sync_checksum_subsystem_name(loc->subsys), loc->bucket, loc->item);
+    }
+#ifdef AUTOTESTING
+    evm_stat(1, "desync.located,subsys=%s,bucket=%d item=%ld", sync_checksum_subsystem_name(loc->subsys), loc->bucket, loc->item);
+#endif
+    return true;
+}
+
 /**
  * Exchanges verification packets between all players, making sure level data is identical.
  * @return Returns true if all players return same checksum.
@@ -167,18 +289,12 @@ void resync_game(void)
 short perform_checksum_verification(void)
 {
     short result = true;
-    unsigned long checksum_mem = 0;
-    for (int i = 1; i < THINGS_COUNT; i++)
-    {
-        struct Thing* thing = thing_get(i);
-        if (thing_exists(thing)) {
-            checksum_mem += thing->mappos.z.val + thing->mappos.y.val + thing->mappos.x.val;
-        }
-    }
+    // Things created during level setup have no leaves until their first update; this is done once per level
+    rebuild_sync_checksums();
     clear_packets();
     struct Packet* pckt = get_packet(my_player_number);
     set_packet_action(pckt, PckA_LevelExactCheck, 0, 0, 0, 0);
-    pckt->chksum = checksum_mem + game.action_rand_seed;
+    pckt->chksum = fold_sync_checksum(get_sync_checksums_root());
     if (LbNetwork_Exchange(pckt))
     {
         ERRORLOG("Network exchange failed on level checksum verification");
@@ -187,6 +303,8 @@ short perform_checksum_verification(void)
     if ( checksums_different() )
     {
         ERRORLOG("Level checksums different for network players");
+        struct SyncChecksumLocation loc;
+        locate_desync(&loc);
         result = false;
     }
     return result;
@@ -32,8 +32,11 @@ extern "C" {
 
 #pragma pack()
 /******************************************************************************/
+struct SyncChecksumLocation;
+
 void resync_game(void);
 short perform_checksum_verification(void);
+TbBool locate_desync(struct SyncChecksumLocation *loc);
 
 /******************************************************************************/
 #ifdef __cplusplus
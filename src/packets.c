@@ -83,6 +83,8 @@
 #include "net_game.h"
 #include "net_sync.h"
 #include "game_legacy.h"
+#include "net_checksums.h"
+#include "game_saves.h"
 #include "engine_redraw.h"
 #include "frontmenu_ingame_tabs.h"
 #include "vidfade.h"
@@ -96,7 +98,30 @@ extern "C" {
 #endif
 /******************************************************************************/
 #define PACKET_TURN_SIZE (NET_PLAYERS_COUNT*sizeof(struct Packet) + sizeof(TbBigChecksum))
+/** Amount of packet file turns between keyframes. */
+#define PACKET_KEYFRAME_INTERVAL 2000
+#define PACKET_KEYFRAMES_COUNT    512
 struct Packet bad_packet;
+
+/** Location of a keyframe in packet keyframes file. */
+struct PacketKeyframe {
+    GameTurn pckt_turn;
+    unsigned long fpos;
+};
+
+/** Position of the first turn data within packet file. */
+static unsigned long packet_data_start;
+/** Amount of turns written into packet file which is being saved. */
+static GameTurn packet_turns_saved;
+/** Keyframes of the current packet file, sorted by turn. */
+static struct PacketKeyframe packet_keyframes[PACKET_KEYFRAMES_COUNT];
+static int packet_keyframes_count;
+/** Amount of replayed turns which had checksums matching the ones in packet file, since the last seek. */
+static unsigned long packet_chksums_verified;
+/** Amount of replayed turns which had checksums different than the ones in packet file, since the last seek. */
+static unsigned long packet_chksums_mismatched;
+/** Whether the replay is fast forwarded to a turn requested by seek_packet_file_to_turn(). */
+static TbBool packet_seek_in_progress;
 /******************************************************************************/
 #ifdef __cplusplus
 }
@@ -223,8 +248,13 @@ TbBigChecksum compute_players_checksum(void)
         struct PlayerInfo* player = get_player(i);
         if (player_exists(player))
         {
-            sum += compute_player_checksum(player);
-      }
+            TbBigChecksum plyr_sum = compute_player_checksum(player);
+            sync_checksum_update_player(i, plyr_sum);
+            sum += plyr_sum;
+        } else
+        {
+            sync_checksum_update_player(i, 0);
+        }
     }
     return sum;
 }
@@ -773,7 +803,7 @@ TbBool process_dungeon_control_packet_dungeon_control(long plyr_idx)
               {
                 untag_blocks_for_digging_in_rectangle_around(cx, cy, plyr_idx);
               } else
-              if (dungeon->task_count < 300)
+              if (dungeon->task_count < MAPTASKS_MAX_COUNT)
               {
                 tag_blocks_for_digging_in_rectangle_around(cx, cy, plyr_idx);
               } else
@@ -788,7 +818,7 @@ TbBool process_dungeon_control_packet_dungeon_control(long plyr_idx)
               {
                 untag_blocks_for_digging_in_rectangle_around(cx, cy, plyr_idx);
               } else
-              if (dungeon->task_count < 300)
+              if (dungeon->task_count < MAPTASKS_MAX_COUNT)
               {
                 if (can_dig_here(stl_x, stl_y, player->id_number))
                   tag_blocks_for_digging_in_rectangle_around(cx, cy, plyr_idx);
@@ -848,7 +878,7 @@ TbBool process_dungeon_control_packet_dungeon_control(long plyr_idx)
             {
               untag_blocks_for_digging_in_rectangle_around(cx, cy, plyr_idx);
             } else
-            if (300-dungeon->task_count >= 9)
+            if (MAPTASKS_MAX_COUNT-dungeon->task_count >= 9)
             {
               tag_blocks_for_digging_in_rectangle_around(cx, cy, plyr_idx);
             } else
@@ -1755,6 +1785,185 @@ TbBool reinit_packets_after_load(void)
     return true;
 }
 
+/**
+ * Keyframes are stored in a separate file, next to the packet file.
+ * This way the packet file stays a sequence of fixed-size turn records.
+ */
+static void get_packet_keyframes_fname(char *fname, size_t fname_len)
+{
+    snprintf(fname, fname_len, "%s.kfr", game.packet_fname);
+}
+
+static TbBool create_packet_keyframes_file(void)
+{
+    char fname[sizeof(game.packet_fname)+8];
+    get_packet_keyframes_fname(fname, sizeof(fname));
+    packet_keyframes_count = 0;
+    LbFileDelete(fname);
+    TbFileHandle fh = LbFileOpen(fname, Lb_FILE_MODE_NEW);
+    if (fh == -1)
+        return false;
+    LbFileClose(fh);
+    return true;
+}
+
+/**
+ * Scans packet keyframes file and fills the keyframes list.
+ * Packet files without keyframes can still be replayed, but only from start.
+ */
+static void load_packet_keyframes_index(void)
+{
+    char fname[sizeof(game.packet_fname)+8];
+    get_packet_keyframes_fname(fname, sizeof(fname));
+    packet_keyframes_count = 0;
+    TbFileHandle fh = LbFileOpen(fname, Lb_FILE_MODE_READ_ONLY);
+    if (fh == -1)
+        return;
+    while (packet_keyframes_count < PACKET_KEYFRAMES_COUNT)
+    {
+        long fpos = LbFilePosition(fh);
+        struct FileChunkHeader hdr;
+        if (LbFileRead(fh, &hdr, sizeof(struct FileChunkHeader)) != sizeof(struct FileChunkHeader))
+            break;
+        if ((hdr.id == SGC_PacketKeyframe) && (hdr.len == sizeof(struct PacketKeyframeHead)))
+        {
+            struct PacketKeyframeHead kfhead;
+            if (LbFileRead(fh, &kfhead, sizeof(struct PacketKeyframeHead)) != sizeof(struct PacketKeyframeHead))
+                break;
+            // Keyframes beyond stored turns are left from unfinished write, and can't be used
+            if ((kfhead.pckt_turn > game.turns_stored) || ((packet_keyframes_count > 0)
+              && (kfhead.pckt_turn <= packet_keyframes[packet_keyframes_count-1].pckt_turn)))
+                break;
+            struct PacketKeyframe* kfrm = &packet_keyframes[packet_keyframes_count];
+            kfrm->pckt_turn = kfhead.pckt_turn;
+            kfrm->fpos = fpos;
+            packet_keyframes_count++;
+        } else
+        if (LbFileSeek(fh, hdr.len, Lb_FILE_SEEK_CURRENT) < 0)
+        {
+            break;
+        }
+    }
+    LbFileClose(fh);
+    SYNCDBG(7,"Packet file has %d keyframes",packet_keyframes_count);
+}
+
+/**
+ * Stores keyframe of the packet file being saved, if enough turns were saved since the previous one.
+ * Needs to be called before inputs of a turn are processed; a replay which loads the keyframe
+ * then starts with the same state as the saving game had.
+ */
+void save_packet_file_keyframe(void)
+{
+    if ((!game.packet_save_enable) || (!game.packet_fopened))
+        return;
+    if ((packet_turns_saved == 0) || ((packet_turns_saved % PACKET_KEYFRAME_INTERVAL) != 0))
+        return;
+    if ((packet_keyframes_count >= PACKET_KEYFRAMES_COUNT)
+      || ((packet_keyframes_count > 0) && (packet_keyframes[packet_keyframes_count-1].pckt_turn == packet_turns_saved)))
+        return;
+    char fname[sizeof(game.packet_fname)+8];
+    get_packet_keyframes_fname(fname, sizeof(fname));
+    TbFileHandle fh = LbFileOpen(fname, Lb_FILE_MODE_OLD);
+    if (fh == -1)
+    {
+        WARNLOG("Cannot open packet keyframes file \"%s\".",fname);
+        return;
+    }
+    LbFileSeek(fh, 0, Lb_FILE_SEEK_END);
+    struct PacketKeyframe* kfrm = &packet_keyframes[packet_keyframes_count];
+    kfrm->pckt_turn = packet_turns_saved;
+    kfrm->fpos = LbFilePosition(fh);
+    struct PacketKeyframeHead kfhead;
+    kfhead.pckt_turn = packet_turns_saved;
+    kfhead.play_gameturn = game.play_gameturn;
+    if (!save_packet_keyframe_chunks(fh, &kfhead))
+    {
+        WARNLOG("Cannot write keyframe for packet turn %lu",(unsigned long)packet_turns_saved);
+        LbFileClose(fh);
+        return;
+    }
+    LbFileClose(fh);
+    SYNCDBG(8,"Stored keyframe for packet turn %lu",(unsigned long)packet_turns_saved);
+    packet_keyframes_count++;
+}
+
+/**
+ * Moves packet file replay to given turn. Game state is loaded from the last keyframe
+ * before that turn, and the remaining turns are replayed in fast forward mode.
+ * Replay can be moved backwards only if there's a keyframe to load.
+ */
+TbBool seek_packet_file_to_turn(GameTurn nturn)
+{
+    if ((!game.packet_load_enable) || (!game.packet_fopened))
+        return false;
+    if (nturn > game.turns_stored)
+        nturn = game.turns_stored;
+    int kf_idx = -1;
+    for (int i = 0; i < packet_keyframes_count; i++)
+    {
+        if (packet_keyframes[i].pckt_turn > nturn)
+            break;
+        kf_idx = i;
+    }
+    if ((kf_idx < 0) || (packet_keyframes[kf_idx].pckt_turn <= game.pckt_gameturn))
+    {
+        // No keyframe which would be closer than the current turn
+        if (nturn < game.pckt_gameturn)
+        {
+            WARNLOG("No keyframe to move back from packet turn %lu to %lu",(unsigned long)game.pckt_gameturn,(unsigned long)nturn);
+            return false;
+        }
+        game.turns_fastforward = nturn - game.pckt_gameturn;
+        packet_chksums_verified = 0;
+        packet_chksums_mismatched = 0;
+        packet_seek_in_progress = (game.turns_fastforward > 0);
+        return true;
+    }
+    struct PacketKeyframe* kfrm = &packet_keyframes[kf_idx];
+    char fname[sizeof(game.packet_fname)+8];
+    get_packet_keyframes_fname(fname, sizeof(fname));
+    TbFileHandle fh = LbFileOpen(fname, Lb_FILE_MODE_READ_ONLY);
+    if (fh == -1)
+    {
+        WARNLOG("Cannot open packet keyframes file \"%s\".",fname);
+        return false;
+    }
+    struct PacketKeyframeHead kfhead;
+    TbBool loaded = false;
+    if (LbFileSeek(fh, kfrm->fpos, Lb_FILE_SEEK_BEGINNING) >= 0)
+        loaded = load_packet_keyframe(fh, &kfhead);
+    LbFileClose(fh);
+    if ((!loaded) || (kfhead.pckt_turn != kfrm->pckt_turn))
+    {
+        ERRORLOG("Cannot load keyframe for packet turn %lu",(unsigned long)kfrm->pckt_turn);
+        return false;
+    }
+    game.pckt_gameturn = kfhead.pckt_turn;
+    game.packet_file_pos = packet_data_start + kfhead.pckt_turn * PACKET_TURN_SIZE;
+    LbFileSeek(game.packet_save_fp, game.packet_file_pos, Lb_FILE_SEEK_BEGINNING);
+    game.turns_fastforward = nturn - kfhead.pckt_turn;
+    packet_chksums_verified = 0;
+    packet_chksums_mismatched = 0;
+    packet_seek_in_progress = (game.turns_fastforward > 0);
+    SYNCMSG("Loaded keyframe at packet turn %lu (game turn %lu), fast forward through %lu turns",
+        (unsigned long)kfhead.pckt_turn,(unsigned long)kfhead.play_gameturn,(unsigned long)game.turns_fastforward);
+    return true;
+}
+
+/**
+ * Gives amounts of replayed turns with checksums matching and not matching the packet file.
+ * Counting restarts on every seek, so after seeking it tells whether the state loaded
+ * from keyframe leads to the same game as the one recorded.
+ * @return Whether any checksums were compared.
+ */
+TbBool get_packet_replay_verification(unsigned long *verified, unsigned long *mismatched)
+{
+    *verified = packet_chksums_verified;
+    *mismatched = packet_chksums_mismatched;
+    return ((packet_chksums_verified + packet_chksums_mismatched) > 0);
+}
+
 TbBool open_new_packet_file_for_save(void)
 {
     // Filling the header
@@ -1778,6 +1987,9 @@ TbBool open_new_packet_file_for_save(void)
         }
     }
     LbFileDelete(game.packet_fname);
+    packet_turns_saved = 0;
+    if (!create_packet_keyframes_file())
+        WARNMSG("Cannot create packet keyframes file; replay of \"%s\" won't be seekable.",game.packet_fname);
     game.packet_save_fp = LbFileOpen(game.packet_fname, Lb_FILE_MODE_NEW);
     if (game.packet_save_fp == -1)
     {
@@ -1833,14 +2045,28 @@ void load_packets_for_turn(GameTurn nturn)
             ERRORLOG("PacketSave checksum - Out of sync (GameTurn %d)", game.play_gameturn);
             if (!is_onscreen_msg_visible())
               show_onscreen_msg(game.num_fps, "Out of sync");
+            packet_chksums_mismatched++;
         } else
         if (pckt->chksum != pckt_chksum)
         {
             ERRORLOG("Opps we are really Out Of Sync (GameTurn %d)", game.play_gameturn);
             if (!is_onscreen_msg_visible())
               show_onscreen_msg(game.num_fps, "Out of sync");
+            packet_chksums_mismatched++;
+        } else
+        {
+            packet_chksums_verified++;
         }
     }
+    if (packet_seek_in_progress && (game.turns_fastforward == 0))
+    {
+        packet_seek_in_progress = false;
+        if (game.packet_checksum_verify)
+            SYNCMSG("Packet seek reached turn %lu, checksums of %lu turns verified, %lu mismatched",
+                (unsigned long)nturn,packet_chksums_verified,packet_chksums_mismatched);
+        else
+            SYNCMSG("Packet seek reached turn %lu, checksums not verified",(unsigned long)nturn);
+    }
 }
 
 void process_pause_packet(long curr_pause, long new_pause)
@@ -2788,6 +3014,8 @@ TbBool open_packet_file_for_load(char *fname, struct CatalogueEntry *centry)
     }
     game.packet_file_pos = LbFilePosition(game.packet_save_fp);
     game.turns_stored = (LbFileLengthHandle(game.packet_save_fp) - game.packet_file_pos) / PACKET_TURN_SIZE;
+    packet_data_start = game.packet_file_pos;
+    load_packet_keyframes_index();
     if ((game.packet_checksum_verify) && (!game.packet_save_head.chksum_available))
     {
         WARNMSG("PacketSave checksum not available, checking disabled.");
@@ -2839,6 +3067,7 @@ short save_packets(void)
       ERRORLOG("Unable to flush PacketSave File");
       return false;
     }
+    packet_turns_saved++;
     return true;
 }
 
@@ -2963,6 +3192,8 @@ void process_packets(void)
    || ((game.system_flags & GSF_NetSeedNoSync) != 0))
   {
     SYNCDBG(0,"Resyncing");
+    struct SyncChecksumLocation loc;
+    locate_desync(&loc);
     resync_game();
   }
   SYNCDBG(7,"Finished");
@@ -149,7 +149,8 @@ enum TbPacketAction {
         PckA_SaveViewType,
         PckA_LoadViewType,//120
         PckA_PlyrMsgChar    =  121,
-        PckA_PlyrMsgClear
+        PckA_PlyrMsgClear,
+        PckA_LocateDesync,
 };
 
 /** Packet flags for non-action player operation. */
@@ -223,6 +224,13 @@ struct PacketSaveHead { // sizeof=0xF (15)
     TbBool chksum_available; // if needed, this can be replaced with flags
 };
 
+/** Header of packet file keyframe; keyframe allows continuing the replay from given turn. */
+struct PacketKeyframeHead {
+    /** Index of the packet file turn which is to be loaded right after the keyframe. */
+    GameTurn pckt_turn;
+    GameTurn play_gameturn;
+};
+
 #pragma pack()
 /******************************************************************************/
 /******************************************************************************/
@@ -259,6 +267,9 @@ TbBool open_packet_file_for_load(char *fname, struct CatalogueEntry *centry);
 short save_packets(void);
 void close_packet_file(void);
 TbBool reinit_packets_after_load(void);
+void save_packet_file_keyframe(void);
+TbBool seek_packet_file_to_turn(GameTurn nturn);
+TbBool get_packet_replay_verification(unsigned long *verified, unsigned long *mismatched);
 struct Room *keeper_build_room(long stl_x,long stl_y,long plyr_idx,long rkind);
 TbBool player_sell_room_at_subtile(long plyr_idx, long stl_x, long stl_y);
 /******************************************************************************/
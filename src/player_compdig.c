@@ -0,0 +1,352 @@
+/******************************************************************************/
+// Free implementation of Bullfrog's Dungeon Keeper strategy game.
+/******************************************************************************/
+/** @file player_compdig.c
+ *     Computer player dig planner.
+ * @par Purpose:
+ *     Computes dig cost fields which allow computer players to dig
+ *     through the cheapest route towards a target.
+ * @par Comment:
+ *     Cost fields depend only on the slab map, so they are not saved.
+ *     Caching them doesn't change the result, only the time of computing it.
+ * @author   KeeperFX Team
+ * @date     19 Oct 2026 - 19 Oct 2026
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+/******************************************************************************/
+#include "player_computer.h"
+
+#include <limits.h>
+#include <string.h>
+
+#include "globals.h"
+#include "bflib_basics.h"
+#include "bflib_memory.h"
+
+#include "config_terrain.h"
+#include "map_data.h"
+#include "map_utils.h"
+#include "slab_data.h"
+#include "game_legacy.h"
+#include "keeperfx.hpp"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/******************************************************************************/
+/** Amount of cost fields cached for each player; a player may be digging towards several targets. */
+#define COMPUTER_DIG_FIELDS_COUNT 4
+#define COMPUTER_DIG_SLABS_COUNT (85*85)
+#define DIG_COST_UNREACHABLE 0xFFFF
+/** Max heap size; every slab may be pushed once from each of its neighbours. */
+#define DIG_HEAP_SIZE (SMALL_AROUND_LENGTH*COMPUTER_DIG_SLABS_COUNT+1)
+
+// Costs of entering a slab, in amount of slabs which could be walked in the same time
+#define DIG_COST_WALK               1
+#define DIG_COST_WATER              2
+#define DIG_COST_EARTH              4
+#define DIG_COST_VALUABLE           7
+#define DIG_COST_VALUABLE_WANTED    2
+#define DIG_COST_BRIDGE             5
+#define DIG_COST_DANGER             9
+
+struct ComputerDigField {
+    TbBool valid;
+    SlabCodedCoords dest_slb_num;
+    unsigned short digflags;
+    TbBool can_bridge;
+    unsigned long slabmap_generation;
+    GameTurn last_used_turn;
+    /** Cost of reaching the destination from each slab. */
+    unsigned short cost[COMPUTER_DIG_SLABS_COUNT];
+    /** Cost of entering each slab, which the field was computed from. */
+    unsigned char enter_cost[COMPUTER_DIG_SLABS_COUNT];
+};
+/******************************************************************************/
+static struct ComputerDigField computer_dig_fields[PLAYERS_COUNT][COMPUTER_DIG_FIELDS_COUNT];
+/** Heap used while computing a field; items are cost in high and slab number in low bits, so order is unique. */
+static unsigned long dig_heap[DIG_HEAP_SIZE];
+static long dig_heap_count;
+/******************************************************************************/
+static void dig_heap_push(unsigned long item)
+{
+    long i = dig_heap_count++;
+    while (i > 0)
+    {
+        long parent = (i - 1) / 2;
+        if (dig_heap[parent] <= item)
+            break;
+        dig_heap[i] = dig_heap[parent];
+        i = parent;
+    }
+    dig_heap[i] = item;
+}
+
+static unsigned long dig_heap_pop(void)
+{
+    unsigned long top = dig_heap[0];
+    unsigned long item = dig_heap[--dig_heap_count];
+    long i = 0;
+    while (1)
+    {
+        long child = 2 * i + 1;
+        if (child >= dig_heap_count)
+            break;
+        if ((child + 1 < dig_heap_count) && (dig_heap[child+1] < dig_heap[child]))
+            child++;
+        if (item <= dig_heap[child])
+            break;
+        dig_heap[i] = dig_heap[child];
+        i = child;
+    }
+    if (dig_heap_count > 0)
+        dig_heap[i] = item;
+    return top;
+}
+
+/**
+ * Returns cost of entering given slab by a computer player digging its way through.
+ * @return The cost, or 0 if the slab can't be entered.
+ */
+static unsigned short computer_dig_slab_enter_cost(PlayerNumber plyr_idx, MapSlabCoord slb_x, MapSlabCoord slb_y, unsigned short digflags, TbBool can_bridge)
+{
+    struct SlabMap* slb = get_slabmap_block(slb_x, slb_y);
+    struct SlabAttr* slbattr = get_slab_attrs(slb);
+    PlayerNumber owner = slabmap_owner(slb);
+    if (slab_kind_is_liquid(slb->kind))
+    {
+        if (can_bridge)
+            return DIG_COST_WALK + DIG_COST_BRIDGE;
+        if (slb->kind == SlbT_WATER)
+            return DIG_COST_WATER;
+        return 0;
+    }
+    if (slab_kind_is_door(slb->kind))
+    {
+        if (owner != plyr_idx)
+            return 0;
+        return DIG_COST_WALK;
+    }
+    if ((slbattr->block_flags & SlbAtFlg_Blocking) == 0)
+    {
+        if ((owner != plyr_idx) && (owner != game.neutral_player_num))
+            return DIG_COST_WALK + DIG_COST_DANGER;
+        return DIG_COST_WALK;
+    }
+    if (slab_kind_is_indestructible(slb->kind))
+        return 0;
+    if ((slbattr->block_flags & SlbAtFlg_Filled) != 0)
+    {
+        // Fortified walls can only be dug by their owner
+        if (owner != plyr_idx)
+            return 0;
+        return DIG_COST_WALK + DIG_COST_EARTH;
+    }
+    if ((slbattr->block_flags & SlbAtFlg_Valuable) != 0)
+    {
+        if ((digflags & ToolDig_AllowValuable) != 0)
+            return DIG_COST_WALK + DIG_COST_VALUABLE_WANTED;
+        return DIG_COST_WALK + DIG_COST_VALUABLE;
+    }
+    if ((slbattr->block_flags & SlbAtFlg_Digable) != 0)
+        return DIG_COST_WALK + DIG_COST_EARTH;
+    return 0;
+}
+
+/**
+ * Computes cost of reaching given destination from every slab of the map.
+ */
+static void computer_dig_field_compute(struct ComputerDigField *field, PlayerNumber plyr_idx)
+{
+    unsigned char *enter_cost = field->enter_cost;
+    long i;
+    SYNCDBG(8,"Computing field for player %d towards slab (%d,%d)",(int)plyr_idx,
+        (int)slb_num_decode_x(field->dest_slb_num),(int)slb_num_decode_y(field->dest_slb_num));
+    for (i = 0; i < COMPUTER_DIG_SLABS_COUNT; i++) {
+        field->cost[i] = DIG_COST_UNREACHABLE;
+    }
+    for (MapSlabCoord slb_y = 0; slb_y < map_tiles_y; slb_y++)
+    {
+        for (MapSlabCoord slb_x = 0; slb_x < map_tiles_x; slb_x++)
+        {
+            enter_cost[get_slab_number(slb_x, slb_y)] = computer_dig_slab_enter_cost(plyr_idx, slb_x, slb_y, field->digflags, field->can_bridge);
+        }
+    }
+    // Dijkstra from the destination; moving from a slab to its neighbour costs entering the neighbour
+    dig_heap_count = 0;
+    field->cost[field->dest_slb_num] = 0;
+    dig_heap_push(field->dest_slb_num);
+    while (dig_heap_count > 0)
+    {
+        unsigned long item = dig_heap_pop();
+        SlabCodedCoords slb_num = item & 0xFFFF;
+        unsigned long cost = item >> 16;
+        if (cost != field->cost[slb_num])
+            continue;
+        MapSlabCoord slb_x = slb_num_decode_x(slb_num);
+        MapSlabCoord slb_y = slb_num_decode_y(slb_num);
+        // Reaching slab which can't be entered is allowed only as the destination
+        unsigned long ncost = cost + enter_cost[slb_num];
+        if ((enter_cost[slb_num] == 0) && (slb_num != field->dest_slb_num))
+            continue;
+        if (ncost >= DIG_COST_UNREACHABLE)
+            continue;
+        for (i = 0; i < SMALL_AROUND_LENGTH; i++)
+        {
+            MapSlabCoord sslb_x = slb_x + small_around[i].delta_x;
+            MapSlabCoord sslb_y = slb_y + small_around[i].delta_y;
+            if ((sslb_x < 0) || (sslb_x >= map_tiles_x) || (sslb_y < 0) || (sslb_y >= map_tiles_y))
+                continue;
+            SlabCodedCoords sslb_num = get_slab_number(sslb_x, sslb_y);
+            if (ncost >= field->cost[sslb_num])
+                continue;
+            field->cost[sslb_num] = ncost;
+            if (dig_heap_count >= DIG_HEAP_SIZE)
+            {
+                ERRORLOG("Dig planner heap overflow");
+                return;
+            }
+            dig_heap_push((ncost << 16) | sslb_num);
+        }
+    }
+}
+
+/**
+ * Returns if cost of entering any slab changed since the field was computed.
+ * The field depends only on enter costs, so if none changed, it is still exact.
+ */
+static TbBool computer_dig_field_outdated(const struct ComputerDigField *field, PlayerNumber plyr_idx)
+{
+    unsigned long generation = get_slabmap_generation();
+    for (unsigned long gen = field->slabmap_generation; gen < generation; gen++)
+    {
+        SlabCodedCoords slb_num;
+        if (!get_slabmap_changed_slab(gen, &slb_num))
+        {
+            // Too many changes to check them one by one; compare the whole map
+            for (MapSlabCoord slb_y = 0; slb_y < map_tiles_y; slb_y++)
+            {
+                for (MapSlabCoord slb_x = 0; slb_x < map_tiles_x; slb_x++)
+                {
+                    if (computer_dig_slab_enter_cost(plyr_idx, slb_x, slb_y, field->digflags, field->can_bridge)
+                      != field->enter_cost[get_slab_number(slb_x, slb_y)])
+                        return true;
+                }
+            }
+            return false;
+        }
+        if (slb_num >= map_tiles_x * map_tiles_y)
+            continue;
+        if (computer_dig_slab_enter_cost(plyr_idx, slb_num_decode_x(slb_num), slb_num_decode_y(slb_num), field->digflags, field->can_bridge)
+          != field->enter_cost[slb_num])
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Gives cost field towards given destination, computing it if the cached one is out of date.
+ */
+static struct ComputerDigField *get_computer_dig_field(PlayerNumber plyr_idx, SlabCodedCoords dest_slb_num, unsigned short digflags, TbBool can_bridge)
+{
+    struct ComputerDigField* field;
+    struct ComputerDigField* oldest = NULL;
+    int i;
+    for (i = 0; i < COMPUTER_DIG_FIELDS_COUNT; i++)
+    {
+        field = &computer_dig_fields[plyr_idx][i];
+        if (field->valid && (field->dest_slb_num == dest_slb_num) && (field->digflags == digflags) && (field->can_bridge == can_bridge))
+        {
+            if (field->slabmap_generation != get_slabmap_generation())
+            {
+                if (computer_dig_field_outdated(field, plyr_idx))
+                    computer_dig_field_compute(field, plyr_idx);
+                field->slabmap_generation = get_slabmap_generation();
+            }
+            field->last_used_turn = game.play_gameturn;
+            return field;
+        }
+        if ((oldest == NULL) || !field->valid || (oldest->valid && (field->last_used_turn < oldest->last_used_turn)))
+            oldest = field;
+    }
+    field = oldest;
+    field->valid = true;
+    field->dest_slb_num = dest_slb_num;
+    field->digflags = digflags;
+    field->can_bridge = can_bridge;
+    field->slabmap_generation = get_slabmap_generation();
+    field->last_used_turn = game.play_gameturn;
+    computer_dig_field_compute(field, plyr_idx);
+    return field;
+}
+
+/**
+ * Gives next slab on the cheapest dig route from given slab towards destination.
+ * @param comp Computer player which is digging.
+ * @param slb_x Current slab X coord; replaced by the next slab coord.
+ * @param slb_y Current slab Y coord; replaced by the next slab coord.
+ * @param dest_x Destination slab X coord.
+ * @param dest_y Destination slab Y coord.
+ * @param digflags Digging flags, from ToolDigFlags enum.
+ * @return True if the next slab was given, false if there's no route.
+ */
+TbBool computer_dig_planner_next_slab(const struct Computer2 *comp, MapSlabCoord *slb_x, MapSlabCoord *slb_y,
+    MapSlabCoord dest_x, MapSlabCoord dest_y, unsigned short digflags)
+{
+    PlayerNumber plyr_idx = comp->dungeon->owner;
+    if ((plyr_idx < 0) || (plyr_idx >= PLAYERS_COUNT))
+        return false;
+    if ((map_tiles_x * map_tiles_y > COMPUTER_DIG_SLABS_COUNT) || slab_coords_invalid(dest_x, dest_y) || slab_coords_invalid(*slb_x, *slb_y))
+        return false;
+    TbBool can_bridge = (computer_check_room_available(comp, RoK_BRIDGE) == IAvail_Now);
+    struct ComputerDigField* field = get_computer_dig_field(plyr_idx, get_slab_number(dest_x, dest_y), digflags, can_bridge);
+    if (field->cost[get_slab_number(*slb_x, *slb_y)] == DIG_COST_UNREACHABLE)
+        return false;
+    // Among equally good neighbours, prefer the one in direction of destination
+    unsigned int around_start = small_around_index_towards_destination(slab_subtile_center(*slb_x), slab_subtile_center(*slb_y),
+        slab_subtile_center(dest_x), slab_subtile_center(dest_y));
+    unsigned long best_cost = ULONG_MAX;
+    MapSlabCoord best_x = -1;
+    MapSlabCoord best_y = -1;
+    for (unsigned int n = 0; n < SMALL_AROUND_LENGTH; n++)
+    {
+        unsigned int i = (around_start + n) % SMALL_AROUND_LENGTH;
+        MapSlabCoord sslb_x = *slb_x + small_around[i].delta_x;
+        MapSlabCoord sslb_y = *slb_y + small_around[i].delta_y;
+        if ((sslb_x < 0) || (sslb_x >= map_tiles_x) || (sslb_y < 0) || (sslb_y >= map_tiles_y))
+            continue;
+        SlabCodedCoords sslb_num = get_slab_number(sslb_x, sslb_y);
+        if (field->cost[sslb_num] == DIG_COST_UNREACHABLE)
+            continue;
+        unsigned long enter_cost = computer_dig_slab_enter_cost(plyr_idx, sslb_x, sslb_y, digflags, can_bridge);
+        if ((enter_cost == 0) && ((sslb_x != dest_x) || (sslb_y != dest_y)))
+            continue;
+        if (field->cost[sslb_num] + enter_cost < best_cost)
+        {
+            best_cost = field->cost[sslb_num] + enter_cost;
+            best_x = sslb_x;
+            best_y = sslb_y;
+        }
+    }
+    if (best_cost == ULONG_MAX)
+        return false;
+    *slb_x = best_x;
+    *slb_y = best_y;
+    return true;
+}
+
+/**
+ * Drops all cached dig cost fields. To be used when a new map is loaded.
+ */
+void reset_computer_dig_planner(void)
+{
+    LbMemorySet(computer_dig_fields, 0, sizeof(computer_dig_fields));
+}
+/******************************************************************************/
+#ifdef __cplusplus
+}
+#endif
@@ -1611,6 +1611,171 @@ short tool_dig_to_pos2_do_action_on_slab_which_needs_it_f(struct Computer2 * com
     return i;
 }
 
+/**
+ * Tags given slab for digging, if it needs it, and moves dig position to it.
+ * Computer player dig helper function.
+ * @see tool_dig_to_pos2_f()
+ */
+static short tool_dig_to_pos2_dig_slab_f(struct Computer2 * comp, struct ComputerDig * cdig, TbBool simulation,
+    MapSubtlCoord digstl_x, MapSubtlCoord digstl_y, const char *func_name)
+{
+    struct Dungeon *dungeon;
+    struct SlabMap *slb;
+    struct SlabMap *slbw;
+    struct Map *mapblk;
+    struct Map *mapblkw;
+    MapSlabCoord digslb_x;
+    MapSlabCoord digslb_y;
+    long i;
+    dungeon = comp->dungeon;
+    digslb_x = subtile_slab(digstl_x);
+    digslb_y = subtile_slab(digstl_y);
+    slb = get_slabmap_block(digslb_x, digslb_y);
+    struct SlabAttr *slbattr;
+    slbattr = get_slab_attrs(slb);
+    if ((slbattr->is_diggable) && (slb->kind != SlbT_GEMS))
+    {
+        mapblk = get_map_block_at(digstl_x, digstl_y);
+        if (((mapblk->flags & SlbAtFlg_Filled) == 0) || (slabmap_owner(slb) == dungeon->owner))
+        {
+            i = get_subtile_number_at_slab_center(digslb_x,digslb_y);
+            if ((find_from_task_list(dungeon->owner, i) < 0) && (!simulation))
+            {
+                // Only when the computer has enough gold to cast lvl8, will he consider casting lvl3 power, so he has some gold left.
+                if( computer_able_to_use_power(comp, PwrK_DESTRWALLS, 8, 1))
+                {
+                    mapblkw = get_map_block_at(digstl_x, digstl_y-3);
+                    slbw = get_slabmap_block(digslb_x, digslb_y-1);
+                    if(((mapblkw->flags & SlbAtFlg_Filled) >= 1) && (slabmap_owner(slbw) != dungeon->owner))
+                    {
+                        magic_use_available_power_on_subtile(dungeon->owner, PwrK_DESTRWALLS, 3, digstl_x, digstl_y-3, PwCast_Unrevealed);
+                        return -5;
+                    }
+                    else
+                    {
+                        mapblkw = get_map_block_at(digstl_x, digstl_y+3);
+                        slbw = get_slabmap_block(digslb_x, digslb_y+1);
+                        if(((mapblkw->flags & SlbAtFlg_Filled) >= 1) && (slabmap_owner(slbw) != dungeon->owner))
+                        {
+                            magic_use_available_power_on_subtile(dungeon->owner, PwrK_DESTRWALLS, 3, digstl_x, digstl_y+3, PwCast_Unrevealed);
+                            return -5;
+                        }
+                        else
+                        {
+                            mapblkw = get_map_block_at(digstl_x-3, digstl_y);
+                            slbw = get_slabmap_block(digslb_x-1, digslb_y);
+                            if(((mapblkw->flags & SlbAtFlg_Filled) >= 1) && (slabmap_owner(slbw) != dungeon->owner))
+                            {
+                                magic_use_available_power_on_subtile(dungeon->owner, PwrK_DESTRWALLS, 3, digstl_x-3, digstl_y, PwCast_Unrevealed);
+                                return -5;
+                            }
+                            else
+                            {
+                                mapblkw = get_map_block_at(digstl_x+3, digstl_y);
+                                slbw = get_slabmap_block(digslb_x+1, digslb_y);
+                                if(((mapblkw->flags & SlbAtFlg_Filled) >= 1) && (slabmap_owner(slbw) != dungeon->owner))
+                                {
+                                    magic_use_available_power_on_subtile(dungeon->owner, PwrK_DESTRWALLS, 3, digstl_x+3, digstl_y, PwCast_Unrevealed);
+                                    return -5;
+                                }
+                            }
+                        }
+                    }
+                }
+                if (try_game_action(comp, dungeon->owner, GA_MarkDig, 0, digstl_x, digstl_y, 1, 1) <= Lb_OK) 
+                {
+                    ERRORLOG("%s: Couldn't do game action - cannot dig",func_name);
+                    return -2;
+                }
+            }
+        }
+    }
+    cdig->direction_around = small_around_index_towards_destination(cdig->pos_next.x.stl.num,cdig->pos_next.y.stl.num,digstl_x,digstl_y);
+    cdig->pos_next.x.stl.num = digstl_x;
+    cdig->pos_next.y.stl.num = digstl_y;
+    if ((subtile_slab(cdig->pos_dest.x.stl.num) == digslb_x) && (subtile_slab(cdig->pos_dest.y.stl.num) == digslb_y))
+    {
+        SYNCDBG(5,"%s: Reached destination slab (%d,%d)",func_name,(int)digslb_x,(int)digslb_y);
+        return -1;
+    }
+    cdig->pos_begin.x.stl.num = digstl_x;
+    cdig->pos_begin.y.stl.num = digstl_y;
+    SYNCDBG(5,"%s: Going through slab (%d,%d)",func_name,(int)digslb_x,(int)digslb_y);
+    return 0;
+}
+
+/**
+ * Moves dig position along the cheapest route computed by dig planner, tagging slab which requires digging.
+ * Computer player dig helper function.
+ * @see tool_dig_to_pos2_f()
+ * @param retval Result to be returned by tool_dig_to_pos2_f(), if the route was followed.
+ * @return True if the route was followed, false if there is no route.
+ */
+static TbBool tool_dig_to_pos2_follow_planned_route_f(struct Computer2 * comp, struct ComputerDig * cdig, TbBool simulation, unsigned short digflags,
+    short *retval, const char *func_name)
+{
+    struct Dungeon *dungeon;
+    dungeon = comp->dungeon;
+    MapSlabCoord destslb_x;
+    MapSlabCoord destslb_y;
+    MapSlabCoord nextslb_x;
+    MapSlabCoord nextslb_y;
+    long i;
+    destslb_x = subtile_slab(cdig->pos_dest.x.stl.num);
+    destslb_y = subtile_slab(cdig->pos_dest.y.stl.num);
+    nextslb_x = subtile_slab(cdig->pos_begin.x.stl.num);
+    nextslb_y = subtile_slab(cdig->pos_begin.y.stl.num);
+    for (i = 0; ; i++)
+    {
+        if ((nextslb_x == destslb_x) && (nextslb_y == destslb_y))
+        {
+            cdig->pos_next.x.stl.num = slab_subtile_center(nextslb_x);
+            cdig->pos_next.y.stl.num = slab_subtile_center(nextslb_y);
+            SYNCDBG(5,"%s: Reached destination slab (%d,%d)",func_name,(int)nextslb_x,(int)nextslb_y);
+            *retval = -1;
+            return true;
+        }
+        if (!computer_dig_planner_next_slab(comp, &nextslb_x, &nextslb_y, destslb_x, destslb_y, digflags))
+        {
+            if (i == 0) {
+                return false;
+            }
+            ERRORLOG("%s: Planned route from (%d,%d) broken at slab (%d,%d)",func_name,
+                (int)subtile_slab(cdig->pos_begin.x.stl.num),(int)subtile_slab(cdig->pos_begin.y.stl.num),(int)nextslb_x,(int)nextslb_y);
+            *retval = -2;
+            return true;
+        }
+        struct SlabMap *slb;
+        slb = get_slabmap_block(nextslb_x, nextslb_y);
+        if (slab_kind_is_liquid(slb->kind) && (computer_check_room_available(comp, RoK_BRIDGE) == IAvail_Now))
+        {
+            cdig->pos_next.x.stl.num = slab_subtile_center(nextslb_x);
+            cdig->pos_next.y.stl.num = slab_subtile_center(nextslb_y);
+            SYNCDBG(5,"%s: Player %d has bridge, so is going through liquid slab (%d,%d)",func_name,
+                (int)dungeon->owner,(int)nextslb_x,(int)nextslb_y);
+            *retval = -5;
+            return true;
+        }
+        if (slab_good_for_computer_dig_path(slb) && (slb->kind != SlbT_LAVA))
+        {
+            SubtlCodedCoords stl_num;
+            stl_num = get_subtile_number_at_slab_center(nextslb_x,nextslb_y);
+            if (find_from_task_list(dungeon->owner, stl_num) < 0) {
+                // We've reached a slab which needs digging and is not in dig tasks list
+                break;
+            }
+        }
+        if (i > map_tiles_x*map_tiles_y)
+        {
+            ERRORLOG("%s: Infinite loop while following planned dig route",func_name);
+            *retval = -2;
+            return true;
+        }
+    }
+    *retval = tool_dig_to_pos2_dig_slab_f(comp, cdig, simulation, slab_subtile_center(nextslb_x), slab_subtile_center(nextslb_y), func_name);
+    return true;
+}
+
 /**
  * Tool function to do (or simulate) computer player digging.
  * @param comp Computer player which is doing the task.
@@ -1623,9 +1788,6 @@ short tool_dig_to_pos2_f(struct Computer2 * comp, struct ComputerDig * cdig, TbB
 {
     struct Dungeon *dungeon;
     struct SlabMap *slb;
-    struct SlabMap *slbw;
-    struct Map *mapblk;
-    struct Map *mapblkw;
     MapSubtlCoord gldstl_x;
     MapSubtlCoord gldstl_y;
     MapSubtlCoord digstl_x;
@@ -1647,6 +1809,11 @@ short tool_dig_to_pos2_f(struct Computer2 * comp, struct ComputerDig * cdig, TbB
     gldstl_x = stl_slab_center_subtile(cdig->pos_begin.x.stl.num);
     gldstl_y = stl_slab_center_subtile(cdig->pos_begin.y.stl.num);
     SYNCDBG(4,"%s: Dig slabs from (%d,%d) to (%d,%d)",func_name,subtile_slab(gldstl_x),subtile_slab(gldstl_y),subtile_slab(cdig->pos_dest.x.stl.num),subtile_slab(cdig->pos_dest.y.stl.num));
+    // Follow the cheapest route, if there is one; probing the way step by step is a fallback
+    short retval;
+    if (tool_dig_to_pos2_follow_planned_route_f(comp, cdig, simulation, digflags, &retval, func_name)) {
+        return retval;
+    }
     if (get_2d_distance(&cdig->pos_begin, &cdig->pos_dest) <= cdig->distance)
     {
         SYNCDBG(4,"%s: Player %d does small distance digging",func_name,(int)dungeon->owner);
@@ -1743,78 +1910,7 @@ short tool_dig_to_pos2_f(struct Computer2 * comp, struct ComputerDig * cdig, TbB
         digslb_x = subtile_slab(digstl_x);
         digslb_y = subtile_slab(digstl_y);
     }
-    slb = get_slabmap_block(digslb_x, digslb_y);
-    struct SlabAttr *slbattr;
-    slbattr = get_slab_attrs(slb);
-    if ((slbattr->is_diggable) && (slb->kind != SlbT_GEMS))
-    {
-        mapblk = get_map_block_at(digstl_x, digstl_y);
-        if (((mapblk->flags & SlbAtFlg_Filled) == 0) || (slabmap_owner(slb) == dungeon->owner))
-        {
-            i = get_subtile_number_at_slab_center(digslb_x,digslb_y);
-            if ((find_from_task_list(dungeon->owner, i) < 0) && (!simulation))
-            {
-                // Only when the computer has enough gold to cast lvl8, will he consider casting lvl3 power, so he has some gold left.
-                if( computer_able_to_use_power(comp, PwrK_DESTRWALLS, 8, 1))
-                {
-                    mapblkw = get_map_block_at(digstl_x, digstl_y-3);
-                    slbw = get_slabmap_block(digslb_x, digslb_y-1);
-                    if(((mapblkw->flags & SlbAtFlg_Filled) >= 1) && (slabmap_owner(slbw) != dungeon->owner))
-                    {
-                        magic_use_available_power_on_subtile(dungeon->owner, PwrK_DESTRWALLS, 3, digstl_x, digstl_y-3, PwCast_Unrevealed);
-                        return -5;
-                    }
-                    else
-                    {
-                        mapblkw = get_map_block_at(digstl_x, digstl_y+3);
-                        slbw = get_slabmap_block(digslb_x, digslb_y+1);
-                        if(((mapblkw->flags & SlbAtFlg_Filled) >= 1) && (slabmap_owner(slbw) != dungeon->owner))
-                        {
-                            magic_use_available_power_on_subtile(dungeon->owner, PwrK_DESTRWALLS, 3, digstl_x, digstl_y+3, PwCast_Unrevealed);
-                            return -5;
-                        }
-                        else
-                        {
-                            mapblkw = get_map_block_at(digstl_x-3, digstl_y);
-                            slbw = get_slabmap_block(digslb_x-1, digslb_y);
-                            if(((mapblkw->flags & SlbAtFlg_Filled) >= 1) && (slabmap_owner(slbw) != dungeon->owner))
-                            {
-                                magic_use_available_power_on_subtile(dungeon->owner, PwrK_DESTRWALLS, 3, digstl_x-3, digstl_y, PwCast_Unrevealed);
-                                return -5;
-                            }
-                            else
-                            {
-                                mapblkw = get_map_block_at(digstl_x+3, digstl_y);
-                                slbw = get_slabmap_block(digslb_x+1, digslb_y);
-                                if(((mapblkw->flags & SlbAtFlg_Filled) >= 1) && (slabmap_owner(slbw) != dungeon->owner))
-                                {
-                                    magic_use_available_power_on_subtile(dungeon->owner, PwrK_DESTRWALLS, 3, digstl_x+3, digstl_y, PwCast_Unrevealed);
-                                    return -5;
-                                }
-                            }
-                        }
-                    }
-                }
-                if (try_game_action(comp, dungeon->owner, GA_MarkDig, 0, digstl_x, digstl_y, 1, 1) <= Lb_OK) 
-                {
-                    ERRORLOG("%s: Couldn't do game action - cannot dig",func_name);
-                    return -2;
-                }
-            }
-        }
-    }
-    cdig->direction_around = small_around_index_towards_destination(cdig->pos_next.x.stl.num,cdig->pos_next.y.stl.num,digstl_x,digstl_y);
-    cdig->pos_next.x.stl.num = digstl_x;
-    cdig->pos_next.y.stl.num = digstl_y;
-    if ((subtile_slab(cdig->pos_dest.x.stl.num) == digslb_x) && (subtile_slab(cdig->pos_dest.y.stl.num) == digslb_y))
-    {
-        SYNCDBG(5,"%s: Reached destination slab (%d,%d)",func_name,(int)digslb_x,(int)digslb_y);
-        return -1;
-    }
-    cdig->pos_begin.x.stl.num = digstl_x;
-    cdig->pos_begin.y.stl.num = digstl_y;
-    SYNCDBG(5,"%s: Going through slab (%d,%d)",func_name,(int)digslb_x,(int)digslb_y);
-    return 0;
+    return tool_dig_to_pos2_dig_slab_f(comp, cdig, simulation, digstl_x, digstl_y, func_name);
 }
 
 int find_trap_location_index(const struct Computer2 * comp, const struct Coord3d * coord)
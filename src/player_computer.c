@@ -1481,6 +1481,7 @@ void setup_computer_players2(void)
   int i;
   gameadd.turn_last_checked_for_gold = game.play_gameturn;
   check_map_for_gold();
+  reset_computer_dig_planner();
   for (i=0; i < COMPUTER_TASKS_COUNT; i++)
   {
     LbMemorySet(&game.computer_task[i], 0, sizeof(struct ComputerTask));
@@ -1532,6 +1533,7 @@ void setup_computer_players2(void)
 void restore_computer_player_after_load(void)
 {
     SYNCDBG(7,"Starting");
+    reset_computer_dig_planner();
     for (long plyr_idx = 0; plyr_idx < PLAYERS_COUNT; plyr_idx++)
     {
         struct PlayerInfo* player = get_player(plyr_idx);
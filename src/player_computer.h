@@ -657,6 +657,10 @@ short tool_dig_to_pos2_f(struct Computer2 * comp, struct ComputerDig * cdig, TbB
 #define search_spiral(pos, owner, i3, cb) search_spiral_f(pos, owner, i3, cb, __func__)
 int search_spiral_f(struct Coord3d *pos, PlayerNumber owner, int i3, long (*cb)(MapSubtlCoord, MapSubtlCoord, long), const char *func_name);
 /******************************************************************************/
+TbBool computer_dig_planner_next_slab(const struct Computer2 *comp, MapSlabCoord *slb_x, MapSlabCoord *slb_y,
+    MapSlabCoord dest_x, MapSlabCoord dest_y, unsigned short digflags);
+void reset_computer_dig_planner(void);
+/******************************************************************************/
 ItemAvailability computer_check_room_available(const struct Computer2 * comp, long rkind);
 TbBool computer_find_non_solid_block(const struct Computer2 *comp, struct Coord3d *pos);
 
@@ -43,6 +43,7 @@
 #include "ariadne_wallhug.h"
 #include "game_saves.h"
 #include "game_legacy.h"
+#include "net_checksums.h"
 #include "frontend.h"
 #include "magic.h"
 #include "engine_redraw.h"
@@ -853,6 +854,8 @@ void process_players(void)
     sum += compute_players_checksum();
     sum += game.action_rand_seed;
     player_packet_checksum_add(my_player_number,sum,"players");
+    sync_checksum_update_random_seed();
+    sync_checksum_update_dungeons();
     SYNCDBG(17,"Finished");
 }
 
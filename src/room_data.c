@@ -136,6 +136,10 @@ DLLIMPORT struct Room * _DK_pick_random_room(PlayerNumber newowner, int rkind);
 }
 #endif
 /******************************************************************************/
+/** Changed whenever rooms lists or room positions are modified; outdates all room kind indexes. */
+static unsigned long room_index_generation = 1;
+static struct RoomKindIndex room_kind_index[DUNGEONS_COUNT][ROOM_TYPES_COUNT];
+/******************************************************************************/
 struct Room *room_get(long room_idx)
 {
   if ((room_idx < 1) || (room_idx > ROOMS_COUNT))
@@ -1486,6 +1490,7 @@ void delete_room_structure(struct Room *room)
           }
       }
       LbMemorySet(room, 0, sizeof(struct Room));
+      invalidate_room_kind_indexes();
     }
 }
 
@@ -1752,11 +1757,13 @@ void update_room_central_tile_position(struct Room *room)
         {
             room->central_stl_x = cx;
             room->central_stl_y = cy;
+            invalidate_room_kind_indexes();
             return;
         }
     }
     room->central_stl_x = mass_x;
     room->central_stl_y = mass_y;
+    invalidate_room_kind_indexes();
     WARNLOG("Cannot find position in %s index %d to place an ensign.",room_code_name(room->kind),(int)room->index);
 }
 
@@ -1804,6 +1811,7 @@ TbBool add_room_to_players_list(struct Room *room, PlayerNumber plyr_idx)
     }
     dungeon->room_kind[room->kind] = room->index;
     dungeon->room_slabs_count[room->kind]++;
+    invalidate_room_kind_indexes();
     return true;
 }
 
@@ -1836,6 +1844,7 @@ TbBool remove_room_from_players_list(struct Room *room, PlayerNumber plyr_idx)
     room->next_of_owner = 0;
     room->prev_of_owner = 0;
     dungeon->room_slabs_count[room->kind]--;
+    invalidate_room_kind_indexes();
     return true;
 }
 
@@ -2597,6 +2606,105 @@ TbBool find_random_position_at_area_of_room(struct Coord3d *pos, const struct Ro
     return false;
 }
 
+/**
+ * Marks all room kind indexes as outdated.
+ * Needs to be called whenever rooms are added to or removed from players lists, or moved.
+ */
+void invalidate_room_kind_indexes(void)
+{
+    room_index_generation++;
+}
+
+/**
+ * Returns a value which changes whenever rooms are added to or removed from players lists, or moved.
+ * Allows caching values computed from the rooms lists.
+ */
+unsigned long get_room_lists_generation(void)
+{
+    return room_index_generation;
+}
+
+/**
+ * Returns index of rooms of given kind owned by given player, rebuilding it if it's outdated.
+ * The index stores rooms in the order of owner's rooms list.
+ */
+static const struct RoomKindIndex *get_room_kind_index(PlayerNumber plyr_idx, RoomKind rkind)
+{
+    if ((plyr_idx < 0) || (plyr_idx >= DUNGEONS_COUNT) || (rkind >= ROOM_TYPES_COUNT))
+        return NULL;
+    struct Dungeon* dungeon = get_dungeon(plyr_idx);
+    if (dungeon_invalid(dungeon))
+        return NULL;
+    struct RoomKindIndex* rkindex = &room_kind_index[plyr_idx][rkind];
+    if ((rkindex->generation == room_index_generation) && (rkindex->list_head == dungeon->room_kind[rkind]))
+        return rkindex;
+    rkindex->count = 0;
+    unsigned long k = 0;
+    long i = dungeon->room_kind[rkind];
+    while (i != 0)
+    {
+        struct Room* room = room_get(i);
+        if (room_is_invalid(room))
+        {
+            ERRORLOG("Jump to invalid room detected");
+            break;
+        }
+        i = room->next_of_owner;
+        // Per-room code
+        rkindex->rooms[rkindex->count].index = room->index;
+        rkindex->rooms[rkindex->count].stl_x = room->central_stl_x;
+        rkindex->rooms[rkindex->count].stl_y = room->central_stl_y;
+        rkindex->count++;
+        // Per-room code ends
+        k++;
+        if (k >= ROOMS_COUNT)
+        {
+            ERRORLOG("Infinite loop detected when sweeping rooms list");
+            break;
+        }
+    }
+    rkindex->list_head = dungeon->room_kind[rkind];
+    rkindex->generation = room_index_generation;
+    return rkindex;
+}
+
+/**
+ * Fills given array with rooms of given kind and owner, ordered by distance from given subtile.
+ * Rooms at equal distance stay in the order of owner's rooms list, so taking the first matching
+ * room from the array gives the same result as sweeping the whole list for the nearest one.
+ * @param rooms_idx Output array, needs to have ROOMS_COUNT elements.
+ * @param distances Output array for simplified distances, or NULL.
+ * @return Amount of rooms in the array.
+ */
+long get_rooms_of_kind_ordered_by_distance(PlayerNumber plyr_idx, RoomKind rkind, MapSubtlCoord stl_x, MapSubtlCoord stl_y, RoomIndex *rooms_idx, long *distances)
+{
+    const struct RoomKindIndex* rkindex = get_room_kind_index(plyr_idx, rkind);
+    if (rkindex == NULL)
+        return 0;
+    long dist_buf[ROOMS_COUNT];
+    if (distances == NULL)
+        distances = dist_buf;
+    long n = 0;
+    for (long i = 0; i < rkindex->count; i++)
+    {
+        const struct RoomKindIndexItem* item = &rkindex->rooms[i];
+        // Compute simplified distance - without use of mul or div
+        long distance = abs(stl_x - item->stl_x) + abs(stl_y - item->stl_y);
+        // Insertion sort; with strict comparison, it keeps list order for equal distances
+        long m = n;
+        while ((m > 0) && (distances[m-1] > distance))
+        {
+            distances[m] = distances[m-1];
+            rooms_idx[m] = rooms_idx[m-1];
+            m--;
+        }
+        distances[m] = distance;
+        rooms_idx[m] = item->index;
+        n++;
+    }
+    return n;
+}
+
 /**
  * Finds a room with space item slot for storage.
  * Note that this function may return a room filled to its full by workers. Only item storage
@@ -2852,45 +2960,25 @@ TbBool find_first_valid_position_for_thing_anywhere_in_room(const struct Thing *
 struct Room *find_nearest_room_for_thing_with_spare_capacity(struct Thing *thing, signed char owner, RoomKind rkind, unsigned char nav_flags, long spare)
 {
     SYNCDBG(18,"Searching for %s with capacity for %s index %d",room_code_name(rkind),thing_model_name(thing),(int)thing->index);
-    struct Dungeon* dungeon = get_dungeon(owner);
-    struct Room* nearoom = INVALID_ROOM;
-    long neardistance = LONG_MAX;
-    unsigned long k = 0;
-    int i = dungeon->room_kind[rkind];
-    while (i != 0)
+    RoomIndex rooms_idx[ROOMS_COUNT];
+    long count = get_rooms_of_kind_ordered_by_distance(owner, rkind, thing->mappos.x.stl.num, thing->mappos.y.stl.num, rooms_idx, NULL);
+    // Rooms are sorted by distance, so the first one which passes all checks is the nearest
+    for (long i = 0; i < count; i++)
     {
-        struct Room* room = room_get(i);
-        if (room_is_invalid(room))
-        {
-            ERRORLOG("Jump to invalid room detected");
-            break;
-        }
-        i = room->next_of_owner;
-        // Per-room code
-        // Compute simplified distance - without use of mul or div
-        long distance = abs(thing->mappos.x.stl.num - room->central_stl_x) + abs(thing->mappos.y.stl.num - room->central_stl_y);
-        if ((neardistance > distance) && (room->used_capacity + spare <= room->total_capacity))
+        struct Room* room = room_get(rooms_idx[i]);
+        if (room->used_capacity + spare > room->total_capacity)
+            continue;
+        struct Coord3d pos;
+        if (find_first_valid_position_for_thing_anywhere_in_room(thing, room, &pos))
         {
-            struct Coord3d pos;
-            if (find_first_valid_position_for_thing_anywhere_in_room(thing, room, &pos))
+            if ((thing->class_id != TCls_Creature)
+              || creature_can_navigate_to(thing, &pos, nav_flags))
             {
-                if ((thing->class_id != TCls_Creature)
-                  || creature_can_navigate_to(thing, &pos, nav_flags))
-                {
-                    neardistance = distance;
-                    nearoom = room;
-                }
+                return room;
             }
         }
-        // Per-room code ends
-        k++;
-        if (k > ROOMS_COUNT)
-        {
-          ERRORLOG("Infinite loop detected when sweeping rooms list");
-          break;
-        }
     }
-    return nearoom;
+    return INVALID_ROOM;
 }
 
 /**
@@ -3033,35 +3121,22 @@ struct Room *find_random_room_with_used_capacity_creature_can_navigate_to(struct
  */
 struct Room *find_room_nearest_to_position(PlayerNumber plyr_idx, RoomKind rkind, const struct Coord3d *pos, long *room_distance)
 {
-    struct Dungeon* dungeon = get_dungeon(plyr_idx);
     long near_distance = LONG_MAX;
     struct Room* near_room = INVALID_ROOM;
-    long i = dungeon->room_kind[rkind];
-    unsigned long k = 0;
-    while (i != 0)
+    const struct RoomKindIndex* rkindex = get_room_kind_index(plyr_idx, rkind);
+    if (rkindex != NULL)
     {
-        struct Room* room = room_get(i);
-        if (room_is_invalid(room))
-        {
-            ERRORLOG("Jump to invalid room detected");
-            break;
-        }
-        i = room->next_of_owner;
-        // Per-room code
-        MapCoordDelta delta_x = subtile_coord_center(room->central_stl_x) - (MapCoordDelta)pos->x.val;
-        MapCoordDelta delta_y = subtile_coord_center(room->central_stl_y) - (MapCoordDelta)pos->y.val;
-        long distance = LbDiagonalLength(abs(delta_x), abs(delta_y));
-        if (distance < near_distance)
+        for (long i = 0; i < rkindex->count; i++)
         {
-            near_room = room;
-            near_distance = distance;
-        }
-        // Per-room code ends
-        k++;
-        if (k > ROOMS_COUNT)
-        {
-            ERRORLOG("Infinite loop detected when sweeping rooms list");
-            break;
+            const struct RoomKindIndexItem* item = &rkindex->rooms[i];
+            MapCoordDelta delta_x = subtile_coord_center(item->stl_x) - (MapCoordDelta)pos->x.val;
+            MapCoordDelta delta_y = subtile_coord_center(item->stl_y) - (MapCoordDelta)pos->y.val;
+            long distance = LbDiagonalLength(abs(delta_x), abs(delta_y));
+            if (distance < near_distance)
+            {
+                near_room = room_get(item->index);
+                near_distance = distance;
+            }
         }
     }
     *room_distance = near_distance;
@@ -3382,7 +3457,18 @@ struct Room * find_random_room_for_thing_with_spare_room_item_capacity(struct Th
 short delete_room_slab_when_no_free_room_structures(long a1, long a2, unsigned char a3)
 {
     SYNCDBG(8,"Starting");
-    return _DK_delete_room_slab_when_no_free_room_structures(a1, a2, a3);
+    // DLL replaces the slab without our setters
+    struct SlabMap* slb = get_slabmap_block(a1, a2);
+    SlabKind prev_kind = slb->kind;
+    PlayerNumber prev_owner = slabmap_owner(slb);
+    short ret = _DK_delete_room_slab_when_no_free_room_structures(a1, a2, a3);
+    // DLL also updates PannelMap and map blocks by itself, bypassing our change tracking
+    if (slabmap_note_direct_change(slb, prev_kind, prev_owner))
+    {
+        PannelMapGeneration++;
+        map_blocks_changed();
+    }
+    return ret;
 }
 
 unsigned char find_random_valid_position_for_thing_in_room_avoiding_object_excluding_room_slab(struct Thing *thing, struct Room *room, struct Coord3d *pos, long a4)
@@ -3886,44 +3972,24 @@ struct Room *place_room(PlayerNumber owner, RoomKind rkind, MapSubtlCoord stl_x,
 
 struct Room *find_nearest_room_for_thing_with_spare_item_capacity(struct Thing *thing, PlayerNumber plyr_idx, RoomKind rkind, unsigned char nav_flags)
 {
-    long retdist = LONG_MAX;
-    struct Room* retroom = INVALID_ROOM;
-
-    struct Dungeon* dungeon = get_dungeon(plyr_idx);
-    long i = dungeon->room_kind[rkind];
-    unsigned long k = 0;
-    while (i != 0)
+    RoomIndex rooms_idx[ROOMS_COUNT];
+    long count = get_rooms_of_kind_ordered_by_distance(plyr_idx, rkind, thing->mappos.x.stl.num, thing->mappos.y.stl.num, rooms_idx, NULL);
+    // Rooms are sorted by distance, so the first one which passes all checks is the nearest
+    for (long i = 0; i < count; i++)
     {
-        struct Room* room = room_get(i);
-        if (room_is_invalid(room))
-        {
-            ERRORLOG("Jump to invalid room detected");
-            break;
-        }
-        i = room->next_of_owner;
-        // Per-room code
-        long dist = abs(thing->mappos.x.stl.num - room->central_stl_x) + abs(thing->mappos.y.stl.num - room->central_stl_y);
-        if ((dist < retdist) && (room->total_capacity > room->capacity_used_for_storage))
+        struct Room* room = room_get(rooms_idx[i]);
+        if (room->total_capacity <= room->capacity_used_for_storage)
+            continue;
+        struct Coord3d pos;
+        if (find_first_valid_position_for_thing_anywhere_in_room(thing, room, &pos))
         {
-            struct Coord3d pos;
-            if (find_first_valid_position_for_thing_anywhere_in_room(thing, room, &pos))
+            if (!thing_is_creature(thing) || creature_can_navigate_to(thing, &pos, nav_flags))
             {
-                if (!thing_is_creature(thing) || creature_can_navigate_to(thing, &pos, nav_flags))
-                {
-                    retdist = dist;
-                    retroom = room;
-                }
+                return room;
             }
         }
-        // Per-room code ends
-        k++;
-        if (k > ROOMS_COUNT)
-        {
-            ERRORLOG("Infinite loop detected when sweeping rooms list");
-            break;
-        }
     }
-    return retroom;
+    return INVALID_ROOM;
 }
 
 struct Room * pick_random_room(PlayerNumber plyr_idx, RoomKind rkind)
@@ -4415,9 +4481,11 @@ long take_over_room(struct Room* room, PlayerNumber newowner)
         room->owner = newowner;
         room->health = compute_room_max_health(room->slabs_count, room->efficiency);
         add_room_to_players_list(room, newowner);
+        begin_map_updates_batch();
         change_room_map_element_ownership(room, newowner);
         redraw_room_map_elements(room);
         do_room_unprettying(room, newowner);
+        end_map_updates_batch();
         do_room_integration(room);
         return 1;
     } else
@@ -4428,9 +4496,11 @@ long take_over_room(struct Room* room, PlayerNumber newowner)
         room->owner = newowner;
         room->health = compute_room_max_health(room->slabs_count, room->efficiency);
         add_room_to_players_list(room, newowner);
+        begin_map_updates_batch();
         change_room_map_element_ownership(room, newowner);
         redraw_room_map_elements(room);
         do_room_unprettying(room, newowner);
+        end_map_updates_batch();
         do_room_integration(room);
         return 1;
     }
@@ -4449,6 +4519,7 @@ void destroy_room_leaving_unclaimed_ground(struct Room *room)
 {
     unsigned long k = 0;
     long i = room->slabs_list;
+    begin_map_updates_batch();
     while (i != 0)
     {
         long slb_x = slb_num_decode_x(i);
@@ -4470,6 +4541,7 @@ void destroy_room_leaving_unclaimed_ground(struct Room *room)
             break;
         }
     }
+    end_map_updates_batch();
 }
 
 void destroy_dungeon_heart_room(PlayerNumber plyr_idx, const struct Thing *heartng)
@@ -168,6 +168,20 @@ DLLIMPORT extern struct RoomData _DK_room_data[];
 
 #pragma pack()
 /******************************************************************************/
+struct RoomKindIndexItem {
+    RoomIndex index;
+    unsigned char stl_x;
+    unsigned char stl_y;
+};
+
+/** Compact copy of a players rooms list of one kind, with room positions. */
+struct RoomKindIndex {
+    unsigned long generation;
+    RoomIndex list_head;
+    long count;
+    struct RoomKindIndexItem rooms[ROOMS_COUNT];
+};
+/******************************************************************************/
 extern unsigned short const room_effect_elements[];
 extern struct AroundLByte const room_spark_offset[];
 extern struct RoomData room_data[];
@@ -210,6 +224,9 @@ struct Room *find_room_with_spare_capacity(PlayerNumber owner, RoomKind rkind, l
 struct Room *find_nth_room_of_owner_with_spare_capacity_starting_with(long room_idx, long n, long spare);
 struct Room *find_room_with_most_spare_capacity_starting_with(long room_idx, long *total_spare_cap);
 struct Room *find_room_nearest_to_position(PlayerNumber plyr_idx, RoomKind rkind, const struct Coord3d *pos, long *room_distance);
+void invalidate_room_kind_indexes(void);
+unsigned long get_room_lists_generation(void);
+long get_rooms_of_kind_ordered_by_distance(PlayerNumber plyr_idx, RoomKind rkind, MapSubtlCoord stl_x, MapSubtlCoord stl_y, RoomIndex *rooms_idx, long *distances);
 // Finding a navigable room for a thing
 struct Room *find_room_for_thing_with_used_capacity(const struct Thing *creatng, PlayerNumber plyr_idx, RoomKind rkind, unsigned char nav_flags, long min_used_cap);
 struct Room *find_random_room_with_used_capacity_creature_can_navigate_to(struct Thing *thing, PlayerNumber owner, RoomKind rkind, unsigned char nav_flags);
@@ -47,6 +47,7 @@ void clear_rooms(void)
     {
         memset(&game.rooms[i], 0, sizeof(struct Room));
   }
+  invalidate_room_kind_indexes();
 }
 
 /**
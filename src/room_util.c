@@ -37,8 +37,14 @@
 #include "config_creature.h"
 #include "gui_soundmsgs.h"
 #include "game_legacy.h"
+#include "net_checksums.h"
 #include "keeperfx.hpp"
 
+/******************************************************************************/
+/** Interval, in game turns, of verifying the cached rooms count in debug builds. */
+#define ROOMS_COUNT_VERIFY_INTERVAL 200
+/** Rooms lists generation for which rooms count in dungeons was computed. */
+static unsigned long rooms_count_generation = 0;
 /******************************************************************************/
 struct Thing *create_room_surrounding_flame(struct Room *room, const struct Coord3d *pos,
     unsigned short eetype, PlayerNumber owner)
@@ -107,21 +113,56 @@ void process_room_surrounding_flames(struct Room *room)
     room->flame_stl = (room->flame_stl + 1) % 3;
 }
 
+static long count_player_buildable_rooms(PlayerNumber plyr_idx)
+{
+    long count = 0;
+    for (RoomKind rkind = 1; rkind < ROOM_TYPES_COUNT; rkind++)
+    {
+        if (!room_never_buildable(rkind))
+        {
+            count += count_player_rooms_of_type(plyr_idx, rkind);
+        }
+    }
+    return count;
+}
+
 void recompute_rooms_count_in_dungeons(void)
 {
     SYNCDBG(17,"Starting");
     for (long i = 0; i < DUNGEONS_COUNT; i++)
     {
         struct Dungeon* dungeon = get_dungeon(i);
-        dungeon->total_rooms = 0;
-        for (RoomKind rkind = 1; rkind < ROOM_TYPES_COUNT; rkind++)
+        dungeon->total_rooms = count_player_buildable_rooms(i);
+    }
+    rooms_count_generation = get_room_lists_generation();
+}
+
+/**
+ * Updates rooms count in dungeons, if any room was added to or removed from players lists.
+ * Rooms count depends on the lists only, so if they didn't change, the previous count is still valid.
+ */
+void update_rooms_count_in_dungeons(void)
+{
+    if (rooms_count_generation != get_room_lists_generation())
+    {
+        recompute_rooms_count_in_dungeons();
+        return;
+    }
+#if (BFDEBUG_LEVEL > 0)
+    if ((game.play_gameturn % ROOMS_COUNT_VERIFY_INTERVAL) == 0)
+    {
+        for (long i = 0; i < DUNGEONS_COUNT; i++)
         {
-            if (!room_never_buildable(rkind))
+            struct Dungeon* dungeon = get_dungeon(i);
+            long count = count_player_buildable_rooms(i);
+            if (dungeon->total_rooms != count)
             {
-                dungeon->total_rooms += count_player_rooms_of_type(i, rkind);
+                ERRORLOG("Player %d rooms count %d is outdated, should be %d",(int)i,(int)dungeon->total_rooms,(int)count);
+                dungeon->total_rooms = count;
             }
         }
     }
+#endif
 }
 
 void process_rooms(void)
@@ -131,17 +172,22 @@ void process_rooms(void)
   for (struct Room* room = start_rooms; room < end_rooms; room++)
   {
       if (!room_exists(room))
+      {
+          sync_checksum_update_room(room, 0);
           continue;
+      }
       if (room_role_matches(room->kind, RoRoF_FoodSpawn)) {
           room_grow_food(room);
       }
-      sum += room->slabs_count + room->central_stl_x + room->central_stl_y + room->efficiency + room->used_capacity;
+      TbBigChecksum room_sum = room->slabs_count + room->central_stl_x + room->central_stl_y + room->efficiency + room->used_capacity;
+      sync_checksum_update_room(room, room_sum);
+      sum += room_sum;
       if (room_has_surrounding_flames(room->kind) && ((game.numfield_D & GNFldD_Unkn40) != 0)) {
           process_room_surrounding_flames(room);
       }
   }
   player_packet_checksum_add(my_player_number, sum, "rooms");
-  recompute_rooms_count_in_dungeons();
+  update_rooms_count_in_dungeons();
   SYNCDBG(9,"Finished");
 }
 
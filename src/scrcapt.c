@@ -33,18 +33,61 @@
 #include "frontend.h"
 
 #include <string.h>
+#include <SDL2/SDL.h>
+/******************************************************************************/
+#define CAPTURE_QUEUE_LENGTH 8
+
+enum CaptureFrameKinds {
+    CptFrm_None = 0,
+    CptFrm_ScreenShot,
+    CptFrm_MovieFrame,
+};
+
+/** Copy of the 8-bit screen, waiting in queue to be encoded. */
+struct CaptureFrame {
+    unsigned char kind;
+    short format;
+    int width;
+    int height;
+    int bpp;
+    unsigned char palette[768];
+    unsigned char *data;
+    long data_size;
+};
+
+/**
+ * Queue of captured frames, consumed by the encoder thread.
+ * Only the game thread adds frames, and only the encoder removes them.
+ */
+struct CaptureQueue {
+    struct CaptureFrame frames[CAPTURE_QUEUE_LENGTH];
+    int head;
+    int count;
+    TbBool exit;
+    SDL_Thread *thread;
+    SDL_mutex *mutex;
+    SDL_cond *cond;
+    struct ScreenCaptureStats stats;
+    unsigned long movie_start_written;
+    unsigned long movie_start_dropped;
+    /** Screenshot result to be reported to the player by the game thread. */
+    char shot_fname[64];
+    short shot_result;
+};
+
 /******************************************************************************/
 
 short screenshot_format=1;
-unsigned char cap_palette[768];
+struct CaptureQueue capture_queue;
 
 /******************************************************************************/
-long prepare_hsi_screenshot(unsigned char *buf,unsigned char *palette)
+long prepare_hsi_screenshot(unsigned char *buf, const struct CaptureFrame *frame)
 {
     long i;
     long pos = 0;
-    int w = MyScreenWidth / pixel_size;
-    int h = MyScreenHeight / pixel_size;
+    int w = frame->width;
+    int h = frame->height;
+    const unsigned char *palette = frame->palette;
 
     write_int8_buf(buf + pos, 'm');
     pos++;
@@ -86,33 +129,19 @@ long prepare_hsi_screenshot(unsigned char *buf,unsigned char *palette)
     write_int8_buf(buf+pos,4*palette[i+1]);pos++;
     write_int8_buf(buf+pos,4*palette[i+2]);pos++;
   }
-  short lock_mem = LbScreenIsLocked();
-  if (!lock_mem)
-  {
-    if (LbScreenLock() != Lb_SUCCESS)
-    {
-      ERRORLOG("Can't lock canvas");
-      LbMemoryFree(buf);
-      return 0;
-    }
-  }
-  for (i=0; i<h; i++)
-  {
-    memcpy(buf+pos, lbDisplay.WScreen + lbDisplay.GraphicsScreenWidth*i, w);
-    pos += w;
-  }
-  if (!lock_mem)
-    LbScreenUnlock();
+  memcpy(buf+pos, frame->data, w*h);
+  pos += w*h;
   return pos;
 }
 
-long prepare_bmp_screenshot(unsigned char *buf,unsigned char *palette)
+long prepare_bmp_screenshot(unsigned char *buf, const struct CaptureFrame *frame)
 {
     long i;
     long j;
     long pos = 0;
-    int width = MyScreenWidth / pixel_size;
-    int height = MyScreenHeight / pixel_size;
+    int width = frame->width;
+    int height = frame->height;
+    const unsigned char *palette = frame->palette;
     write_int8_buf(buf + pos, 'B');
     pos++;
     write_int8_buf(buf + pos, 'M');
@@ -168,19 +197,9 @@ long prepare_bmp_screenshot(unsigned char *buf,unsigned char *palette)
         write_int8_buf(buf + pos, 0);
         pos++;
   }
-  short lock_mem = LbScreenIsLocked();
-  if (!lock_mem)
-  {
-    if (LbScreenLock() != Lb_SUCCESS)
-    {
-      ERRORLOG("Can't lock canvas");
-      LbMemoryFree(buf);
-      return 0;
-    }
-  }
   for (i=0; i<height; i++)
   {
-    memcpy(buf+pos, lbDisplay.WScreen + lbDisplay.GraphicsScreenWidth*(height-i-1), width);
+    memcpy(buf+pos, frame->data + width*(height-i-1), width);
     pos += width;
     if ((padding_size&3) > 0)
       for (j=0; j < padding_size; j++)
@@ -188,18 +207,18 @@ long prepare_bmp_screenshot(unsigned char *buf,unsigned char *palette)
         write_int8_buf(buf+pos,0);pos++;
       }
   }
-  if (!lock_mem)
-    LbScreenUnlock();
   return pos;
 }
 
-TbBool cumulative_screen_shot(void)
+/**
+ * Encodes a screenshot from captured frame and stores it in a new file.
+ * Called by the capture encoder thread; result is reported by game thread.
+ */
+static TbBool save_screenshot_frame(const struct CaptureFrame *frame, char *fname)
 {
-  //_DK_cumulative_screen_shot();return;
   static long frame_number=0;
-  char fname[255];
   const char *fext;
-  switch (screenshot_format)
+  switch (frame->format)
   {
   case 1:
     fext="raw";
@@ -221,28 +240,25 @@ TbBool cumulative_screen_shot(void)
   frame_number = i;
   if (frame_number >= 10000)
   {
-    show_onscreen_msg(game.num_fps, "No free filename for screenshot.");
+    fname[0] = '\0';
     return false;
   }
   sprintf(fname, "scrshots/scr%05ld.%s", frame_number, fext);
+  frame_number++;
 
-  int w = MyScreenWidth / pixel_size;
-  int h = MyScreenHeight / pixel_size;
-
-  unsigned char* buf = LbMemoryAlloc((w + 3) * h + 2048);
+  unsigned char* buf = LbMemoryAlloc((frame->width + 3) * frame->height + 2048);
   if (buf == NULL)
   {
     ERRORLOG("Can't allocate buffer");
     return false;
   }
-  LbPaletteGet(cap_palette);
-  switch (screenshot_format)
+  switch (frame->format)
   {
   case 1:
-    ssize=prepare_hsi_screenshot(buf,cap_palette);
+    ssize=prepare_hsi_screenshot(buf,frame);
     break;
   case 2:
-    ssize=prepare_bmp_screenshot(buf,cap_palette);
+    ssize=prepare_bmp_screenshot(buf,frame);
     break;
   default:
     ssize=0;
@@ -251,19 +267,246 @@ TbBool cumulative_screen_shot(void)
   if (ssize>0)
     ssize = LbFileSaveAt(fname, buf, ssize);
   LbMemoryFree(buf);
-  if (ssize>0)
-    show_onscreen_msg(game.num_fps, "File \"%s\" saved.", fname);
-  else
-    show_onscreen_msg(game.num_fps, "Cannot save \"%s\".", fname);
-  frame_number++;
   return (ssize>0);
 }
 
+static TbBool encode_capture_frame(struct CaptureFrame *frame)
+{
+    char fname[sizeof(capture_queue.shot_fname)];
+    TbBool result;
+    switch (frame->kind)
+    {
+    case CptFrm_ScreenShot:
+        result = save_screenshot_frame(frame, fname);
+        SDL_LockMutex(capture_queue.mutex);
+        strcpy(capture_queue.shot_fname, fname);
+        capture_queue.shot_result = result ? 1 : -1;
+        SDL_UnlockMutex(capture_queue.mutex);
+        return result;
+    case CptFrm_MovieFrame:
+        return anim_record_frame(frame->data, frame->palette, frame->width, frame->height, frame->bpp);
+    default:
+        return false;
+    }
+}
+
+static int capture_encoder_thread(void *data)
+{
+    struct CaptureQueue *cque = (struct CaptureQueue *)data;
+    SDL_LockMutex(cque->mutex);
+    while (true)
+    {
+        while ((cque->count == 0) && !cque->exit)
+            SDL_CondWait(cque->cond, cque->mutex);
+        if (cque->count == 0)
+            break;
+        // The head frame stays counted until encoded, so producer won't reuse it
+        struct CaptureFrame *frame = &cque->frames[cque->head];
+        SDL_UnlockMutex(cque->mutex);
+        TbBool result = encode_capture_frame(frame);
+        SDL_LockMutex(cque->mutex);
+        if (result)
+            cque->stats.frames_written++;
+        else
+            cque->stats.frames_failed++;
+        cque->head = (cque->head + 1) % CAPTURE_QUEUE_LENGTH;
+        cque->count--;
+        SDL_CondBroadcast(cque->cond);
+    }
+    SDL_UnlockMutex(cque->mutex);
+    return 0;
+}
+
+static TbBool capture_queue_start(void)
+{
+    if (capture_queue.mutex != NULL)
+        return (capture_queue.thread != NULL);
+    capture_queue.mutex = SDL_CreateMutex();
+    capture_queue.cond = SDL_CreateCond();
+    capture_queue.exit = false;
+    capture_queue.thread = SDL_CreateThread(capture_encoder_thread, "ScreenCapture", &capture_queue);
+    if (capture_queue.thread == NULL) {
+        WARNLOG("Cannot create capture encoder thread, frames will be encoded synchronously: %s", SDL_GetError());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Copies the current screen and palette into capture queue.
+ * If the encoder can't keep up, the frame is dropped instead of stalling the game.
+ * @return True if the frame was queued (or encoded in place, if there is no encoder thread).
+ */
+static TbBool capture_queue_add_frame(unsigned char kind)
+{
+    TbBool threaded = capture_queue_start();
+    SDL_LockMutex(capture_queue.mutex);
+    if (capture_queue.count >= CAPTURE_QUEUE_LENGTH)
+    {
+        capture_queue.stats.frames_dropped++;
+        SDL_UnlockMutex(capture_queue.mutex);
+        return false;
+    }
+    struct CaptureFrame *frame = &capture_queue.frames[(capture_queue.head + capture_queue.count) % CAPTURE_QUEUE_LENGTH];
+    SDL_UnlockMutex(capture_queue.mutex);
+    // Slots past the queued count belong to this thread, so the copy needs no lock
+    int w = MyScreenWidth / pixel_size;
+    int h = MyScreenHeight / pixel_size;
+    if (frame->data_size < w * h)
+    {
+        LbMemoryFree(frame->data);
+        frame->data = LbMemoryAlloc(w * h);
+        if (frame->data == NULL)
+        {
+            ERRORLOG("Can't allocate capture buffer");
+            frame->data_size = 0;
+            return false;
+        }
+        frame->data_size = w * h;
+    }
+    short lock_mem = LbScreenIsLocked();
+    if (!lock_mem)
+    {
+        if (LbScreenLock() != Lb_SUCCESS)
+        {
+            ERRORLOG("Can't lock canvas");
+            return false;
+        }
+    }
+    long i;
+    for (i=0; i < h; i++)
+    {
+        memcpy(frame->data + w*i, lbDisplay.WScreen + lbDisplay.GraphicsScreenWidth*i, w);
+    }
+    if (!lock_mem)
+        LbScreenUnlock();
+    LbPaletteGet(frame->palette);
+    frame->kind = kind;
+    frame->format = screenshot_format;
+    frame->width = w;
+    frame->height = h;
+    frame->bpp = LbGraphicsScreenBPP();
+    if (!threaded)
+    {
+        TbBool result = encode_capture_frame(frame);
+        if (result)
+            capture_queue.stats.frames_written++;
+        else
+            capture_queue.stats.frames_failed++;
+        return result;
+    }
+    SDL_LockMutex(capture_queue.mutex);
+    capture_queue.count++;
+    capture_queue.stats.frames_queued++;
+    if (capture_queue.stats.max_queue_depth < capture_queue.count)
+        capture_queue.stats.max_queue_depth = capture_queue.count;
+    SDL_CondBroadcast(capture_queue.cond);
+    SDL_UnlockMutex(capture_queue.mutex);
+    return true;
+}
+
+/**
+ * Waits until the encoder thread has written all queued frames.
+ */
+void screen_capture_flush(void)
+{
+    if (capture_queue.thread == NULL)
+        return;
+    SDL_LockMutex(capture_queue.mutex);
+    while (capture_queue.count > 0)
+        SDL_CondWait(capture_queue.cond, capture_queue.mutex);
+    SDL_UnlockMutex(capture_queue.mutex);
+}
+
+/**
+ * Writes any queued frames, stops the encoder thread and frees capture buffers.
+ */
+void screen_capture_shutdown(void)
+{
+    if (capture_queue.mutex == NULL)
+        return;
+    if (capture_queue.thread != NULL)
+    {
+        SDL_LockMutex(capture_queue.mutex);
+        capture_queue.exit = true;
+        SDL_CondBroadcast(capture_queue.cond);
+        SDL_UnlockMutex(capture_queue.mutex);
+        SDL_WaitThread(capture_queue.thread, NULL);
+        capture_queue.thread = NULL;
+    }
+    int i;
+    for (i=0; i < CAPTURE_QUEUE_LENGTH; i++)
+    {
+        LbMemoryFree(capture_queue.frames[i].data);
+        capture_queue.frames[i].data = NULL;
+        capture_queue.frames[i].data_size = 0;
+    }
+    SDL_DestroyCond(capture_queue.cond);
+    capture_queue.cond = NULL;
+    SDL_DestroyMutex(capture_queue.mutex);
+    capture_queue.mutex = NULL;
+    capture_queue.head = 0;
+    capture_queue.count = 0;
+}
+
+void get_screen_capture_stats(struct ScreenCaptureStats *stats)
+{
+    if (capture_queue.mutex == NULL) {
+        *stats = capture_queue.stats;
+        return;
+    }
+    SDL_LockMutex(capture_queue.mutex);
+    *stats = capture_queue.stats;
+    SDL_UnlockMutex(capture_queue.mutex);
+}
+
+/**
+ * Shows message about the last screenshot finished by the encoder thread.
+ */
+static void report_screenshot_result(void)
+{
+    if (capture_queue.mutex == NULL)
+        return;
+    char fname[sizeof(capture_queue.shot_fname)];
+    SDL_LockMutex(capture_queue.mutex);
+    short result = capture_queue.shot_result;
+    capture_queue.shot_result = 0;
+    strcpy(fname, capture_queue.shot_fname);
+    SDL_UnlockMutex(capture_queue.mutex);
+    if (result > 0)
+        show_onscreen_msg(game.num_fps, "File \"%s\" saved.", fname);
+    else if ((result < 0) && (fname[0] == '\0'))
+        show_onscreen_msg(game.num_fps, "No free filename for screenshot.");
+    else if (result < 0)
+        show_onscreen_msg(game.num_fps, "Cannot save \"%s\".", fname);
+}
+
+TbBool cumulative_screen_shot(void)
+{
+  //_DK_cumulative_screen_shot();return;
+  if ((screenshot_format < 1) || (screenshot_format > 2))
+  {
+    ERRORLOG("Screenshot format incorrectly set.");
+    return false;
+  }
+  if (!capture_queue_add_frame(CptFrm_ScreenShot))
+  {
+    show_onscreen_msg(game.num_fps, "Screenshot skipped, capture queue is full.");
+    return false;
+  }
+  return true;
+}
+
 TbBool movie_record_start(void)
 {
+  screen_capture_flush();
   if ( anim_record() )
   {
       set_flag_byte(&game.system_flags,GSF_CaptureMovie,true);
+      struct ScreenCaptureStats stats;
+      get_screen_capture_stats(&stats);
+      capture_queue.movie_start_written = stats.frames_written;
+      capture_queue.movie_start_dropped = stats.frames_dropped;
       return true;
   }
   return false;
@@ -272,23 +515,19 @@ TbBool movie_record_start(void)
 TbBool movie_record_stop(void)
 {
     set_flag_byte(&game.system_flags,GSF_CaptureMovie,false);
+    screen_capture_flush();
     anim_stop();
+    struct ScreenCaptureStats stats;
+    get_screen_capture_stats(&stats);
+    SYNCLOG("Movie capture statistics: %lu frames written, %lu dropped, max queue depth %lu.",
+        stats.frames_written - capture_queue.movie_start_written,
+        stats.frames_dropped - capture_queue.movie_start_dropped, stats.max_queue_depth);
     return true;
 }
 
 TbBool movie_record_frame(void)
 {
-    short lock_mem = LbScreenIsLocked();
-    if (!lock_mem)
-    {
-        if (LbScreenLock() != Lb_SUCCESS)
-            return false;
-  }
-  LbPaletteGet(cap_palette);
-  short result = anim_record_frame(lbDisplay.WScreen, cap_palette);
-  if (!lock_mem)
-    LbScreenUnlock();
-  return result;
+    return capture_queue_add_frame(CptFrm_MovieFrame);
 }
 
 /**
@@ -298,6 +537,7 @@ TbBool movie_record_frame(void)
 TbBool perform_any_screen_capturing(void)
 {
     TbBool captured=0;
+    report_screenshot_result();
     if ((game.system_flags & GSF_CaptureSShot) != 0)
     {
       captured |= cumulative_screen_shot();
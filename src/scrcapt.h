@@ -26,6 +26,16 @@
 extern "C" {
 #endif
 
+/******************************************************************************/
+/** Counters of the background screen capture encoder. */
+struct ScreenCaptureStats {
+    unsigned long frames_queued;
+    unsigned long frames_written;
+    unsigned long frames_dropped;
+    unsigned long frames_failed;
+    unsigned long max_queue_depth;
+};
+
 /******************************************************************************/
 extern short screenshot_format;
 
@@ -35,6 +45,10 @@ TbBool cumulative_screen_shot(void);
 
 TbBool movie_record_start(void);
 TbBool movie_record_stop(void);
+
+void screen_capture_flush(void);
+void screen_capture_shutdown(void);
+void get_screen_capture_stats(struct ScreenCaptureStats *stats);
 /******************************************************************************/
 #ifdef __cplusplus
 }
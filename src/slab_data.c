@@ -28,6 +28,7 @@
 #include "map_utils.h"
 #include "frontmenu_ingame_map.h"
 #include "game_legacy.h"
+#include "net_checksums.h"
 #include "creature_states.h"
 #include "map_data.h"
 
@@ -39,6 +40,28 @@ const short around_slab[] = {-86, -85, -84,  -1,   0,   1,  84,  85,  86};
 const short small_around_slab[] = {-85,   1,  85,  -1};
 struct SlabMap bad_slabmap_block;
 /******************************************************************************/
+/** Max amount of separate areas waiting for update while map updates are batched. */
+#define PENDING_MAP_UPDATES_COUNT 16
+
+struct MapUpdateArea {
+    MapSubtlCoord sx;
+    MapSubtlCoord sy;
+    MapSubtlCoord ex;
+    MapSubtlCoord ey;
+};
+
+static struct MapUpdateArea pending_map_updates[PENDING_MAP_UPDATES_COUNT];
+static int pending_map_updates_count = 0;
+static int map_updates_batch_level = 0;
+/** Amount of recent slab changes remembered; users which are further behind need to check the whole map. */
+#define SLABMAP_CHANGES_LOG_SIZE 256
+/** Incremented on every change of slab kind or owner. */
+static unsigned long slabmap_generation = 1;
+/** Numbers of recently changed slabs; the change from generation g is stored at index g % SLABMAP_CHANGES_LOG_SIZE. */
+static SlabCodedCoords slabmap_changes_log[SLABMAP_CHANGES_LOG_SIZE];
+/** Incremented on every change of map blocks or doors which may alter solidity. */
+static unsigned long map_blocks_generation = 1;
+/******************************************************************************/
 /******************************************************************************/
 /**
  * Returns slab number, which stores both X and Y coords in one number.
@@ -157,6 +180,15 @@ long slabmap_owner(const struct SlabMap *slb)
     return slb->field_5 & 0x07;
 }
 
+/**
+ * Remembers change of given slab, and increases slab map generation.
+ */
+static void slabmap_note_change(const struct SlabMap *slb)
+{
+    slabmap_changes_log[slabmap_generation % SLABMAP_CHANGES_LOG_SIZE] = (slb - &game.slabmap[0]);
+    slabmap_generation++;
+}
+
 /**
  * Sets owner of given SlabMap.
  */
@@ -164,7 +196,80 @@ void slabmap_set_owner(struct SlabMap *slb, PlayerNumber owner)
 {
     if (slabmap_block_invalid(slb))
         return;
+    if ((slb->field_5 & 0x07) != (owner & 0x07))
+        slabmap_note_change(slb);
     slb->field_5 ^= (slb->field_5 ^ owner) & 0x07;
+    sync_checksum_update_slab(slb);
+}
+
+/**
+ * Sets kind of given SlabMap.
+ */
+void slabmap_set_kind(struct SlabMap *slb, SlabKind kind)
+{
+    if (slabmap_block_invalid(slb))
+        return;
+    if (slb->kind != kind)
+        slabmap_note_change(slb);
+    slb->kind = kind;
+    sync_checksum_update_slab(slb);
+}
+
+/**
+ * Notes change of a slab which was modified without the setters, ie. by DLL code.
+ * @param slb The slab, already modified.
+ * @param prev_kind Kind of the slab before modification.
+ * @param prev_owner Owner of the slab before modification.
+ * @return True if the slab has changed.
+ */
+TbBool slabmap_note_direct_change(struct SlabMap *slb, SlabKind prev_kind, PlayerNumber prev_owner)
+{
+    if (slabmap_block_invalid(slb))
+        return false;
+    if ((slb->kind == prev_kind) && (slabmap_owner(slb) == prev_owner))
+        return false;
+    slabmap_note_change(slb);
+    sync_checksum_update_slab(slb);
+    return true;
+}
+
+/**
+ * Returns a number which changes every time kind or owner of any slab changes.
+ * Allows caching values computed from the slab map.
+ */
+unsigned long get_slabmap_generation(void)
+{
+    return slabmap_generation;
+}
+
+/**
+ * Gives the slab which was changed when slab map generation was increased from given value.
+ * Allows updating values cached with an older generation only for the slabs which changed.
+ * @return True if the slab was given; false if the change is no longer remembered, so whole map has to be checked.
+ */
+TbBool get_slabmap_changed_slab(unsigned long generation, SlabCodedCoords *slb_num)
+{
+    if ((generation >= slabmap_generation) || (slabmap_generation - generation > SLABMAP_CHANGES_LOG_SIZE))
+        return false;
+    *slb_num = slabmap_changes_log[generation % SLABMAP_CHANGES_LOG_SIZE];
+    return true;
+}
+
+/**
+ * Returns a number which changes every time map blocks or doors are modified.
+ * Allows caching values computed from map solidity, like line of sight.
+ */
+unsigned long get_map_blocks_generation(void)
+{
+    return map_blocks_generation;
+}
+
+/**
+ * Marks that map blocks or doors were modified, so values cached with previous generation are outdated.
+ */
+void map_blocks_changed(void)
+{
+    map_blocks_generation++;
 }
 
 /**
@@ -399,6 +504,8 @@ void clear_slabs(void)
             slb->kind = SlbT_ROCK;
         }
     }
+    // Skip past the changes log, so that all cached values are checked against whole map
+    slabmap_generation += SLABMAP_CHANGES_LOG_SIZE + 1;
 }
 
 SlabKind find_core_slab_type(MapSlabCoord slb_x, MapSlabCoord slb_y)
@@ -509,13 +616,133 @@ void reveal_whole_map(struct PlayerInfo *player)
     pannel_map_update(0, 0, map_subtiles_x+1, map_subtiles_y+1);
 }
 
-void update_blocks_in_area(MapSubtlCoord sx, MapSubtlCoord sy, MapSubtlCoord ex, MapSubtlCoord ey)
+/**
+ * Updates ceiling heights and light signals in given area; these are the updates which can be batched.
+ */
+static void update_ceiling_and_lights_in_area(MapSubtlCoord sx, MapSubtlCoord sy, MapSubtlCoord ex, MapSubtlCoord ey)
 {
-    update_navigation_triangulation(sx, sy, ex, ey);
     ceiling_partially_recompute_heights(sx, sy, ex, ey);
     light_signal_update_in_area(sx, sy, ex, ey);
 }
 
+static long map_update_area_size(const struct MapUpdateArea *area)
+{
+    return (area->ex - area->sx + 1) * (area->ey - area->sy + 1);
+}
+
+static void map_update_area_merge(struct MapUpdateArea *area, const struct MapUpdateArea *other)
+{
+    if (area->sx > other->sx) area->sx = other->sx;
+    if (area->sy > other->sy) area->sy = other->sy;
+    if (area->ex < other->ex) area->ex = other->ex;
+    if (area->ey < other->ey) area->ey = other->ey;
+}
+
+/**
+ * Returns if two areas should be merged, which is when updating their bounding box costs no more than updating both.
+ */
+static TbBool map_update_areas_mergeable(const struct MapUpdateArea *area, const struct MapUpdateArea *other)
+{
+    struct MapUpdateArea merged = *area;
+    map_update_area_merge(&merged, other);
+    return (map_update_area_size(&merged) <= map_update_area_size(area) + map_update_area_size(other));
+}
+
+/**
+ * Adds an area to the list of areas waiting for update.
+ * Areas which overlap much are merged; if the list is full, the area is merged with one which grows the least.
+ */
+static void add_pending_map_update(MapSubtlCoord sx, MapSubtlCoord sy, MapSubtlCoord ex, MapSubtlCoord ey)
+{
+    struct MapUpdateArea area;
+    int i;
+    area.sx = min(sx, ex);
+    area.sy = min(sy, ey);
+    area.ex = max(sx, ex);
+    area.ey = max(sy, ey);
+    // Merge with every pending area we overlap; merged area may now overlap others, so restart
+    i = 0;
+    while (i < pending_map_updates_count)
+    {
+        if (map_update_areas_mergeable(&pending_map_updates[i], &area))
+        {
+            map_update_area_merge(&area, &pending_map_updates[i]);
+            pending_map_updates_count--;
+            pending_map_updates[i] = pending_map_updates[pending_map_updates_count];
+            i = 0;
+            continue;
+        }
+        i++;
+    }
+    if (pending_map_updates_count < PENDING_MAP_UPDATES_COUNT)
+    {
+        pending_map_updates[pending_map_updates_count] = area;
+        pending_map_updates_count++;
+        return;
+    }
+    int best_idx = 0;
+    long best_growth = LONG_MAX;
+    for (i = 0; i < pending_map_updates_count; i++)
+    {
+        struct MapUpdateArea merged = pending_map_updates[i];
+        map_update_area_merge(&merged, &area);
+        long growth = map_update_area_size(&merged) - map_update_area_size(&pending_map_updates[i]);
+        if (growth < best_growth)
+        {
+            best_growth = growth;
+            best_idx = i;
+        }
+    }
+    map_update_area_merge(&pending_map_updates[best_idx], &area);
+}
+
+/**
+ * Starts gathering map areas which require ceiling and lights update.
+ * Until the matching end_map_updates_batch(), update_blocks_in_area() updates navigation
+ * triangulation at once, but only marks areas for the other updates; each of them is
+ * updated once at batch end. Batches can be nested.
+ * Use only around code which modifies the map without reading ceiling heights or lights in between.
+ */
+void begin_map_updates_batch(void)
+{
+    map_updates_batch_level++;
+}
+
+/**
+ * Ends map updates batch, updating all areas marked since the outermost batch started.
+ */
+void end_map_updates_batch(void)
+{
+    if (map_updates_batch_level <= 0)
+    {
+        ERRORLOG("Map updates batch ended without being started");
+        return;
+    }
+    map_updates_batch_level--;
+    if (map_updates_batch_level > 0)
+        return;
+    SYNCDBG(17,"Updating %d areas",pending_map_updates_count);
+    for (int i = 0; i < pending_map_updates_count; i++)
+    {
+        struct MapUpdateArea* area = &pending_map_updates[i];
+        update_ceiling_and_lights_in_area(area->sx, area->sy, area->ex, area->ey);
+    }
+    pending_map_updates_count = 0;
+}
+
+void update_blocks_in_area(MapSubtlCoord sx, MapSubtlCoord sy, MapSubtlCoord ex, MapSubtlCoord ey)
+{
+    map_blocks_changed();
+    // Triangle layout depends on order of the updates, so triangulation is never postponed
+    update_navigation_triangulation(sx, sy, ex, ey);
+    if (map_updates_batch_level > 0)
+    {
+        add_pending_map_update(sx, sy, ex, ey);
+        return;
+    }
+    update_ceiling_and_lights_in_area(sx, sy, ex, ey);
+}
+
 void update_blocks_around_slab(MapSlabCoord slb_x, MapSlabCoord slb_y)
 {
     SYNCDBG(7,"Starting");
@@ -668,6 +895,7 @@ void unfill_reinforced_corners(PlayerNumber keep_plyr_idx, MapSlabCoord base_slb
  */
 void do_unprettying(PlayerNumber keep_plyr_idx, MapSlabCoord slb_x, MapSlabCoord slb_y)
 {
+    begin_map_updates_batch();
     for (long n = 0; n < SMALL_AROUND_SLAB_LENGTH; n++)
     {
         long sslb_x = slb_x + (long)small_around[n].delta_x;
@@ -685,6 +913,7 @@ void do_unprettying(PlayerNumber keep_plyr_idx, MapSlabCoord slb_x, MapSlabCoord
             }
         }
     }
+    end_map_updates_batch();
 }
 /******************************************************************************/
 #ifdef __cplusplus
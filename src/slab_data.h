@@ -124,6 +124,12 @@ TbBool slabmap_block_invalid(const struct SlabMap *slb);
 TbBool slab_coords_invalid(MapSlabCoord slb_x, MapSlabCoord slb_y);
 long slabmap_owner(const struct SlabMap *slb);
 void slabmap_set_owner(struct SlabMap *slb, PlayerNumber owner);
+void slabmap_set_kind(struct SlabMap *slb, SlabKind kind);
+TbBool slabmap_note_direct_change(struct SlabMap *slb, SlabKind prev_kind, PlayerNumber prev_owner);
+unsigned long get_slabmap_generation(void);
+TbBool get_slabmap_changed_slab(unsigned long generation, SlabCodedCoords *slb_num);
+unsigned long get_map_blocks_generation(void);
+void map_blocks_changed(void);
 void set_whole_slab_owner(MapSlabCoord slb_x, MapSlabCoord slb_y, PlayerNumber owner);
 PlayerNumber get_slab_owner_thing_is_on(const struct Thing *thing);
 unsigned long slabmap_wlb(struct SlabMap *slb);
@@ -147,6 +153,8 @@ int check_room_at_slab_loose(PlayerNumber plyr_idx, RoomKind rkind,
 
 void clear_slabs(void);
 void reveal_whole_map(struct PlayerInfo *player);
+void begin_map_updates_batch(void);
+void end_map_updates_batch(void);
 void update_blocks_in_area(MapSubtlCoord sx, MapSubtlCoord sy, MapSubtlCoord ex, MapSubtlCoord ey);
 void update_blocks_around_slab(MapSlabCoord slb_x, MapSlabCoord slb_y);
 void update_map_collide(SlabKind slbkind, MapSubtlCoord stl_x, MapSubtlCoord stl_y);
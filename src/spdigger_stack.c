@@ -924,9 +924,7 @@ long get_random_mining_undug_area_position_for_digger_drop(PlayerNumber plyr_idx
     long i;
     long n;
     long tsk_max;
-    tsk_max = dungeon->highest_task_number;
-    if (tsk_max > MAPTASKS_COUNT)
-        tsk_max = MAPTASKS_COUNT;
+    tsk_max = get_dungeon_highest_task_number(dungeon);
     if (tsk_max > 1)
         n = ACTION_RANDOM(tsk_max);
     else
@@ -934,7 +932,7 @@ long get_random_mining_undug_area_position_for_digger_drop(PlayerNumber plyr_idx
     for (i=0; i < tsk_max; i++,n=(n+1)%tsk_max)
     {
         struct MapTask *mtask;
-        mtask = &dungeon->task_list[n];
+        mtask = get_dungeon_task_list_entry(dungeon, n);
         if (mtask->kind == SDDigTask_None)
             continue;
         if (mtask->kind == SDDigTask_MineGold)
@@ -965,9 +963,7 @@ long get_nearest_undug_area_position_for_digger(struct Thing *thing, MapSubtlCoo
     struct MapTask *mtask;
     long i;
     long tsk_max;
-    tsk_max = dungeon->highest_task_number;
-    if (tsk_max > MAPTASKS_COUNT)
-        tsk_max = MAPTASKS_COUNT;
+    tsk_max = get_dungeon_highest_task_number(dungeon);
     MapSubtlCoord digstl_y;
     MapSubtlCoord digstl_x;
     digstl_x = stl_num_decode_x(cctrl->digger.task_stl);
@@ -982,7 +978,7 @@ long get_nearest_undug_area_position_for_digger(struct Thing *thing, MapSubtlCoo
     best_stl_y = -1;
     for (i=0; i < tsk_max; i++)
     {
-        mtask = &dungeon->task_list[i];
+        mtask = get_dungeon_task_list_entry(dungeon, i);
         if (mtask->kind == SDDigTask_None)
             continue;
         if (mtask->kind != SDDigTask_Unknown3)
@@ -1034,7 +1030,7 @@ long check_out_undug_area(struct Thing *thing)
     struct CreatureControl *cctrl;
     cctrl = creature_control_get_from_thing(thing);
     struct MapTask *mtask;
-    mtask = &dungeon->task_list[tsk_id];
+    mtask = get_dungeon_task_list_entry(dungeon, tsk_id);
     cctrl->digger.task_idx = tsk_id;
     cctrl->digger.task_stl = mtask->coords;
     if (mtask->kind == SDDigTask_MineGold) {
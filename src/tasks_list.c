@@ -18,12 +18,17 @@
 /******************************************************************************/
 #include "tasks_list.h"
 
+#include <string.h>
+
 #include "globals.h"
 #include "bflib_basics.h"
 
 #include "spdigger_stack.h"
 #include "map_data.h"
 #include "dungeon_data.h"
+#include "slab_data.h"
+#include "game_merge.h"
+#include "game_legacy.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -31,11 +36,69 @@ extern "C" {
 /******************************************************************************/
 struct MapTask bad_map_task;
 /******************************************************************************/
+#define TASK_USED_WORDS ((MAPTASKS_MAX_COUNT + 31) / 32)
+
+/** Index of tasks by slab; stores index plus one of the lowest task placed at the slab. */
+static unsigned short task_at_slab[DUNGEONS_COUNT][MAPTASKS_SLABS_COUNT];
+/** Amount of tasks at each slab; there's normally only one, but nothing forbids adding duplicates. */
+static unsigned char tasks_count_at_slab[DUNGEONS_COUNT][MAPTASKS_SLABS_COUNT];
+/** Bitmap of used task slots, for finding the lowest free one. */
+static unsigned long task_used_bits[DUNGEONS_COUNT][TASK_USED_WORDS];
+/******************************************************************************/
+static long get_task_list_dungeon_index(const struct Dungeon *dungeon)
+{
+    if (dungeon_invalid(dungeon))
+        return -1;
+    long plyr_idx = dungeon - &game.dungeon[0];
+    if ((plyr_idx < 0) || (plyr_idx >= DUNGEONS_COUNT))
+        return -1;
+    return plyr_idx;
+}
+
+static long task_coords_slab_number(SubtlCodedCoords stl_num)
+{
+    MapSubtlCoord stl_x = stl_num_decode_x(stl_num);
+    MapSubtlCoord stl_y = stl_num_decode_y(stl_num);
+    long slb_num = get_slab_number(subtile_slab_fast(stl_x), subtile_slab_fast(stl_y));
+    if ((slb_num < 0) || (slb_num >= MAPTASKS_SLABS_COUNT))
+        return -1;
+    return slb_num;
+}
+
+static void set_highest_task_number(struct Dungeon *dungeon, long highest)
+{
+    struct DungeonAdd* dungeonadd = &gameadd.dungeon[get_task_list_dungeon_index(dungeon)];
+    dungeonadd->highest_task_number = highest;
+    // Original code only knows the part of the list stored in Dungeon
+    if (highest > MAPTASKS_COUNT)
+        highest = MAPTASKS_COUNT;
+    dungeon->highest_task_number = highest;
+}
+
+/**
+ * Returns the highest used task index plus one, ie. the limit for sweeping the task list.
+ */
+long get_dungeon_highest_task_number(const struct Dungeon *dungeon)
+{
+    long plyr_idx = get_task_list_dungeon_index(dungeon);
+    if (plyr_idx < 0)
+        return 0;
+    long highest = gameadd.dungeon[plyr_idx].highest_task_number;
+    if (highest > MAPTASKS_MAX_COUNT)
+        highest = MAPTASKS_MAX_COUNT;
+    return highest;
+}
+
 struct MapTask *get_dungeon_task_list_entry(struct Dungeon *dungeon, long task_idx)
 {
-    if ((task_idx < 0) || (task_idx >= MAPTASKS_COUNT))
+    if ((task_idx < 0) || (task_idx >= MAPTASKS_MAX_COUNT))
         return INVALID_MAP_TASK;
-    return &dungeon->task_list[task_idx];
+    if (task_idx < MAPTASKS_COUNT)
+        return &dungeon->task_list[task_idx];
+    long plyr_idx = get_task_list_dungeon_index(dungeon);
+    if (plyr_idx < 0)
+        return INVALID_MAP_TASK;
+    return &gameadd.dungeon[plyr_idx].task_list_ext[task_idx - MAPTASKS_COUNT];
 }
 
 struct MapTask *get_task_list_entry(long plyr_idx, long task_idx)
@@ -43,113 +106,179 @@ struct MapTask *get_task_list_entry(long plyr_idx, long task_idx)
     struct Dungeon* dungeon = get_dungeon(plyr_idx);
     if (dungeon_invalid(dungeon))
         return INVALID_MAP_TASK;
-    if ((task_idx < 0) || (task_idx >= MAPTASKS_COUNT))
-        return INVALID_MAP_TASK;
-    return &dungeon->task_list[task_idx];
+    return get_dungeon_task_list_entry(dungeon, task_idx);
 }
 
-void add_task_list_entry(PlayerNumber plyr_idx, unsigned char kind, SubtlCodedCoords stl_num)
+/**
+ * Adds task to the slab index and used slots bitmap.
+ */
+static void task_list_index_add(long plyr_idx, long task_idx, SubtlCodedCoords stl_num)
 {
-    struct Dungeon* dungeon = get_dungeon(plyr_idx);
-    if (dungeon_invalid(dungeon)) {
+    task_used_bits[plyr_idx][task_idx / 32] |= (1UL << (task_idx % 32));
+    long slb_num = task_coords_slab_number(stl_num);
+    if (slb_num < 0)
+        return;
+    unsigned short cur_idx = task_at_slab[plyr_idx][slb_num];
+    if ((cur_idx == 0) || (task_idx + 1 < cur_idx))
+        task_at_slab[plyr_idx][slb_num] = task_idx + 1;
+    if (tasks_count_at_slab[plyr_idx][slb_num] < UCHAR_MAX)
+        tasks_count_at_slab[plyr_idx][slb_num]++;
+}
+
+/**
+ * Removes task from the slab index and used slots bitmap. Needs to be called before the task is cleared.
+ */
+static void task_list_index_remove(struct Dungeon *dungeon, long plyr_idx, long task_idx, SubtlCodedCoords stl_num)
+{
+    task_used_bits[plyr_idx][task_idx / 32] &= ~(1UL << (task_idx % 32));
+    long slb_num = task_coords_slab_number(stl_num);
+    if (slb_num < 0)
+        return;
+    if (tasks_count_at_slab[plyr_idx][slb_num] > 0)
+        tasks_count_at_slab[plyr_idx][slb_num]--;
+    if (task_at_slab[plyr_idx][slb_num] != task_idx + 1)
         return;
+    task_at_slab[plyr_idx][slb_num] = 0;
+    if (tasks_count_at_slab[plyr_idx][slb_num] == 0)
+        return;
+    // Rare case of duplicated task - find the next one at this slab
+    long imax = get_dungeon_highest_task_number(dungeon);
+    for (long i = task_idx + 1; i < imax; i++)
+    {
+        struct MapTask* mtask = get_dungeon_task_list_entry(dungeon, i);
+        if ((mtask->kind != 0) && (mtask->coords == stl_num))
+        {
+            task_at_slab[plyr_idx][slb_num] = i + 1;
+            break;
+        }
     }
-    // Find free task index
-    int task_idx;
-    struct MapTask  *mtask;
-    for (task_idx=0; task_idx < dungeon->highest_task_number; task_idx++)
+}
+
+/**
+ * Finds the lowest task slot which is not used.
+ */
+static long find_free_task_slot(long plyr_idx)
+{
+    for (long n = 0; n < TASK_USED_WORDS; n++)
     {
-        mtask = &dungeon->task_list[task_idx];
+        unsigned long bits = task_used_bits[plyr_idx][n];
+        if ((bits & 0xFFFFFFFFUL) == 0xFFFFFFFFUL)
+            continue;
+        for (long i = 0; i < 32; i++)
+        {
+            if ((bits & (1UL << i)) == 0)
+            {
+                long task_idx = n * 32 + i;
+                if (task_idx >= MAPTASKS_MAX_COUNT)
+                    return -1;
+                return task_idx;
+            }
+        }
+    }
+    return -1;
+}
+
+/**
+ * Rebuilds slab index of the task list for given player. Needs to be called after the list is loaded.
+ */
+void rebuild_task_list_index(PlayerNumber plyr_idx)
+{
+    struct Dungeon* dungeon = get_dungeon(plyr_idx);
+    if (dungeon_invalid(dungeon))
+        return;
+    memset(task_at_slab[plyr_idx], 0, sizeof(task_at_slab[0]));
+    memset(tasks_count_at_slab[plyr_idx], 0, sizeof(tasks_count_at_slab[0]));
+    memset(task_used_bits[plyr_idx], 0, sizeof(task_used_bits[0]));
+    long highest = 0;
+    for (long i = 0; i < MAPTASKS_MAX_COUNT; i++)
+    {
+        struct MapTask* mtask = get_dungeon_task_list_entry(dungeon, i);
         if (mtask->kind == 0)
-          break;
+            continue;
+        task_list_index_add(plyr_idx, i, mtask->coords);
+        highest = i + 1;
+    }
+    set_highest_task_number(dungeon, highest);
+}
+
+void add_task_list_entry(PlayerNumber plyr_idx, unsigned char kind, SubtlCodedCoords stl_num)
+{
+    struct Dungeon* dungeon = get_dungeon(plyr_idx);
+    if (dungeon_invalid(dungeon)) {
+        return;
     }
-    if (task_idx == dungeon->highest_task_number)
+    // Find free task index; this is the lowest free one, as tasks are processed in index order
+    long task_idx = find_free_task_slot(plyr_idx);
+    if (task_idx < 0)
+        return;
+    if (task_idx >= get_dungeon_highest_task_number(dungeon))
     {
-        if (task_idx >= MAPTASKS_COUNT)
-            return;
-        dungeon->highest_task_number++;
+        set_highest_task_number(dungeon, task_idx + 1);
     }
     // Fill the task
     MapSubtlCoord taskstl_x = stl_slab_center_subtile(stl_num_decode_x(stl_num));
     MapSubtlCoord taskstl_y = stl_slab_center_subtile(stl_num_decode_y(stl_num));
-    mtask = &dungeon->task_list[task_idx];
+    struct MapTask* mtask = get_dungeon_task_list_entry(dungeon, task_idx);
     mtask->kind = kind;
     mtask->coords = get_subtile_number(taskstl_x, taskstl_y);
+    task_list_index_add(plyr_idx, task_idx, mtask->coords);
     dungeon->task_count++;
 }
 
 long find_from_task_list(PlayerNumber plyr_idx, SubtlCodedCoords srch_tsk)
 {
-    struct Dungeon* dungeon = get_dungeon(plyr_idx);
-    long imax = dungeon->highest_task_number;
-    if (imax > MAPTASKS_COUNT)
-        imax = MAPTASKS_COUNT;
-    for (long i = 0; i < imax; i++)
-    {
-        struct MapTask* mtask = &dungeon->task_list[i];
-        if (mtask->coords == srch_tsk)
-            return i;
-  }
-  return -1;
+    if ((plyr_idx < 0) || (plyr_idx >= DUNGEONS_COUNT))
+        return -1;
+    long slb_num = task_coords_slab_number(srch_tsk);
+    if (slb_num < 0)
+        return -1;
+    long task_idx = (long)task_at_slab[plyr_idx][slb_num] - 1;
+    if (task_idx < 0)
+        return -1;
+    // Tasks are always at slab center, so other subtiles of the slab are not matched
+    struct MapTask* mtask = get_task_list_entry(plyr_idx, task_idx);
+    if (mtask->coords != srch_tsk)
+        return -1;
+    return task_idx;
 }
 
 long find_from_task_list_by_slab(PlayerNumber plyr_idx, MapSlabCoord slb_x, MapSlabCoord slb_y)
 {
     SubtlCodedCoords srch_tsk = get_subtile_number_at_slab_center(slb_x, slb_y);
-    struct Dungeon* dungeon = get_dungeon(plyr_idx);
-    long imax = dungeon->highest_task_number;
-    if (imax > MAPTASKS_COUNT)
-        imax = MAPTASKS_COUNT;
-    for (long i = 0; i < imax; i++)
-    {
-        struct MapTask* mtask = &dungeon->task_list[i];
-        if (mtask->coords == srch_tsk)
-            return i;
-  }
-  return -1;
+    return find_from_task_list(plyr_idx, srch_tsk);
 }
 
 long find_from_task_list_by_subtile(PlayerNumber plyr_idx, MapSlabCoord stl_x, MapSlabCoord stl_y)
 {
     SubtlCodedCoords srch_tsk = get_subtile_number(stl_slab_center_subtile(stl_x), stl_slab_center_subtile(stl_y));
-    struct Dungeon* dungeon = get_dungeon(plyr_idx);
-    long imax = dungeon->highest_task_number;
-    if (imax > MAPTASKS_COUNT)
-        imax = MAPTASKS_COUNT;
-    for (long i = 0; i < imax; i++)
-    {
-        struct MapTask* mtask = &dungeon->task_list[i];
-        if (mtask->coords == srch_tsk)
-            return i;
-  }
-  return -1;
+    return find_from_task_list(plyr_idx, srch_tsk);
 }
 
 long find_dig_from_task_list(PlayerNumber plyr_idx, SubtlCodedCoords srch_tsk)
 {
-    struct Dungeon* dungeon = get_dungeon(plyr_idx);
-    long imax = dungeon->highest_task_number;
-    if (imax > MAPTASKS_COUNT)
-        imax = MAPTASKS_COUNT;
-    for (long i = 0; i < imax; i++)
-    {
-        struct MapTask* mtask = &dungeon->task_list[i];
-        if ((mtask->coords == srch_tsk))
-            return i;
-    }
-    return -1;
+    return find_from_task_list(plyr_idx, srch_tsk);
 }
 
 long find_next_dig_in_dungeon_task_list(struct Dungeon *dungeon, long last_dig)
 {
-    long mtasks_num = dungeon->highest_task_number;
-    if (mtasks_num > MAPTASKS_COUNT)
-        mtasks_num = MAPTASKS_COUNT;
-    for (long i = last_dig + 1; i < mtasks_num; i++)
+    long plyr_idx = get_task_list_dungeon_index(dungeon);
+    if (plyr_idx < 0)
+        return -1;
+    long mtasks_num = get_dungeon_highest_task_number(dungeon);
+    long i = last_dig + 1;
+    while (i < mtasks_num)
     {
-        struct MapTask* mtask = &dungeon->task_list[i];
+        // Skip whole words of free slots
+        unsigned long bits = task_used_bits[plyr_idx][i / 32] >> (i % 32);
+        if (bits == 0)
+        {
+            i = (i / 32 + 1) * 32;
+            continue;
+        }
+        struct MapTask* mtask = get_dungeon_task_list_entry(dungeon, i);
         if ((mtask->kind != SDDigTask_None))
             return i;
+        i++;
     }
     return -1;
 }
@@ -164,24 +293,28 @@ TbBool task_list_entry_invalid(struct MapTask *task)
 long remove_from_task_list(long plyr_idx, long stack_pos)
 {
     struct Dungeon* dungeon = get_dungeon(plyr_idx);
-    if ((stack_pos < 0) || (dungeon->highest_task_number <= stack_pos)) {
+    long highest = get_dungeon_highest_task_number(dungeon);
+    if ((stack_pos < 0) || (highest <= stack_pos)) {
       ERRORLOG("Invalid stack pos");
       return 0;
     }
-    struct MapTask* mtask = &dungeon->task_list[stack_pos];
+    struct MapTask* mtask = get_dungeon_task_list_entry(dungeon, stack_pos);
+    if (mtask->kind != 0) {
+        task_list_index_remove(dungeon, plyr_idx, stack_pos, mtask->coords);
+    }
     mtask->kind = 0;
     mtask->coords = 0;
     dungeon->task_count--;
-    if (dungeon->highest_task_number - stack_pos == 1)
+    if (highest - stack_pos == 1)
     {
         long i;
         for (i = stack_pos; i >= 0; i--)
         {
-            mtask = &dungeon->task_list[i];
+            mtask = get_dungeon_task_list_entry(dungeon, i);
             if (mtask->kind != 0)
               break;
         }
-        dungeon->highest_task_number = i + 1;
+        set_highest_task_number(dungeon, i + 1);
     }
     return 1;
 }
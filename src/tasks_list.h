@@ -22,7 +22,13 @@
 #include "globals.h"
 #include "bflib_basics.h"
 
+/** Amount of map tasks stored in Dungeon structure. */
 #define MAPTASKS_COUNT        300
+/** Amount of slabs on the map; there is at most one task per slab. */
+#define MAPTASKS_SLABS_COUNT  (85*85)
+/** Max amount of map tasks; tasks above MAPTASKS_COUNT are stored in DungeonAdd. */
+#define MAPTASKS_MAX_COUNT    MAPTASKS_SLABS_COUNT
+#define MAPTASKS_EXT_COUNT    (MAPTASKS_MAX_COUNT - MAPTASKS_COUNT)
 
 #ifdef __cplusplus
 extern "C" {
@@ -54,6 +60,8 @@ long find_from_task_list_by_subtile(PlayerNumber plyr_idx, MapSlabCoord stl_x, M
 long find_dig_from_task_list(PlayerNumber plyr_idx, SubtlCodedCoords srch_tsk);
 long remove_from_task_list(long a1, long a2);
 long find_next_dig_in_dungeon_task_list(struct Dungeon *dungeon, long last_dig);
+long get_dungeon_highest_task_number(const struct Dungeon *dungeon);
+void rebuild_task_list_index(PlayerNumber plyr_idx);
 
 /******************************************************************************/
 #ifdef __cplusplus
@@ -90,6 +90,11 @@
 extern "C" {
 #endif
 
+/******************************************************************************/
+/** Turns between re-evaluations of moods, needs and targets of dormant creatures with no enemy near. */
+#define DORMANT_CREATURE_EVALUATION_PERIOD 32
+/** Distance from an enemy creature at which dormant creature is evaluated every turn. */
+#define DORMANT_CREATURE_ENEMY_DISTANCE (8*STL_PER_SLB*COORD_PER_STL)
 /******************************************************************************/
 int creature_swap_idx[CREATURE_TYPES_COUNT];
 unsigned char teleport_destination = 18;
@@ -1755,6 +1760,54 @@ TbBool creature_pick_up_interesting_object_laying_nearby(struct Thing *creatng)
     return false;
 }
 
+/**
+ * Returns if creature is in a long lasting activity, which it only leaves when a need or a threat appears.
+ */
+static TbBool creature_state_is_dormant(const struct Thing *thing)
+{
+    switch (get_creature_state_besides_interruptions(thing))
+    {
+    case CrSt_CreatureSleep:
+    case CrSt_Researching:
+    case CrSt_Training:
+    case CrSt_Manufacturing:
+    case CrSt_Scavengering:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * Returns if creature should re-evaluate its moods, needs and targets this turn.
+ * Dormant creatures with no pending need and no enemy near do it once per DORMANT_CREATURE_EVALUATION_PERIOD
+ * turns, in buckets staggered by thing index. Only synchronized state is used, so all players compute the same.
+ */
+static TbBool creature_evaluation_due_this_turn(struct Thing *thing)
+{
+    if (((game.play_gameturn + thing->index) % DORMANT_CREATURE_EVALUATION_PERIOD) == 0) {
+        return true;
+    }
+    struct CreatureControl* cctrl = creature_control_get_from_thing(thing);
+    if (!creature_state_is_dormant(thing) || ((thing->alloc_flags & TAlF_IsControlled) != 0)) {
+        return true;
+    }
+    if (creature_is_group_member(thing) || (cctrl->opponents_melee_count != 0) || (cctrl->opponents_ranged_count != 0)) {
+        return true;
+    }
+    // Needs which are about to be satisfied are processed every turn, as usual
+    struct CreatureStats* crstat = creature_stats_get_from_thing(thing);
+    if ((cctrl->paydays_owed != 0) || (cctrl->field_B9 != 0) || ((cctrl->spell_flags & CSAfF_MadKilling) != 0)
+      || ((crstat->hunger_rate != 0) && (cctrl->hunger_level > (long)crstat->hunger_rate))) {
+        return true;
+    }
+    if ((get_creature_health_permil(thing) < gameadd.critical_health_permil) || creature_requires_healing(thing)
+      || creature_affected_by_call_to_arms(thing) || anger_is_creature_angry(thing)) {
+        return true;
+    }
+    return creature_has_enemy_creature_within_distance(thing, DORMANT_CREATURE_ENEMY_DISTANCE);
+}
+
 TngUpdateRet process_creature_state(struct Thing *thing)
 {
     SYNCDBG(19,"Starting for %s index %d owned by player %d",thing_model_name(thing),(int)thing->index,(int)thing->owner);
@@ -1763,8 +1816,13 @@ TngUpdateRet process_creature_state(struct Thing *thing)
     struct CreatureControl* cctrl = creature_control_get_from_thing(thing);
     unsigned long model_flags = get_creature_model_flags(thing);
 
-    process_person_moods_and_needs(thing);
-    if (creature_available_for_combat_this_turn(thing))
+    TbBool evaluate = creature_evaluation_due_this_turn(thing);
+    if (evaluate) {
+        process_person_moods_and_needs(thing);
+    } else {
+        process_person_needs_counters(thing);
+    }
+    if (evaluate && creature_available_for_combat_this_turn(thing))
     {
         TbBool fighting = creature_look_for_combat(thing);
         if (!fighting) {
@@ -1805,7 +1863,7 @@ TngUpdateRet process_creature_state(struct Thing *thing)
     // Creatures that are not special diggers will pick up any nearby gold or food
     if (((thing->movement_flags & TMvF_Flying) == 0) && ((model_flags & CMF_IsSpecDigger) == 0))
     {
-        if (!creature_is_being_unconscious(thing) && !creature_is_dying(thing) &&
+        if (evaluate && !creature_is_being_unconscious(thing) && !creature_is_dying(thing) &&
             !thing_is_picked_up(thing) && !creature_is_being_dropped(thing))
         {
             creature_pick_up_interesting_object_laying_nearby(thing);
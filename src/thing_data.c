@@ -30,6 +30,7 @@
 #include "thing_effects.h"
 #include "creature_graphics.h"
 #include "game_legacy.h"
+#include "net_checksums.h"
 #include "engine_arrays.h"
 #include "gui_topmsg.h" 
 
@@ -37,17 +38,64 @@
 extern "C" {
 #endif
 /******************************************************************************/
+/** Generation of every thing slot; changed whenever a thing is deleted, so handles to it become stale. */
+static unsigned short thing_slot_generation[THINGS_COUNT];
+/** Bitmap of slots which are in game.free_things list. */
+static unsigned char free_things_bitmap[(THINGS_COUNT+7)/8];
+/******************************************************************************/
+/**
+ * Selects effect element which can be freed to make a slot for gameplay thing.
+ * The element closest to the end of its life is chosen, so that freeing it is least visible.
+ */
+static struct Thing *find_effect_element_to_free(void)
+{
+    struct Thing *sel_thing = INVALID_THING;
+    long sel_health = LONG_MAX;
+    const struct StructureList* slist = &game.thing_lists[TngList_EffectElems];
+    unsigned long k = 0;
+    long i = slist->index;
+    while (i != 0)
+    {
+        struct Thing* thing = thing_get(i);
+        if (thing_is_invalid(thing))
+        {
+            ERRORLOG("Jump to invalid thing detected");
+            break;
+        }
+        i = thing->next_of_class;
+        // Per-thing code
+        if (thing->health < sel_health)
+        {
+            sel_health = thing->health;
+            sel_thing = thing;
+        }
+        // Per-thing code ends
+        k++;
+        if (k > THINGS_COUNT)
+        {
+            ERRORLOG("Infinite loop detected when sweeping things list");
+            break;
+        }
+    }
+    return sel_thing;
+}
+
 struct Thing *allocate_free_thing_structure_f(unsigned char allocflags, const char *func_name)
 {
     struct Thing *thing;
     // Get a thing from "free things list"
     long i = game.free_things_start_index;
+    // Visual things can't use the slots reserved for gameplay
+    if (((allocflags & FTAF_VisualOnly) != 0) && (i >= THINGS_COUNT-1-THINGS_RESERVED_FOR_GAMEPLAY))
+    {
+        return INVALID_THING;
+    }
     // If there is no free thing, try to free an effect
     if (i >= THINGS_COUNT-1)
     {
         if ((allocflags & FTAF_FreeEffectIfNoSlots) != 0)
         {
-            thing = thing_get(game.thing_lists[TngList_EffectElems].index);
+            thing = find_effect_element_to_free();
             if (!thing_is_invalid(thing))
             {
                 delete_thing_structure(thing, 0);
@@ -82,6 +130,7 @@ struct Thing *allocate_free_thing_structure_f(unsigned char allocflags, const ch
     }
     thing->alloc_flags |= TAlF_Exists;
     thing->index = game.free_things[i];
+    free_things_bitmap[thing->index >> 3] &= ~(1 << (thing->index & 7));
     game.free_things[game.free_things_start_index] = 0;
     game.free_things_start_index++;
     TRACE_THING(thing);
@@ -90,6 +139,11 @@ struct Thing *allocate_free_thing_structure_f(unsigned char allocflags, const ch
 
 TbBool i_can_allocate_free_thing_structure(unsigned char allocflags)
 {
+    // Visual things fail quietly when only reserved slots are left
+    if ((allocflags & FTAF_VisualOnly) != 0)
+    {
+        return (game.free_things_start_index < THINGS_COUNT-1-THINGS_RESERVED_FOR_GAMEPLAY);
+    }
     if (game.free_things_start_index > THINGS_COUNT - 5)
     {
         show_onscreen_msg(game.num_fps, "Warning: thing slots used %d/%d", game.free_things_start_index+1, THINGS_COUNT);
@@ -119,12 +173,55 @@ TbBool i_can_allocate_free_thing_structure(unsigned char allocflags)
  */
 TbBool is_in_free_things_list(long tng_idx)
 {
+    if ((tng_idx <= 0) || (tng_idx >= THINGS_COUNT))
+        return false;
+    return ((free_things_bitmap[tng_idx >> 3] & (1 << (tng_idx & 7))) != 0);
+}
+
+/**
+ * Rebuilds free slots bitmap from game.free_things list, and makes all thing handles stale.
+ * To be used after the free things list was re-created or loaded.
+ */
+void reinit_thing_slots_tracking(void)
+{
+    LbMemorySet(free_things_bitmap, 0, sizeof(free_things_bitmap));
     for (int i = game.free_things_start_index; i < THINGS_COUNT - 1; i++)
     {
-        if (game.free_things[i] == tng_idx)
-            return true;
+        long tng_idx = game.free_things[i];
+        if ((tng_idx > 0) && (tng_idx < THINGS_COUNT))
+            free_things_bitmap[tng_idx >> 3] |= (1 << (tng_idx & 7));
     }
-    return false;
+    for (int i = 0; i < THINGS_COUNT; i++)
+    {
+        thing_slot_generation[i]++;
+    }
+}
+
+/**
+ * Returns handle of a thing, which allows detecting whether the thing was deleted
+ * since the handle was taken, even if its slot was re-used.
+ */
+ThingHandle thing_get_handle(const struct Thing *thing)
+{
+    if (!thing_exists(thing))
+        return 0;
+    return ((ThingHandle)thing_slot_generation[thing->index] << 16) | thing->index;
+}
+
+/**
+ * Returns thing for given handle, or invalid thing if it was deleted since the handle was taken.
+ */
+struct Thing *thing_from_handle(ThingHandle handle)
+{
+    long tng_idx = (handle & 0xFFFF);
+    if ((tng_idx <= 0) || (tng_idx >= THINGS_COUNT))
+        return INVALID_THING;
+    if (thing_slot_generation[tng_idx] != (handle >> 16))
+        return INVALID_THING;
+    struct Thing* thing = thing_get(tng_idx);
+    if (!thing_exists(thing))
+        return INVALID_THING;
+    return thing;
 }
 
 void delete_thing_structure_f(struct Thing *thing, long a2, const char *func_name)
@@ -161,6 +258,9 @@ void delete_thing_structure_f(struct Thing *thing, long a2, const char *func_nam
     if (thing->index > 0) {
         game.free_things_start_index--;
         game.free_things[game.free_things_start_index] = thing->index;
+        free_things_bitmap[thing->index >> 3] |= (1 << (thing->index & 7));
+        thing_slot_generation[thing->index]++;
+        sync_checksum_remove_thing(thing);
     } else {
 #if (BFDEBUG_LEVEL > 0)
         ERRORMSG("%s: Performed deleting of thing with bad index %d!",func_name,(int)thing->index);
@@ -214,6 +314,8 @@ TbBool thing_exists(const struct Thing *thing)
         WARNLOG("Incorrectly indexed thing (%d) at pos %d",(int)thing->index,(int)(thing-thing_get(0)));
     if ((thing->class_id < 1) || (thing->class_id >= THING_CLASSES_COUNT))
         WARNLOG("Thing %d is of invalid class %d",(int)thing->index,(int)thing->class_id);
+    if (is_in_free_things_list(thing->index))
+        WARNLOG("Thing %d is allocated, but its slot is in free things list",(int)thing->index);
 #endif
     return true;
 }
@@ -72,6 +72,7 @@ enum ThingFlags4F {
 enum FreeThingAllocFlags {
     FTAF_Default             = 0x00,
     FTAF_FreeEffectIfNoSlots = 0x01,
+    FTAF_VisualOnly          = 0x02, /**< Thing is only a visual effect, so it can't use slots reserved for gameplay things. */
     FTAF_LogFailures         = 0x80,
 };
 
@@ -251,6 +252,9 @@ TbBool i_can_allocate_free_thing_structure(unsigned char allocflags);
 #define delete_thing_structure(thing, a2) delete_thing_structure_f(thing, a2, __func__)
 void delete_thing_structure_f(struct Thing *thing, long a2, const char *func_name);
 TbBool is_in_free_things_list(long tng_idx);
+void reinit_thing_slots_tracking(void);
+ThingHandle thing_get_handle(const struct Thing *thing);
+struct Thing *thing_from_handle(ThingHandle handle);
 
 #define thing_get(tng_idx) thing_get_f(tng_idx, __func__)
 struct Thing *thing_get_f(long tng_idx, const char *func_name);
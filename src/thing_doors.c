@@ -31,6 +31,7 @@
 #include "ariadne.h"
 #include "ariadne_wallhug.h"
 #include "map_blocks.h"
+#include "slab_data.h"
 #include "map_utils.h"
 #include "sounds.h"
 #include "gui_topmsg.h"
@@ -103,6 +104,7 @@ char get_door_orientation(MapSlabCoord slb_x, MapSlabCoord slb_y)
 
 struct Thing *create_door(struct Coord3d *pos, unsigned short a1, unsigned char a2, unsigned short a3, unsigned char a4)
 {
+  map_blocks_changed();
   return _DK_create_door(pos, a1, a2, a3, a4);
 }
 
@@ -130,6 +132,7 @@ void unlock_door(struct Thing *thing)
 {
     thing->byte_18 = 0;
     game.field_14EA4B = 1;
+    map_blocks_changed();
     update_navigation_triangulation(thing->mappos.x.stl.num-1, thing->mappos.y.stl.num-1,
       thing->mappos.x.stl.num+1, thing->mappos.y.stl.num+1);
     pannel_map_update(thing->mappos.x.stl.num-1, thing->mappos.y.stl.num-1, STL_PER_SLB, STL_PER_SLB);
@@ -147,6 +150,7 @@ void lock_door(struct Thing *doortng)
     doortng->door.word_16d = 0;
     doortng->door.is_locked = 1;
     game.field_14EA4B = 1;
+    map_blocks_changed();
     place_animating_slab_type_on_map(dostat->slbkind, 0, stl_x, stl_y, doortng->owner);
     update_navigation_triangulation(stl_x-1,  stl_y-1, stl_x+1,stl_y+1);
     pannel_map_update(stl_x-1, stl_y-1, STL_PER_SLB, STL_PER_SLB);
@@ -514,7 +514,7 @@ struct EffectElementStats *get_effect_element_model_stats(ThingModel tngmodel)
 struct Thing *create_effect_element(const struct Coord3d *pos, unsigned short eelmodel, unsigned short owner)
 {
     long i;
-    if (!i_can_allocate_free_thing_structure(FTAF_Default)) {
+    if (!i_can_allocate_free_thing_structure(FTAF_VisualOnly)) {
         return INVALID_THING;
     }
     if (!any_player_close_enough_to_see(pos)) {
@@ -523,7 +523,7 @@ struct Thing *create_effect_element(const struct Coord3d *pos, unsigned short ee
     struct EffectElementStats* eestat = get_effect_element_model_stats(eelmodel);
     struct InitLight ilght;
     LbMemorySet(&ilght, 0, sizeof(struct InitLight));
-    struct Thing* thing = allocate_free_thing_structure(FTAF_Default);
+    struct Thing* thing = allocate_free_thing_structure(FTAF_VisualOnly);
     if (thing->index == 0) {
         ERRORDBG(8,"Should be able to allocate effect element %d for player %d, but failed.",(int)eelmodel,(int)owner);
         return INVALID_THING;
@@ -1274,58 +1274,56 @@ TbBool explosion_affecting_thing(struct Thing *tngsrc, struct Thing *tngdst, con
 {
     TbBool affected = false;
     SYNCDBG(17,"Starting for %s, max damage %d, max blow %d, owner %d",thing_model_name(tngdst),(int)max_damage,(int)blow_strength,(int)owner);
-    if (nowibble_line_of_sight_3d(pos, &tngdst->mappos))
+    // Friendly fire usually causes less damage and at smaller distance
+    if ((tngdst->class_id == TCls_Creature) && (tngdst->owner == owner)) {
+        max_dist = max_dist * gameadd.friendly_fight_area_range_permil / 1000;
+        max_damage = max_damage * gameadd.friendly_fight_area_damage_permil / 1000;
+    }
+    MapCoordDelta distance = get_2d_distance(pos, &tngdst->mappos);
+    // Distance is checked first, as it is much cheaper than line of sight
+    if ((distance < max_dist) && nowibble_line_of_sight_3d(pos, &tngdst->mappos))
     {
-        // Friendly fire usually causes less damage and at smaller distance
-        if ((tngdst->class_id == TCls_Creature) && (tngdst->owner == owner)) {
-            max_dist = max_dist * gameadd.friendly_fight_area_range_permil / 1000;
-            max_damage = max_damage * gameadd.friendly_fight_area_damage_permil / 1000;
-        }
-        MapCoordDelta distance = get_2d_distance(pos, &tngdst->mappos);
-        if (distance < max_dist)
+        if (tngdst->class_id == TCls_Creature)
         {
-            if (tngdst->class_id == TCls_Creature)
+            HitPoints damage = get_radially_decaying_value(max_damage, max_dist / 4, 3 * max_dist / 4, distance) + 1;
+            SYNCDBG(7,"Causing %d damage to %s at distance %d",(int)damage,thing_model_name(tngdst),(int)distance);
+            apply_damage_to_thing_and_display_health(tngdst, damage, damage_type, owner);
+            affected = true;
+            if (tngdst->health < 0)
             {
-                HitPoints damage = get_radially_decaying_value(max_damage, max_dist / 4, 3 * max_dist / 4, distance) + 1;
-                SYNCDBG(7,"Causing %d damage to %s at distance %d",(int)damage,thing_model_name(tngdst),(int)distance);
-                apply_damage_to_thing_and_display_health(tngdst, damage, damage_type, owner);
-                affected = true;
-                if (tngdst->health < 0)
+                CrDeathFlags dieflags = CrDed_DiedInBattle;
+                // Explosions kill rather than only stun friendly creatures when imprison is on
+                if (tngsrc->owner == tngdst->owner)
                 {
-                    CrDeathFlags dieflags = CrDed_DiedInBattle;
-                    // Explosions kill rather than only stun friendly creatures when imprison is on
-                    if (tngsrc->owner == tngdst->owner)
-                    {
-                        dieflags |= CrDed_NoUnconscious;
-                    }
-                    kill_creature(tngdst, tngsrc, -1, dieflags);
-                    affected = true;
+                    dieflags |= CrDed_NoUnconscious;
                 }
+                kill_creature(tngdst, tngsrc, -1, dieflags);
+                affected = true;
+            }
+        }
+        if (thing_is_dungeon_heart(tngdst))
+        {
+            HitPoints damage = get_radially_decaying_value(max_damage, max_dist / 4, 3 * max_dist / 4, distance) + 1;
+            SYNCDBG(7,"Causing %d damage to %s at distance %d",(int)damage,thing_model_name(tngdst),(int)distance);
+            apply_damage_to_thing(tngdst, damage, damage_type, -1);
+            affected = true;
+            event_create_event_or_update_nearby_existing_event(tngdst->mappos.x.val, tngdst->mappos.y.val,EvKind_HeartAttacked, tngdst->owner, 0);
+            if (is_my_player_number(tngdst->owner))
+            {
+                output_message(SMsg_HeartUnderAttack, 400, true);
             }
-            if (thing_is_dungeon_heart(tngdst))
+        } else // Explosions move creatures and other things
+        {
+            long move_angle = get_angle_xy_to(pos, &tngdst->mappos);
+            long move_dist = get_radially_decaying_value(blow_strength, max_dist / 4, 3 * max_dist / 4, distance);
+            if (move_dist > 0)
             {
-                HitPoints damage = get_radially_decaying_value(max_damage, max_dist / 4, 3 * max_dist / 4, distance) + 1;
-                SYNCDBG(7,"Causing %d damage to %s at distance %d",(int)damage,thing_model_name(tngdst),(int)distance);
-                apply_damage_to_thing(tngdst, damage, damage_type, -1);
+                tngdst->veloc_push_add.x.val += distance_with_angle_to_coord_x(move_dist, move_angle);
+                tngdst->veloc_push_add.y.val += distance_with_angle_to_coord_y(move_dist, move_angle);
+                tngdst->state_flags |= TF1_PushAdd;
                 affected = true;
-                event_create_event_or_update_nearby_existing_event(tngdst->mappos.x.val, tngdst->mappos.y.val,EvKind_HeartAttacked, tngdst->owner, 0);
-                if (is_my_player_number(tngdst->owner))
-                {
-                    output_message(SMsg_HeartUnderAttack, 400, true);
-                }
-            } else // Explosions move creatures and other things
-            {
-                long move_angle = get_angle_xy_to(pos, &tngdst->mappos);
-                long move_dist = get_radially_decaying_value(blow_strength, max_dist / 4, 3 * max_dist / 4, distance);
-                if (move_dist > 0)
-                {
-                    tngdst->veloc_push_add.x.val += distance_with_angle_to_coord_x(move_dist, move_angle);
-                    tngdst->veloc_push_add.y.val += distance_with_angle_to_coord_y(move_dist, move_angle);
-                    tngdst->state_flags |= TF1_PushAdd;
-                    affected = true;
-                }
-            } 
-        }
+            }
+        } 
     }
     return affected;
 }
@@ -1339,16 +1337,14 @@ TbBool explosion_affecting_door(struct Thing *tngsrc, struct Thing *tngdst, cons
         ERRORLOG("%s is trying to damage %s which is not a door",thing_model_name(tngsrc),thing_model_name(tngdst));
         return false;
     }
-    if (line_of_sight_3d_ignoring_specific_door(&tngsrc->mappos, &tngdst->mappos,tngdst))
+    MapCoordDelta distance = get_2d_distance(pos, &tngdst->mappos);
+    // Distance is checked first, as it is much cheaper than line of sight
+    if ((distance < max_dist) && line_of_sight_3d_ignoring_specific_door(&tngsrc->mappos, &tngdst->mappos,tngdst))
     {
-        MapCoordDelta distance = get_2d_distance(pos, &tngdst->mappos);
-        if (distance < max_dist)
-        {
-            HitPoints damage = get_radially_decaying_value(max_damage, max_dist / 4, 3 * max_dist / 4, distance) + 1;
-            SYNCDBG(7,"Causing %d damage to %s at distance %d",(int)damage,thing_model_name(tngdst),(int)distance);
-            apply_damage_to_thing(tngdst, damage, damage_type, -1);
-            affected = true;
-        }
+        HitPoints damage = get_radially_decaying_value(max_damage, max_dist / 4, 3 * max_dist / 4, distance) + 1;
+        SYNCDBG(7,"Causing %d damage to %s at distance %d",(int)damage,thing_model_name(tngdst),(int)distance);
+        apply_damage_to_thing(tngdst, damage, damage_type, -1);
+        affected = true;
     }
     return affected;
 }
@@ -1625,53 +1621,51 @@ TbBool poison_cloud_affecting_thing(struct Thing *tngsrc, struct Thing *tngdst,
     } else {
         return affected;
     }
-    if (line_of_sight_3d(pos, &tngdst->mappos))
+    // Note that gas has no distinction over friendly and enemy fire
+    MapCoordDelta distance = get_2d_distance(pos, &tngdst->mappos);
+    // Distance is checked first, as it is much cheaper than line of sight
+    if ((distance < max_dist) && line_of_sight_3d(pos, &tngdst->mappos))
     {
-        // Note that gas has no distinction over friendly and enemy fire
-        MapCoordDelta distance = get_2d_distance(pos, &tngdst->mappos);
-        if (distance < max_dist)
+        struct CreatureControl* cctrl = creature_control_get_from_thing(tngdst);
+        cctrl->spell_flags |= CSAfF_PoisonCloud;
+        switch (area_affect_type)
         {
-            struct CreatureControl* cctrl = creature_control_get_from_thing(tngdst);
-            cctrl->spell_flags |= CSAfF_PoisonCloud;
-            switch (area_affect_type)
-            {
-            case AAffT_GasDamage:
-                if (max_damage > 0) {
-                    HitPoints damage;
-                    damage = get_radially_decaying_value(max_damage,3*max_dist/4,max_dist/4,distance)+1;
-                    SYNCDBG(7,"Causing %d damage to %s at distance %d",(int)damage,thing_model_name(tngdst),(int)distance);
-                    apply_damage_to_thing_and_display_health(tngdst, damage, damage_type, tngsrc->owner);
-                }
-                break;
-            case AAffT_GasSlow:
-                if (!creature_affected_by_spell(tngdst,SplK_Slow)) {
-                    struct CreatureControl *srcctrl;
-                    srcctrl = creature_control_get_from_thing(tngsrc);
-                    apply_spell_effect_to_thing(tngdst, SplK_Slow, srcctrl->explevel);
-                }
-                break;
-            case AAffT_GasSlowDamage:
-                if (max_damage > 0) {
-                    HitPoints damage;
-                    damage = get_radially_decaying_value(max_damage, 3 * max_dist / 4, max_dist / 4, distance) + 1;
-                    SYNCDBG(7, "Causing %d damage to %s at distance %d", (int)damage, thing_model_name(tngdst), (int)distance);
-                    apply_damage_to_thing_and_display_health(tngdst, damage, damage_type, tngsrc->owner);
-                }
-                if (!creature_affected_by_spell(tngdst, SplK_Slow)) {
-                    struct CreatureControl* srcctrl;
-                    srcctrl = creature_control_get_from_thing(tngsrc);
-                    apply_spell_effect_to_thing(tngdst, SplK_Slow, srcctrl->explevel);
-                }
-                break;
-            case AAffT_GasDisease:
-                if (!creature_affected_by_spell(tngdst, SplK_Disease)) {
-                    struct CreatureControl* srcctrl;
-                    srcctrl = creature_control_get_from_thing(tngsrc);
-                    apply_spell_effect_to_thing(tngdst, SplK_Disease, srcctrl->explevel);
-                }
+        case AAffT_GasDamage:
+            if (max_damage > 0) {
+                HitPoints damage;
+                damage = get_radially_decaying_value(max_damage,3*max_dist/4,max_dist/4,distance)+1;
+                SYNCDBG(7,"Causing %d damage to %s at distance %d",(int)damage,thing_model_name(tngdst),(int)distance);
+                apply_damage_to_thing_and_display_health(tngdst, damage, damage_type, tngsrc->owner);
+            }
+            break;
+        case AAffT_GasSlow:
+            if (!creature_affected_by_spell(tngdst,SplK_Slow)) {
+                struct CreatureControl *srcctrl;
+                srcctrl = creature_control_get_from_thing(tngsrc);
+                apply_spell_effect_to_thing(tngdst, SplK_Slow, srcctrl->explevel);
+            }
+            break;
+        case AAffT_GasSlowDamage:
+            if (max_damage > 0) {
+                HitPoints damage;
+                damage = get_radially_decaying_value(max_damage, 3 * max_dist / 4, max_dist / 4, distance) + 1;
+                SYNCDBG(7, "Causing %d damage to %s at distance %d", (int)damage, thing_model_name(tngdst), (int)distance);
+                apply_damage_to_thing_and_display_health(tngdst, damage, damage_type, tngsrc->owner);
+            }
+            if (!creature_affected_by_spell(tngdst, SplK_Slow)) {
+                struct CreatureControl* srcctrl;
+                srcctrl = creature_control_get_from_thing(tngsrc);
+                apply_spell_effect_to_thing(tngdst, SplK_Slow, srcctrl->explevel);
+            }
+            break;
+        case AAffT_GasDisease:
+            if (!creature_affected_by_spell(tngdst, SplK_Disease)) {
+                struct CreatureControl* srcctrl;
+                srcctrl = creature_control_get_from_thing(tngsrc);
+                apply_spell_effect_to_thing(tngdst, SplK_Disease, srcctrl->explevel);
             }
-            affected = true;
         }
+        affected = true;
     }
     return affected;
 }
@@ -20,6 +20,7 @@
 
 #include "bflib_basics.h"
 #include "bflib_math.h"
+#include "bflib_memory.h"
 #include "globals.h"
 #include "bflib_sound.h"
 #include "packets.h"
@@ -48,6 +49,7 @@
 #include "engine_camera.h"
 #include "gui_topmsg.h"
 #include "game_legacy.h"
+#include "net_checksums.h"
 #include "engine_redraw.h"
 #include "keeperfx.hpp"
 
@@ -78,9 +80,215 @@ Thing_Class_Func class_functions[] = {
 
 unsigned long thing_create_errors = 0;
 
+/** Size of creature cells; subtile coordinates are single bytes, so the map is at most 256 subtiles wide. */
+#define CREATURE_CELL_SIZE_STL   16
+#define CREATURE_CELLS_X         ((256 + CREATURE_CELL_SIZE_STL - 1) / CREATURE_CELL_SIZE_STL)
+#define CREATURE_CELLS_Y         ((256 + CREATURE_CELL_SIZE_STL - 1) / CREATURE_CELL_SIZE_STL)
+#define CREATURE_CELLS_COUNT     (CREATURE_CELLS_X * CREATURE_CELLS_Y)
+#define CREATURE_CELL_NOT_ON_MAP CREATURE_CELLS_COUNT
+
+/**
+ * Creature things sorted into coarse map cells, to find creatures near a position
+ * without sweeping the whole creatures list.
+ * Cells are square, CREATURE_CELL_SIZE_STL subtiles wide. Creatures which are
+ * not in mapwho (ie. in hand or in limbo) are kept in one additional cell,
+ * which is always included in searches.
+ */
+struct CreatureCellsIndex {
+    ThingIndex cell_head[CREATURE_CELLS_COUNT+1];
+    ThingIndex next_in_cell[THINGS_COUNT];
+    ThingIndex prev_in_cell[THINGS_COUNT];
+    /** Cell number plus one, or zero if the thing isn't indexed. */
+    unsigned short cell_of[THINGS_COUNT];
+    /** Order of adding to creatures list; creature added later is closer to list head. */
+    unsigned long list_seq[THINGS_COUNT];
+    unsigned long seq_counter;
+    unsigned long count;
+    /** Largest clipbox of indexed creatures, used as search margin. */
+    MapCoordDelta max_clipbox_xy;
+};
+
+static struct CreatureCellsIndex creature_cells;
+
 /******************************************************************************/
 DLLIMPORT struct Thing *_DK_get_nearest_object_at_position(long stl_x, long stl_y);
 /******************************************************************************/
+static long creature_cell_for_thing(const struct Thing *thing)
+{
+    if ((thing->alloc_flags & TAlF_IsInMapWho) == 0)
+        return CREATURE_CELL_NOT_ON_MAP;
+    long cell_x = thing->mappos.x.stl.num / CREATURE_CELL_SIZE_STL;
+    long cell_y = thing->mappos.y.stl.num / CREATURE_CELL_SIZE_STL;
+    return cell_y * CREATURE_CELLS_X + cell_x;
+}
+
+static void creature_cells_unlink(ThingIndex tng_idx)
+{
+    struct CreatureCellsIndex *cci = &creature_cells;
+    if (cci->cell_of[tng_idx] == 0)
+        return;
+    long cell = cci->cell_of[tng_idx] - 1;
+    ThingIndex prev_idx = cci->prev_in_cell[tng_idx];
+    ThingIndex next_idx = cci->next_in_cell[tng_idx];
+    if (prev_idx > 0) {
+        cci->next_in_cell[prev_idx] = next_idx;
+    } else {
+        cci->cell_head[cell] = next_idx;
+    }
+    if (next_idx > 0) {
+        cci->prev_in_cell[next_idx] = prev_idx;
+    }
+    cci->next_in_cell[tng_idx] = 0;
+    cci->prev_in_cell[tng_idx] = 0;
+    cci->cell_of[tng_idx] = 0;
+    cci->count--;
+}
+
+static void creature_cells_link(const struct Thing *thing)
+{
+    struct CreatureCellsIndex *cci = &creature_cells;
+    long cell = creature_cell_for_thing(thing);
+    ThingIndex tng_idx = thing->index;
+    ThingIndex next_idx = cci->cell_head[cell];
+    cci->prev_in_cell[tng_idx] = 0;
+    cci->next_in_cell[tng_idx] = next_idx;
+    if (next_idx > 0) {
+        cci->prev_in_cell[next_idx] = tng_idx;
+    }
+    cci->cell_head[cell] = tng_idx;
+    cci->cell_of[tng_idx] = cell + 1;
+    cci->count++;
+    if (cci->max_clipbox_xy < thing->clipbox_size_xy)
+        cci->max_clipbox_xy = thing->clipbox_size_xy;
+}
+
+/**
+ * Moves indexed creature to the cell matching its current position.
+ * Called whenever the creature enters or leaves mapwho.
+ */
+static void creature_cells_update_thing(const struct Thing *thing)
+{
+    if (thing->class_id != TCls_Creature)
+        return;
+    if (creature_cells.cell_of[thing->index] == 0)
+        return;
+    creature_cells_unlink(thing->index);
+    creature_cells_link(thing);
+}
+
+/**
+ * Re-creates creature cells index from creatures list and mapwho state.
+ * Needs to be called after the things were loaded or cleared in bulk.
+ */
+void rebuild_creature_cells_index(void)
+{
+    struct CreatureCellsIndex *cci = &creature_cells;
+    LbMemorySet(cci, 0, sizeof(struct CreatureCellsIndex));
+    const struct StructureList *slist = &game.thing_lists[TngList_Creatures];
+    // Creatures closer to list head get higher sequence numbers
+    cci->seq_counter = slist->count + 1;
+    unsigned long k = 0;
+    long i = slist->index;
+    while (i != 0)
+    {
+        struct Thing* thing = thing_get(i);
+        if (thing_is_invalid(thing))
+        {
+            ERRORLOG("Jump to invalid thing detected");
+            break;
+        }
+        i = thing->next_of_class;
+        // Per-thing code
+        if (cci->cell_of[thing->index] == 0)
+        {
+            cci->list_seq[thing->index] = cci->seq_counter - k;
+            creature_cells_link(thing);
+        }
+        // Per-thing code ends
+        k++;
+        if (k > slist->count)
+        {
+            ERRORLOG("Infinite loop detected when sweeping things list");
+            break;
+        }
+    }
+}
+
+/**
+ * Adds creatures from one cell into array, keeping it in creatures list order.
+ * @return New amount of things in the array.
+ */
+static long creature_cells_gather(long cell, ThingIndex *out_idx, long count)
+{
+    struct CreatureCellsIndex *cci = &creature_cells;
+    unsigned long k = 0;
+    ThingIndex i = cci->cell_head[cell];
+    while (i != 0)
+    {
+        // Per-thing code
+        // Insertion sort by list sequence; a cell rarely holds many creatures
+        long n = count;
+        while ((n > 0) && (cci->list_seq[out_idx[n-1]] < cci->list_seq[i]))
+        {
+            out_idx[n] = out_idx[n-1];
+            n--;
+        }
+        out_idx[n] = i;
+        count++;
+        // Per-thing code ends
+        i = cci->next_in_cell[i];
+        k++;
+        if (k > cci->count)
+        {
+            ERRORLOG("Infinite loop detected when sweeping creature cells");
+            break;
+        }
+    }
+    return count;
+}
+
+/**
+ * Fills given array with creatures which may be within given 2D box distance from position.
+ * Returned creatures are in the same order as on creatures list.
+ * @param pos Center position of the search.
+ * @param dist The box distance; creatures beyond it may be returned too, but never skipped.
+ * @param out_idx Array for indexes of returned things, at least THINGS_COUNT elements.
+ * @return Amount of returned things.
+ */
+static long get_creatures_in_cells_near_position(const struct Coord3d *pos, MapCoordDelta dist, ThingIndex *out_idx)
+{
+    struct CreatureCellsIndex *cci = &creature_cells;
+    if (cci->count != game.thing_lists[TngList_Creatures].count)
+    {
+        WARNLOG("Creature cells index out of sync (%lu instead of %lu creatures), rebuilding",
+            cci->count, game.thing_lists[TngList_Creatures].count);
+        rebuild_creature_cells_index();
+    }
+    const long cell_coords = CREATURE_CELL_SIZE_STL * COORD_PER_STL;
+    long cell_x1 = 0;
+    long cell_y1 = 0;
+    long cell_x2 = CREATURE_CELLS_X - 1;
+    long cell_y2 = CREATURE_CELLS_Y - 1;
+    if ((dist >= 0) && (dist < CREATURE_CELLS_X * cell_coords))
+    {
+        cell_x1 = max(pos->x.val - dist, 0) / cell_coords;
+        cell_y1 = max(pos->y.val - dist, 0) / cell_coords;
+        cell_x2 = min((pos->x.val + dist) / cell_coords, CREATURE_CELLS_X - 1);
+        cell_y2 = min((pos->y.val + dist) / cell_coords, CREATURE_CELLS_Y - 1);
+    }
+    long count = 0;
+    long cell_x;
+    long cell_y;
+    for (cell_y = cell_y1; cell_y <= cell_y2; cell_y++)
+    {
+        for (cell_x = cell_x1; cell_x <= cell_x2; cell_x++)
+        {
+            count = creature_cells_gather(cell_y * CREATURE_CELLS_X + cell_x, out_idx, count);
+        }
+    }
+    return creature_cells_gather(CREATURE_CELL_NOT_ON_MAP, out_idx, count);
+}
+
 /**
  * Adds thing at beginning of a StructureList.
  * @param thing
@@ -105,6 +313,12 @@ void add_thing_to_list(struct Thing *thing, struct StructureList *list)
         prevtng->prev_of_class = thing->index;
     }
     list->index = thing->index;
+    if ((list == &game.thing_lists[TngList_Creatures]) && (thing->class_id == TCls_Creature))
+    {
+        creature_cells_unlink(thing->index);
+        creature_cells.list_seq[thing->index] = ++creature_cells.seq_counter;
+        creature_cells_link(thing);
+    }
 }
 
 void remove_thing_from_list(struct Thing *thing, struct StructureList *slist)
@@ -147,6 +361,9 @@ void remove_thing_from_list(struct Thing *thing, struct StructureList *slist)
         thing->next_of_class = 0;
     }
     thing->alloc_flags &= ~TAlF_IsInStrucList;
+    if (slist == &game.thing_lists[TngList_Creatures]) {
+        creature_cells_unlink(thing->index);
+    }
     if (slist->count <= 0) {
         ERRORLOG("List has < 0 structures");
         return;
@@ -839,7 +1056,9 @@ TbBigChecksum update_things_in_list(struct StructureList *list)
               update_thing(thing);
           }
       }
-      sum += get_thing_checksum(thing);
+      TbBigChecksum tng_sum = get_thing_checksum(thing);
+      sync_checksum_update_thing(thing, tng_sum);
+      sum += tng_sum;
       // Per-thing code ends
       k++;
       if (k > THINGS_COUNT)
@@ -1139,6 +1358,7 @@ void remove_thing_from_mapwho(struct Thing *thing)
     thing->next_on_mapblk = 0;
     thing->prev_on_mapblk = 0;
     thing->alloc_flags &= ~TAlF_IsInMapWho;
+    creature_cells_update_thing(thing);
 }
 
 void place_thing_in_mapwho(struct Thing *thing)
@@ -1162,6 +1382,7 @@ void place_thing_in_mapwho(struct Thing *thing)
     set_mapwho_thing_index(mapblk, thing->index);
     thing->prev_on_mapblk = 0;
     thing->alloc_flags |= TAlF_IsInMapWho;
+    creature_cells_update_thing(thing);
 }
 
 struct Thing *find_base_thing_on_mapwho(ThingClass oclass, ThingModel model, MapSubtlCoord stl_x, MapSubtlCoord stl_y)
@@ -1534,7 +1755,89 @@ struct Thing *get_highest_score_enemy_creature_within_distance_possible_to_attac
     param.num1 = creatng->index;
     param.num2 = dist;
     param.num3 = 0;
-    return get_nth_thing_of_class_with_filter(filter, &param, 0);
+    // Only creatures near enough can pass the filter, so take candidates from creature cells.
+    // The filter only accepts combat distance below dist, and combat distance is reduced by clipboxes.
+    MapCoordDelta margin = ((long)creatng->clipbox_size_xy + creature_cells.max_clipbox_xy) / 2 + 1;
+    ThingIndex cand_idx[THINGS_COUNT];
+    long cand_count = get_creatures_in_cells_near_position(&creatng->mappos,
+        (dist < LONG_MAX - margin) ? dist + margin : -1, cand_idx);
+    // Select the same thing as get_nth_thing_of_class_with_filter() would
+    long maximizer = 0;
+    long curindex = 0;
+    struct Thing* retng = INVALID_THING;
+    long i;
+    for (i = 0; i < cand_count; i++)
+    {
+        struct Thing* thing = thing_get(cand_idx[i]);
+        long n = filter(thing, &param, maximizer);
+        if (n > maximizer)
+        {
+            retng = thing;
+            maximizer = n;
+            curindex = 0;
+        } else
+        if (n == maximizer)
+        {
+            if (curindex <= 0) {
+                retng = thing;
+            }
+            if (maximizer == LONG_MAX) {
+                break;
+            }
+            curindex++;
+        }
+    }
+    return retng;
+}
+
+/**
+ * Returns if there's a creature of an enemy player on map within given 2D box distance from creature.
+ * Creatures which are unconscious or kept in custody are not treated as a threat.
+ * @param creatng The creature around which the search is made.
+ * @param dist Max box distance, in map coordinates.
+ */
+TbBool creature_has_enemy_creature_within_distance(const struct Thing *creatng, MapCoordDelta dist)
+{
+    struct CreatureCellsIndex *cci = &creature_cells;
+    if (cci->count != game.thing_lists[TngList_Creatures].count)
+    {
+        WARNLOG("Creature cells index out of sync (%lu instead of %lu creatures), rebuilding",
+            cci->count, game.thing_lists[TngList_Creatures].count);
+        rebuild_creature_cells_index();
+    }
+    const long cell_coords = CREATURE_CELL_SIZE_STL * COORD_PER_STL;
+    long cell_x1 = max(creatng->mappos.x.val - dist, 0) / cell_coords;
+    long cell_y1 = max(creatng->mappos.y.val - dist, 0) / cell_coords;
+    long cell_x2 = min((creatng->mappos.x.val + dist) / cell_coords, CREATURE_CELLS_X - 1);
+    long cell_y2 = min((creatng->mappos.y.val + dist) / cell_coords, CREATURE_CELLS_Y - 1);
+    for (long cell_y = cell_y1; cell_y <= cell_y2; cell_y++)
+    {
+        for (long cell_x = cell_x1; cell_x <= cell_x2; cell_x++)
+        {
+            unsigned long k = 0;
+            ThingIndex i = cci->cell_head[cell_y * CREATURE_CELLS_X + cell_x];
+            while (i != 0)
+            {
+                struct Thing* thing = thing_get(i);
+                i = cci->next_in_cell[i];
+                // Per-thing code
+                if (players_are_enemies(creatng->owner, thing->owner)
+                  && (get_2d_box_distance(&creatng->mappos, &thing->mappos) <= dist)
+                  && !creature_is_being_unconscious(thing) && !creature_is_kept_in_custody(thing))
+                {
+                    return true;
+                }
+                // Per-thing code ends
+                k++;
+                if (k > cci->count)
+                {
+                    ERRORLOG("Infinite loop detected when sweeping creature cells");
+                    break;
+                }
+            }
+        }
+    }
+    return false;
 }
 
 struct Thing *get_random_trap_of_model_owned_by_and_armed(ThingModel tngmodel, PlayerNumber plyr_idx, TbBool armed)
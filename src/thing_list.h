@@ -31,6 +31,8 @@ extern "C" {
 /******************************************************************************/
 #define THING_CLASSES_COUNT    14
 #define THINGS_COUNT         2048
+/** Amount of thing slots which purely visual things, like effect elements, can't use. */
+#define THINGS_RESERVED_FOR_GAMEPLAY 256
 
 enum ThingClassIndex {
     TCls_Empty        =  0,
@@ -188,6 +190,7 @@ void remove_thing_from_its_class_list(struct Thing *thing);
 void add_thing_to_its_class_list(struct Thing *thing);
 ThingIndex get_thing_class_list_head(ThingClass class_id);
 struct StructureList *get_list_for_thing_class(ThingClass class_id);
+void rebuild_creature_cells_index(void);
 
 long creature_near_filter_is_enemy_of_and_not_specdigger(const struct Thing *thing, FilterParam val);
 long creature_near_filter_is_owned_by(const struct Thing *thing, FilterParam val);
@@ -259,6 +262,7 @@ struct Thing *find_gold_laying_in_dungeon(const struct Dungeon *dungeon);
 struct Thing *get_nearest_enemy_creature_possible_to_attack_by(struct Thing *creatng);
 #define find_nearest_enemy_creature(creatng) get_nearest_enemy_creature_possible_to_attack_by(creatng);
 struct Thing *get_highest_score_enemy_creature_within_distance_possible_to_attack_by(struct Thing *creatng, MapCoordDelta dist);
+TbBool creature_has_enemy_creature_within_distance(const struct Thing *creatng, MapCoordDelta dist);
 struct Thing *get_nth_creature_owned_by_and_matching_bool_filter(PlayerNumber plyr_idx, Thing_Bool_Filter matcher_cb, long n);
 struct Thing *get_nth_creature_owned_by_and_failing_bool_filter(PlayerNumber plyr_idx, Thing_Bool_Filter matcher_cb, long n);
 
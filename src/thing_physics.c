@@ -652,6 +652,40 @@ TbBool things_collide_while_first_moves_to(const struct Thing *firstng, const st
     }
     return thing_on_thing_at(firstng, dstpos, sectng);
 }
+
+/**
+ * Fills box covering all positions checked by things_collide_while_first_moves_to().
+ * @param mvbox The box to be filled.
+ * @param thing The moving thing.
+ * @param dstpos Position to which the thing moves.
+ */
+void get_thing_move_box(struct MoveBox2d *mvbox, const struct Thing *thing, const struct Coord3d *dstpos)
+{
+    mvbox->x_min = min(thing->mappos.x.val, dstpos->x.val);
+    mvbox->x_max = max(thing->mappos.x.val, dstpos->x.val);
+    mvbox->y_min = min(thing->mappos.y.val, dstpos->y.val);
+    mvbox->y_max = max(thing->mappos.y.val, dstpos->y.val);
+    mvbox->size_xy = thing->solid_size_xy;
+}
+
+/**
+ * Returns if a thing is near enough to the move box to be collided with.
+ * If this returns false, things_collide_while_first_moves_to() would return false as well;
+ * only XY plane is checked, so the opposite isn't true.
+ * @param mvbox The move box, from get_thing_move_box().
+ * @param sectng The thing which could be collided with.
+ */
+TbBool thing_may_collide_within_move_box(const struct MoveBox2d *mvbox, const struct Thing *sectng)
+{
+    MapCoordDelta dist_collide = (sectng->solid_size_xy + mvbox->size_xy) / 2;
+    if ((sectng->mappos.x.val <= mvbox->x_min - dist_collide) || (sectng->mappos.x.val >= mvbox->x_max + dist_collide)) {
+        return false;
+    }
+    if ((sectng->mappos.y.val <= mvbox->y_min - dist_collide) || (sectng->mappos.y.val >= mvbox->y_max + dist_collide)) {
+        return false;
+    }
+    return true;
+}
 /******************************************************************************/
 #ifdef __cplusplus
 }
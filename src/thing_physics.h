@@ -48,6 +48,15 @@ struct Thing;
 struct Dungeon;
 struct ComponentVector;
 
+/** XY area swept by a thing moving along a straight line; used to reject collision candidates early. */
+struct MoveBox2d {
+    MapCoord x_min;
+    MapCoord x_max;
+    MapCoord y_min;
+    MapCoord y_max;
+    MapCoordDelta size_xy;
+};
+
 #pragma pack()
 /******************************************************************************/
 TbBool thing_touching_floor(const struct Thing *thing);
@@ -55,6 +64,8 @@ TbBool thing_touching_flight_altitude(const struct Thing *thing);
 
 TbBool thing_on_thing_at(const struct Thing *firstng, const struct Coord3d *pos, const struct Thing *sectng);
 TbBool things_collide_while_first_moves_to(const struct Thing *firstng, const struct Coord3d *dstpos, const struct Thing *sectng);
+void get_thing_move_box(struct MoveBox2d *mvbox, const struct Thing *thing, const struct Coord3d *dstpos);
+TbBool thing_may_collide_within_move_box(const struct MoveBox2d *mvbox, const struct Thing *sectng);
 TbBool cross_x_boundary_first(const struct Coord3d *pos1, const struct Coord3d *pos2);
 TbBool cross_y_boundary_first(const struct Coord3d *pos1, const struct Coord3d *pos2);
 
@@ -1095,7 +1095,13 @@ long collide_filter_thing_is_shootable(const struct Thing *thing, const struct T
     return thing_is_shootable(thing, shot_owner, hit_targets);
 }
 
-struct Thing *get_thing_collided_with_at_satisfying_filter_for_subtile(struct Thing *shotng, struct Coord3d *pos, Thing_Collide_Func filter, long param1, long param2, MapSubtlCoord stl_x, MapSubtlCoord stl_y)
+/**
+ * Returns first thing on given subtile which the moving thing collides with.
+ * Things outside of the move box are skipped before the filter is called; the filter
+ * has no side effects, so this doesn't change which thing is returned.
+ */
+struct Thing *get_thing_collided_with_at_satisfying_filter_for_subtile(struct Thing *shotng, struct Coord3d *pos,
+    const struct MoveBox2d *mvbox, Thing_Collide_Func filter, long param1, long param2, MapSubtlCoord stl_x, MapSubtlCoord stl_y)
 {
     struct Thing* parntng = INVALID_THING;
     if (shotng->parent_idx > 0) {
@@ -1115,7 +1121,7 @@ struct Thing *get_thing_collided_with_at_satisfying_filter_for_subtile(struct Th
         }
         i = thing->next_on_mapblk;
         // Per thing code start
-        if (thing->index != shotng->index)
+        if ((thing->index != shotng->index) && thing_may_collide_within_move_box(mvbox, thing))
         {
             if (filter(thing, parntng, param1, param2))
             {
@@ -1157,11 +1163,13 @@ struct Thing *get_thing_collided_with_at_satisfying_filter(struct Thing *shotng,
         if (stl_y_max > map_subtiles_y)
             stl_y_max = map_subtiles_y;
     }
+    struct MoveBox2d mvbox;
+    get_thing_move_box(&mvbox, shotng, pos);
     for (MapSubtlCoord stl_y = stl_y_min; stl_y <= stl_y_max; stl_y++)
     {
         for (MapSubtlCoord stl_x = stl_x_min; stl_x <= stl_x_max; stl_x++)
         {
-            struct Thing* coltng = get_thing_collided_with_at_satisfying_filter_for_subtile(shotng, pos, filter, a4, a5, stl_x, stl_y);
+            struct Thing* coltng = get_thing_collided_with_at_satisfying_filter_for_subtile(shotng, pos, &mvbox, filter, a4, a5, stl_x, stl_y);
             if (!thing_is_invalid(coltng)) {
                 return coltng;
             }